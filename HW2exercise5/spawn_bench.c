@@ -0,0 +1,235 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "../common/hrtime.h"
+#include "../common/histogram.h"
+
+//
+// Process-spawn cost (Linux only): how long it takes to start a program,
+// four ways, while the parent's RSS grows.
+//
+//   fork         fork(), then execve in the child (question4.c's pattern).
+//                fork copies the parent's page tables and write-protects
+//                every page, so its cost grows with RSS
+//   vfork        the child borrows the parent's memory until it execs; the
+//                parent is suspended meanwhile, and nothing is copied
+//   posix_spawn  glibc's posix_spawn, which uses clone(CLONE_VM|CLONE_VFORK)
+//                internally on Linux
+//   clone        clone(CLONE_VM|CLONE_VFORK) called directly, running the
+//                child on its own small stack until it execs
+//
+// The parent first maps and touches rss_mb of ballast (MADV_NOHUGEPAGE, so
+// it is 4KB pages with one PTE each, as in a big heap). Then `launchers`
+// threads at once each spawn `target` `spawns` times and reap it with
+// waitpid. Each line shows the ballast asked for and the RSS measured from
+// /proc/self/statm (ballast plus the program itself). Two numbers per spawn:
+//
+//   call  from the spawn call until it returns in the parent (what a
+//         launcher thread is blocked for)
+//   rt    from the spawn call until the child has exec'd, run and been reaped
+//
+// usage: spawn_bench [method|all] [rss_mb|sweep] [launchers=1] [spawns=200] [target=/bin/true]
+//   sweep: 1 4 16 64 256 1024 4096 16384 MB; sizes that don't fit in 80% of
+//   MemAvailable are skipped
+//
+
+enum { M_FORK, M_VFORK, M_POSIX_SPAWN, M_CLONE, M_NKINDS };
+static const char *m_names[M_NKINDS] = { "fork", "vfork", "posix_spawn", "clone" };
+
+#define CLONE_STACK (64 * 1024)
+#define WARMUP      2               // untimed spawns per launcher
+
+static const long sweep_mb[] = { 1, 4, 16, 64, 256, 1024, 4096, 16384 };
+
+extern char **environ;
+
+static const char *target = "/bin/true";
+static int method, spawns;
+
+typedef struct {
+    hist_t call, rt;
+    long failed;
+    char *stack;                    // clone child stack
+} __attribute__((aligned(64))) launcher_t;
+
+static int clone_child(void *arg) {
+    char *argv[] = { (char *) arg, NULL };
+    execve((char *) arg, argv, environ);
+    _exit(127);
+}
+
+// Starts target, returns its pid (or -1).
+static pid_t spawn_one(launcher_t *l) {
+    char *argv[] = { (char *) target, NULL };
+    pid_t pid = -1;
+    switch (method) {
+    case M_FORK:
+        pid = fork();
+        if (pid == 0) { execve(target, argv, environ); _exit(127); }
+        break;
+    case M_VFORK:
+        pid = vfork();
+        if (pid == 0) { execve(target, argv, environ); _exit(127); }
+        break;
+    case M_POSIX_SPAWN:
+        if (posix_spawn(&pid, target, NULL, NULL, argv, environ) != 0) pid = -1;
+        break;
+    case M_CLONE:
+        pid = clone(clone_child, l->stack + CLONE_STACK, CLONE_VM | CLONE_VFORK | SIGCHLD, (void *) target);
+        break;
+    }
+    return pid;
+}
+
+// 1 if the child ran and exited 0; a waitpid error other than EINTR counts
+// as a failed spawn.
+static int reap(pid_t pid) {
+    int status;
+    if (pid < 0) return 0;
+    while (waitpid(pid, &status, 0) < 0)
+        if (errno != EINTR) return 0;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void *launcher(void *arg) {
+    launcher_t *l = (launcher_t *) arg;
+    for (int i = 0; i < WARMUP; i++) reap(spawn_one(l));
+    for (int i = 0; i < spawns; i++) {
+        uint64_t t0 = hr_now_ns();
+        pid_t pid = spawn_one(l);
+        uint64_t t1 = hr_now_ns();
+        int ok = reap(pid);
+        uint64_t t2 = hr_now_ns();
+        if (!ok) { l->failed++; continue; }
+        hist_record(&l->call, t1 - t0);
+        hist_record(&l->rt, t2 - t0);
+    }
+    return NULL;
+}
+
+static long mem_available_mb(void) {
+    FILE *f = fopen("/proc/meminfo", "r");
+    char line[256];
+    long kb = -1;
+    if (!f) return -1;
+    while (fgets(line, sizeof(line), f))
+        if (sscanf(line, "MemAvailable: %ld kB", &kb) == 1) break;
+    fclose(f);
+    return kb < 0 ? -1 : kb / 1024;
+}
+
+static long rss_mb(void) {
+    FILE *f = fopen("/proc/self/statm", "r");
+    long size, res = -1;
+    if (f) {
+        if (fscanf(f, "%ld %ld", &size, &res) != 2) res = -1;
+        fclose(f);
+    }
+    return res < 0 ? -1 : res * (sysconf(_SC_PAGESIZE) / 1024) / 1024;
+}
+
+// Grows (never shrinks) the ballast to mb; returns 0 or -1. The old ballast
+// goes first, so RSS peaks at mb rather than old + new.
+static char *ballast;
+static size_t ballast_bytes;
+static int ballast_grow(long mb) {
+    size_t want = (size_t) mb << 20, page = sysconf(_SC_PAGESIZE);
+    if (want <= ballast_bytes) return 0;
+    if (ballast) munmap(ballast, ballast_bytes);
+    ballast = NULL;
+    ballast_bytes = 0;
+    char *p = mmap(NULL, want, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) { perror("mmap ballast"); return -1; }
+    madvise(p, want, MADV_NOHUGEPAGE);
+    for (size_t off = 0; off < want; off += page) p[off] = (char) off;
+    ballast = p;
+    ballast_bytes = want;
+    return 0;
+}
+
+static void run(int m, long mb, int nl) {
+    launcher_t *l;
+    if (posix_memalign((void **) &l, 64, sizeof(launcher_t) * nl) != 0) { perror("posix_memalign"); exit(1); }
+    pthread_t *t = malloc(sizeof(pthread_t) * nl);
+    method = m;
+    for (int i = 0; i < nl; i++) {
+        hist_init(&l[i].call);
+        hist_init(&l[i].rt);
+        l[i].failed = 0;
+        l[i].stack = m == M_CLONE ? malloc(CLONE_STACK) : NULL;
+    }
+
+    uint64_t start = hr_now_ns();
+    for (int i = 0; i < nl; i++) pthread_create(&t[i], NULL, launcher, &l[i]);
+    for (int i = 0; i < nl; i++) pthread_join(t[i], NULL);
+    uint64_t end = hr_now_ns();
+
+    hist_t call, rt;
+    hist_init(&call);
+    hist_init(&rt);
+    long failed = 0;
+    for (int i = 0; i < nl; i++) {
+        hist_merge(&call, &l[i].call);
+        hist_merge(&rt, &l[i].rt);
+        failed += l[i].failed;
+        free(l[i].stack);
+    }
+    // Warmups overlap the timed spawns of other launchers, so the rate
+    // counts them too.
+    double sec = (end - start) / 1e9;
+    printf("[spawn] method=%s ballast_mb=%ld rss_mb=%ld launchers=%d spawns=%lu time_ms=%.3f spawns_per_s=%.0f"
+           " call_us_p50=%.1f call_us_p99=%.1f rt_us_p50=%.1f rt_us_p99=%.1f rt_us_mean=%.1f %s\n",
+           m_names[m], mb, rss_mb(), nl, (unsigned long) rt.n, hr_elapsed_ms(start, end),
+           (rt.n + (uint64_t) nl * WARMUP) / sec,
+           hist_quantile(&call, 0.5) / 1e3, hist_quantile(&call, 0.99) / 1e3,
+           hist_quantile(&rt, 0.5) / 1e3, hist_quantile(&rt, 0.99) / 1e3, hist_mean(&rt) / 1e3,
+           failed ? "FAILED" : "ok");
+    fflush(stdout);
+    free(l);
+    free(t);
+}
+
+int main(int argc, char *argv[]) {
+    const char *which = argc > 1 ? argv[1] : "all";
+    const char *rss_arg = argc > 2 ? argv[2] : "sweep";
+    int nl = argc > 3 ? atoi(argv[3]) : 1;
+    spawns = argc > 4 ? atoi(argv[4]) : 200;
+    if (argc > 5) target = argv[5];
+
+    int only = -1;
+    for (int m = 0; m < M_NKINDS && strcmp(which, "all"); m++)
+        if (!strcmp(which, m_names[m])) only = m;
+    long one_mb = strcmp(rss_arg, "sweep") ? atol(rss_arg) : 0;
+    if ((strcmp(which, "all") && only < 0) || (one_mb <= 0 && strcmp(rss_arg, "sweep")) || nl < 1 || spawns < 1) {
+        fprintf(stderr, "usage: %s [fork|vfork|posix_spawn|clone|all] [rss_mb|sweep] [launchers=1]"
+                " [spawns=200] [target=/bin/true]\n", argv[0]);
+        return 1;
+    }
+    if (access(target, X_OK) != 0) { perror(target); return 1; }
+
+    int nsizes = one_mb ? 1 : (int) (sizeof(sweep_mb) / sizeof(sweep_mb[0]));
+    for (int s = 0; s < nsizes; s++) {
+        long mb = one_mb ? one_mb : sweep_mb[s];
+        // ballast_grow frees the current ballast before mapping the new
+        // one, so that memory counts as available for this step.
+        long avail = mem_available_mb() + (long) (ballast_bytes >> 20);
+        if (!one_mb && avail > 0 && mb > avail * 8 / 10) {
+            fprintf(stderr, "skipping ballast_mb=%ld: only %ld MB available\n", mb, avail);
+            continue;
+        }
+        if (ballast_grow(mb) != 0) return 1;
+        for (int m = 0; m < M_NKINDS; m++)
+            if (only < 0 || m == only) run(m, mb, nl);
+    }
+    return 0;
+}
@@ -1,66 +1,182 @@
+#define _GNU_SOURCE
 #include <stdio.h>
-#include <sys/time.h>
+#include "../common/hrtime.h"
+#include "../common/histogram.h"
+#include "../common/topology.h"
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 #include <sys/wait.h>
 
-int main() {
-    int pipe1[2], pipe2[2];  // Two pipes
-    pid_t pid;
-    struct timeval start, end;
-    char byte = 1;
-    int iterations = 10000;
-    long time_diff;
-    double time_per_switch;
-    
+//
+// Context switch cost: two tasks ping-pong one byte over two pipes, so each
+// side blocks in read() until the other has written.
+//
+// Where the two tasks run decides what this measures:
+//
+//   same    both on one CPU: every hop is a real context switch
+//   smt     hyperthread siblings of one core
+//   core    two different cores of one socket
+//   socket  two different sockets
+//   none    no pinning (the old behaviour; the scheduler picks)
+//
+// Only `same` times context switches. The others time cross-CPU wakeup
+// latency (IPI + the wakee leaving idle), which is what an IPC hop between
+// two busy services costs. The tasks are either two processes (fork) or two
+// threads of one process, which skip the address-space switch.
+//
+// usage: context_switch_test [--pin=same|smt|core|socket|none|all]
+//                            [--mode=process|thread|all] [--iters=N] [--cpu=N]
+//   --cpu picks the first task's CPU (default: the first one we may use);
+//   placements the machine doesn't have (no SMT, one socket) are skipped
+//
+
+enum { PIN_NONE, PIN_SAME, PIN_SMT, PIN_CORE, PIN_SOCKET, PIN_NKINDS };
+static const char *pin_names[PIN_NKINDS] = { "none", "same", "smt", "core", "socket" };
+
+int to_pong[2], to_ping[2];     // Two pipes
+int iterations = 10000;
+
+typedef struct {
+    int cpu;                // -1 = don't pin
+} pong_arg_t;
+
+// The other side: echo every byte back.
+static void pong(int cpu) {
+    char byte;
+    if (cpu >= 0) topo_pin_self(cpu);
+    for (int i = 0; i < iterations; i++) {
+        if (read(to_pong[0], &byte, 1) != 1) break;   // Read from to_pong
+        if (write(to_ping[1], &byte, 1) != 1) break;  // Write to to_ping
+    }
+}
+
+static void *pong_thread(void *arg) {
+    pong(((pong_arg_t *) arg)->cpu);
+    return NULL;
+}
+
+// Second CPU for placement `pin` relative to cpu0, -1 if none exists.
+static int partner_cpu(const topo_t *t, int pin, int cpu0) {
+    switch (pin) {
+    case PIN_SAME:   return cpu0;
+    case PIN_SMT:    return topo_find_sibling(t, cpu0);
+    case PIN_CORE:   return topo_find_other_core(t, cpu0);
+    case PIN_SOCKET: return topo_find_other_package(t, cpu0);
+    }
+    return -1;
+}
+
+static void run(const topo_t *t, int pin, int use_threads, int cpu0) {
+    int cpu1 = partner_cpu(t, pin, cpu0);
+    if (pin != PIN_NONE && cpu1 < 0) {
+        printf("[ctxsw] pin=%s mode=%s skipped: no such CPU pair\n",
+               pin_names[pin], use_threads ? "thread" : "process");
+        return;
+    }
+    if (pin == PIN_NONE) cpu0 = -1;
+
     // Create two pipes
-    if (pipe(pipe1) < 0 || pipe(pipe2) < 0) {
+    if (pipe(to_pong) < 0 || pipe(to_ping) < 0) {
         perror("pipe");
         exit(1);
     }
-    
-    printf("Measuring context switch cost...\n");
-    printf("Running %d context switch tests\n", iterations);
-    
-    pid = fork();
-    if (pid < 0) {
-        perror("fork");
-        exit(1);
-    }
-    
-    if (pid == 0) {
-        // Child process
-        for (int i = 0; i < iterations; i++) {
-            read(pipe1[0], &byte, 1);   // Read from pipe1
-            write(pipe2[1], &byte, 1);  // Write to pipe2
+
+    // The partner pins itself before its first read. We pin only after
+    // starting it (affinity is inherited) and restore ours afterwards.
+    cpu_set_t saved;
+    sched_getaffinity(0, sizeof(saved), &saved);
+    pid_t pid = -1;
+    pthread_t tid;
+    pong_arg_t arg = { cpu1 };
+    fflush(stdout);
+    if (use_threads) {
+        if (pthread_create(&tid, NULL, pong_thread, &arg) != 0) {
+            perror("pthread_create");
+            exit(1);
         }
-        exit(0);
     } else {
-        // Parent process
-        // Start timing
-        gettimeofday(&start, NULL);
-        
-        for (int i = 0; i < iterations; i++) {
-            write(pipe1[1], &byte, 1);  // Write to pipe1
-            read(pipe2[0], &byte, 1);   // Read from pipe2
+        pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            exit(1);
+        }
+        if (pid == 0) {
+            // Child process
+            pong(cpu1);
+            _exit(0);
         }
-        
-        // End timing
-        gettimeofday(&end, NULL);
-        
-        // Wait for child process to finish
-        wait(NULL);
-        
-        // Calculate time difference (in microseconds)
-        time_diff = (end.tv_sec - start.tv_sec) * 1000000 + 
-                    (end.tv_usec - start.tv_usec);
-        
-        // Each round trip = 2 context switches, so divide by 2
-        time_per_switch = (double)time_diff / (iterations * 2);
-        
-        printf("Total time: %ld microseconds\n", time_diff);
-        printf("Average time per context switch: %.2f microseconds\n", time_per_switch);
     }
-    
+    if (cpu0 >= 0) topo_pin_self(cpu0);
+
+    char byte = 1;
+    hist_t h;
+    hist_init(&h);
+    int warm = iterations / 10;
+    // The partner only echoes `iterations` bytes; warm-up comes out of those.
+    uint64_t start = 0;
+    for (int i = 0; i < iterations; i++) {
+        if (i == warm) start = hr_now_ns();
+        uint64_t s = hr_now_ns();
+        write(to_pong[1], &byte, 1);  // Write to to_pong
+        read(to_ping[0], &byte, 1);   // Read from to_ping
+        if (i >= warm) hist_record(&h, hr_now_ns() - s);
+    }
+    uint64_t end = hr_now_ns();
+
+    if (use_threads) pthread_join(tid, NULL);
+    else waitpid(pid, NULL, 0);
+    sched_setaffinity(0, sizeof(saved), &saved);
+    close(to_pong[0]); close(to_pong[1]);
+    close(to_ping[0]); close(to_ping[1]);
+
+    // Each round trip = 2 hops (2 context switches when both share a CPU)
+    int n = iterations - warm;
+    double per_hop = (double) (end - start) / (n * 2);
+    printf("[ctxsw] pin=%s mode=%s cpus=%d,%d iters=%d time_ms=%.3f ns_per_%s=%.1f"
+           " rt_p50_ns=%lu rt_p99_ns=%lu\n",
+           pin_names[pin], use_threads ? "thread" : "process", cpu0, cpu1, n,
+           hr_elapsed_ms(start, end), pin == PIN_SAME ? "switch" : "hop", per_hop,
+           (unsigned long) hist_quantile(&h, 0.50), (unsigned long) hist_quantile(&h, 0.99));
+}
+
+int main(int argc, char *argv[]) {
+    int pin = PIN_SAME, mode = 0;       // mode: 0 process, 1 thread, 2 both
+    int all_pins = 0, cpu0 = -1;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strncmp(argv[i], "--pin=", 6)) {
+            if (!strcmp(argv[i] + 6, "all")) { all_pins = 1; continue; }
+            for (pin = 0; pin < PIN_NKINDS && strcmp(argv[i] + 6, pin_names[pin]); pin++)
+                ;
+            if (pin == PIN_NKINDS) { fprintf(stderr, "unknown placement %s\n", argv[i] + 6); exit(1); }
+        } else if (!strcmp(argv[i], "--mode=process")) mode = 0;
+        else if (!strcmp(argv[i], "--mode=thread")) mode = 1;
+        else if (!strcmp(argv[i], "--mode=all")) mode = 2;
+        else if (!strncmp(argv[i], "--iters=", 8)) iterations = atoi(argv[i] + 8);
+        else if (!strncmp(argv[i], "--cpu=", 6)) cpu0 = atoi(argv[i] + 6);
+        else {
+            fprintf(stderr, "usage: %s [--pin=same|smt|core|socket|none|all] [--mode=process|thread|all]"
+                    " [--iters=N] [--cpu=N]\n", argv[0]);
+            exit(1);
+        }
+    }
+    if (iterations < 10) iterations = 10;
+
+    static topo_t topo;
+    if (topo_load(&topo) <= 0) {
+        fprintf(stderr, "can't read CPU topology\n");
+        exit(1);
+    }
+    if (cpu0 < 0) cpu0 = topo.cpu[0].cpu;
+
+    printf("Measuring context switch cost...\n");
+    printf("Running %d context switch tests\n", iterations);
+
+    for (int p = all_pins ? 0 : pin; p <= (all_pins ? PIN_NKINDS - 1 : pin); p++)
+        for (int m = 0; m < 2; m++)
+            if (mode == 2 || mode == m)
+                run(&topo, p, m, cpu0);
     return 0;
-}
\ No newline at end of file
+}
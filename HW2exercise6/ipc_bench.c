@@ -0,0 +1,403 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "../common/hrtime.h"
+#include "../common/histogram.h"
+
+//
+// IPC suite (Linux only): moves messages between two processes four ways.
+//
+//   pipe         write/writev into a pipe, read on the other side (two copies:
+//                user -> pipe buffer -> user)
+//   vmsplice     the writer vmsplices its pages into the pipe instead of
+//                copying them, the reader reads (one copy)
+//   shm-futex    a byte ring in MAP_SHARED memory; the writer copies into it
+//                and the reader works on the bytes in place (one copy), and a
+//                side that has to wait sleeps on a shared futex
+//   shm-eventfd  the same ring, but sleeping and waking go through a pair of
+//                eventfds instead of futexes
+//
+// Two modes, reported separately:
+//
+//   lat  ping-pong of one message each way, per round trip p50/p99 (ns)
+//   bw   one-way stream, GB/s and msgs/s; `batch` messages go out per
+//        writev/vmsplice call, and the shm writer checks for a sleeping
+//        reader only once per batch (it always does before it sleeps itself)
+//
+// The first byte of each message is its sequence number, and the reader
+// checks it, so vmsplice buffer reuse bugs or a lost wakeup show up as
+// WRONG or a hang, not as a fast number.
+//
+// usage: ipc_bench [lat|bw|all] [transport|all] [size|sweep] [batch|sweep] [mb=256]
+//   sweep sizes: 1 64 4K 64K 1M; sweep batches (bw only): 1 16
+//
+
+enum { T_PIPE, T_VMSPLICE, T_SHM_FUTEX, T_SHM_EVENTFD, T_NKINDS };
+static const char *t_names[T_NKINDS] = { "pipe", "vmsplice", "shm-futex", "shm-eventfd" };
+
+#define PIPE_SZ   (1 << 20)         // F_SETPIPE_SZ request (pipe-max-size default)
+#define RING_CAP  (4 << 20)         // shm ring bytes, power of two, >= largest message
+#define SHM_SPIN  2000              // polls before sleeping; 0 on a single CPU
+#define MAX_BATCH 64
+#define MAX_MSGS  (1 << 20)
+
+static const long sweep_sizes[] = { 1, 64, 4096, 65536, 1 << 20 };
+static const int sweep_batches[] = { 1, 16 };
+
+static int shm_spin;
+
+// ---- shared ring -----------------------------------------------------------
+// One writer, one reader. head and tail count bytes ever consumed/produced.
+// A side about to sleep sets its *wait flag and re-checks; the other side
+// bumps the matching seq word and wakes it when it sees the flag.
+typedef struct {
+    uint64_t head __attribute__((aligned(64)));
+    int wwait, wseq;                // writer waiting for space
+    uint64_t tail __attribute__((aligned(64)));
+    int rwait, rseq;                // reader waiting for data
+    int efd_space, efd_data;        // shm-eventfd only, -1 otherwise
+    int pending;                    // writer: messages since last notify
+    char data[] __attribute__((aligned(64)));
+} ring_t;
+
+static ring_t *ring_create(int use_eventfd) {
+    ring_t *r = mmap(NULL, sizeof(ring_t) + RING_CAP, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (r == MAP_FAILED) { perror("mmap"); exit(1); }
+    r->efd_space = r->efd_data = -1;
+    if (use_eventfd) {
+        r->efd_space = eventfd(0, 0);
+        r->efd_data = eventfd(0, 0);
+        if (r->efd_space < 0 || r->efd_data < 0) { perror("eventfd"); exit(1); }
+    }
+    return r;
+}
+
+static void ring_free(ring_t *r) {
+    if (r->efd_space >= 0) { close(r->efd_space); close(r->efd_data); }
+    munmap(r, sizeof(ring_t) + RING_CAP);
+}
+
+// Shared (not _PRIVATE) futex ops: the two sides are different processes.
+static inline void shm_futex_wait(int *addr, int val) {
+    syscall(SYS_futex, addr, FUTEX_WAIT, val, NULL, NULL, 0);
+}
+
+static inline void shm_futex_wake(int *addr) {
+    syscall(SYS_futex, addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+static inline void ring_notify(int *wait, int *seq, int efd) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(wait, __ATOMIC_RELAXED)) return;
+    __atomic_add_fetch(seq, 1, __ATOMIC_SEQ_CST);
+    if (efd >= 0) {
+        uint64_t one = 1;
+        if (write(efd, &one, sizeof(one)) != sizeof(one)) perror("eventfd write");
+    } else {
+        shm_futex_wake(seq);
+    }
+}
+
+// Returns once *word != old.
+static void ring_wait(uint64_t *word, uint64_t old, int *wait, int *seq, int efd) {
+    for (int i = 0; i < shm_spin; i++)
+        if (__atomic_load_n(word, __ATOMIC_ACQUIRE) != old) return;
+    while (__atomic_load_n(word, __ATOMIC_ACQUIRE) == old) {
+        int s = __atomic_load_n(seq, __ATOMIC_SEQ_CST);
+        __atomic_store_n(wait, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(word, __ATOMIC_SEQ_CST) == old) {
+            if (efd >= 0) {
+                uint64_t v;
+                if (read(efd, &v, sizeof(v)) != sizeof(v)) perror("eventfd read");
+            } else {
+                shm_futex_wait(seq, s);
+            }
+        }
+        __atomic_store_n(wait, 0, __ATOMIC_RELAXED);
+    }
+}
+
+static inline void ring_flush(ring_t *r) {
+    r->pending = 0;
+    ring_notify(&r->rwait, &r->rseq, r->efd_data);
+}
+
+// Copies one message in; notifies the reader every `batch` messages.
+static void ring_push(ring_t *r, const char *msg, long size, int batch) {
+    uint64_t tail = r->tail, head;
+    while (RING_CAP - (tail - (head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE))) < (uint64_t) size) {
+        ring_flush(r);              // the reader may be asleep on our unsent notify
+        ring_wait(&r->head, head, &r->wwait, &r->wseq, r->efd_space);
+    }
+    long off = tail & (RING_CAP - 1), first = size < RING_CAP - off ? size : RING_CAP - off;
+    memcpy(r->data + off, msg, first);
+    memcpy(r->data, msg + first, size - first);
+    __atomic_store_n(&r->tail, tail + size, __ATOMIC_RELEASE);
+    if (++r->pending >= batch) ring_flush(r);
+}
+
+// Waits for data, returns how many bytes are readable at head.
+static uint64_t ring_avail(ring_t *r) {
+    uint64_t head = r->head, tail;
+    while ((tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE)) == head)
+        ring_wait(&r->tail, head, &r->rwait, &r->rseq, r->efd_data);
+    return tail - head;
+}
+
+static inline void ring_consume(ring_t *r, uint64_t n) {
+    __atomic_store_n(&r->head, r->head + n, __ATOMIC_RELEASE);
+    ring_notify(&r->wwait, &r->wseq, r->efd_space);
+}
+
+// Copies exactly size bytes out (lat mode).
+static void ring_pop(ring_t *r, char *out, long size) {
+    for (long got = 0; got < size; ) {
+        uint64_t n = ring_avail(r);
+        if (n > (uint64_t) (size - got)) n = size - got;
+        long off = r->head & (RING_CAP - 1), first = (long) n < RING_CAP - off ? (long) n : RING_CAP - off;
+        memcpy(out + got, r->data + off, first);
+        memcpy(out + got + first, r->data, n - first);
+        ring_consume(r, n);
+        got += n;
+    }
+}
+
+// ---- pipe helpers ------------------------------------------------------------
+static int make_pipe(int fd[2]) {
+    if (pipe(fd) < 0) { perror("pipe"); exit(1); }
+    fcntl(fd[1], F_SETPIPE_SZ, PIPE_SZ);            // best effort
+    return fcntl(fd[1], F_GETPIPE_SZ);
+}
+
+static void read_full(int fd, char *buf, long size) {
+    for (long got = 0; got < size; ) {
+        ssize_t n = read(fd, buf + got, size - got);
+        if (n <= 0) { perror("read"); exit(1); }
+        got += n;
+    }
+}
+
+// Sends iov[0..cnt) completely with writev or vmsplice.
+static void send_iov(int fd, struct iovec *iov, int cnt, int use_vmsplice) {
+    while (cnt > 0) {
+        ssize_t n = use_vmsplice ? vmsplice(fd, iov, cnt, 0) : writev(fd, iov, cnt);
+        if (n < 0) { perror(use_vmsplice ? "vmsplice" : "writev"); exit(1); }
+        while (cnt > 0 && (size_t) n >= iov->iov_len) { n -= iov->iov_len; iov++; cnt--; }
+        if (cnt > 0) { iov->iov_base = (char *) iov->iov_base + n; iov->iov_len -= n; }
+    }
+}
+
+// Checks the sequence byte of every message that starts in [pos, pos + n)
+// of the stream; returns the number of bad ones.
+static long check_stream(const char *buf, uint64_t pos, uint64_t n, long size) {
+    long bad = 0;
+    for (uint64_t m = (pos + size - 1) / size * size; m < pos + n; m += size)
+        bad += buf[m - pos] != (char) (m / size);
+    return bad;
+}
+
+static void *page_alloc(size_t bytes) {
+    void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (p == MAP_FAILED) { perror("mmap"); exit(1); }
+    return p;
+}
+
+// ---- latency ---------------------------------------------------------------
+static void run_lat(int t, long size) {
+    int iters = size >= 65536 ? 1000 : 10000, warm = iters / 10;
+    int p1[2], p2[2];
+    ring_t *a = NULL, *b = NULL;
+    if (t == T_PIPE || t == T_VMSPLICE) {
+        make_pipe(p1);
+        make_pipe(p2);
+    } else {
+        a = ring_create(t == T_SHM_EVENTFD);
+        b = ring_create(t == T_SHM_EVENTFD);
+    }
+    // vmsplice'd pages stay referenced until read, so alternate two buffers;
+    // we only rewrite one after the echo of the other has come back.
+    long stride = (size + 4095) & ~4095L;
+    char *buf = page_alloc(2 * stride), *in = buf + stride;
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) { perror("fork"); exit(1); }
+    if (pid == 0) {
+        for (int i = 0; i < iters + warm; i++) {
+            char *msg = (i & 1) ? in : buf;
+            if (a) {
+                ring_pop(a, msg, size);
+                ring_push(b, msg, size, 1);
+            } else {
+                read_full(p1[0], msg, size);
+                struct iovec iov = { msg, size };
+                send_iov(p2[1], &iov, 1, t == T_VMSPLICE);
+            }
+        }
+        _exit(0);
+    }
+
+    hist_t h;
+    hist_init(&h);
+    long bad = 0;
+    char *back = malloc(size);
+    memset(buf, 0, size);
+    for (int i = 0; i < iters + warm; i++) {
+        char *msg = (i & 1) ? in : buf;
+        msg[0] = (char) i;
+        uint64_t s = hr_now_ns();
+        if (a) {
+            ring_push(a, msg, size, 1);
+            ring_pop(b, back, size);
+        } else {
+            struct iovec iov = { msg, size };
+            send_iov(p1[1], &iov, 1, t == T_VMSPLICE);
+            read_full(p2[0], back, size);
+        }
+        uint64_t e = hr_now_ns();
+        if (i >= warm) hist_record(&h, e - s);
+        bad += back[0] != (char) i;
+    }
+    waitpid(pid, NULL, 0);
+
+    printf("[ipc] mode=lat transport=%s size=%ld iters=%d rt_p50_ns=%lu rt_p99_ns=%lu rt_mean_ns=%.0f one_way_ns=%.0f %s\n",
+           t_names[t], size, iters, (unsigned long) hist_quantile(&h, 0.50), (unsigned long) hist_quantile(&h, 0.99),
+           hist_mean(&h), hist_mean(&h) / 2, bad ? "WRONG" : "ok");
+    free(back);
+    munmap(buf, 2 * stride);
+    if (a) { ring_free(a); ring_free(b); }
+    else { close(p1[0]); close(p1[1]); close(p2[0]); close(p2[1]); }
+}
+
+// ---- bandwidth ---------------------------------------------------------------
+static void run_bw(int t, long size, int batch, long mb) {
+    long msgs = mb * (1L << 20) / size;
+    if (msgs > MAX_MSGS) msgs = MAX_MSGS;
+    if (msgs < 16) msgs = 16;
+    uint64_t bytes = (uint64_t) msgs * size;
+    int p[2], pipe_sz = 0;
+    ring_t *r = NULL;
+    if (t == T_PIPE || t == T_VMSPLICE) pipe_sz = make_pipe(p);
+    else r = ring_create(t == T_SHM_EVENTFD);
+
+    // Writer buffers, one page-aligned slot per message. A vmsplice'd slot may
+    // only be rewritten once the reader has drained it, and the pipe can hold
+    // at most pipe_sz / 4096 pages, so rotate through enough slots that a
+    // slot's previous message must have left the pipe.
+    long stride = (size + 4095) & ~4095L;
+    long inflight = t == T_VMSPLICE ? pipe_sz / 4096 / (stride / 4096) + 1 : 0;
+    long nslots = inflight + batch + 1;
+    size_t wbytes = nslots * stride;
+
+    // The fork and both sides' buffer setup stay out of the timed region:
+    // the writer reports ready once its slots are populated, the reader
+    // starts the clock and only then lets it go.
+    int ready[2], go[2];
+    char c = 0;
+    if (pipe(ready) < 0 || pipe(go) < 0) { perror("pipe"); exit(1); }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) { perror("fork"); exit(1); }
+    if (pid == 0) {                 // writer
+        char *w = page_alloc(wbytes);
+        struct iovec iov[MAX_BATCH];
+        if (write(ready[1], &c, 1) != 1 || read(go[0], &c, 1) != 1) _exit(1);
+        long slot = 0;
+        for (long m = 0; m < msgs; ) {
+            int k = 0;
+            for (; k < batch && m < msgs; k++, m++) {
+                char *msg = w + slot * stride;
+                slot = slot + 1 == nslots ? 0 : slot + 1;
+                msg[0] = (char) m;
+                if (r) ring_push(r, msg, size, batch);
+                else iov[k] = (struct iovec) { msg, size };
+            }
+            if (!r) send_iov(p[1], iov, k, t == T_VMSPLICE);
+        }
+        if (r) ring_flush(r);
+        _exit(0);
+    }
+
+    long bad = 0;
+    uint64_t pos = 0, start;
+    long rsize = size * batch > (1 << 20) ? size * batch : (1 << 20);
+    char *rbuf = r ? NULL : page_alloc(rsize);
+    if (!r) close(p[1]);
+    if (read(ready[0], &c, 1) != 1) { fprintf(stderr, "writer failed to start\n"); exit(1); }
+    start = hr_now_ns();
+    if (write(go[1], &c, 1) != 1) { perror("write"); exit(1); }
+    if (r) {
+        while (pos < bytes) {
+            uint64_t n = ring_avail(r), off = pos & (RING_CAP - 1);
+            if (n > RING_CAP - off) n = RING_CAP - off;     // in place, up to the wrap
+            bad += check_stream(r->data + off, pos, n, size);
+            ring_consume(r, n);
+            pos += n;
+        }
+    } else {
+        while (pos < bytes) {
+            ssize_t n = read(p[0], rbuf, rsize);
+            if (n <= 0) { perror("read"); exit(1); }
+            bad += check_stream(rbuf, pos, n, size);
+            pos += n;
+        }
+        munmap(rbuf, rsize);
+    }
+    uint64_t end = hr_now_ns();
+    waitpid(pid, NULL, 0);
+    for (int i = 0; i < 2; i++) { close(ready[i]); close(go[i]); }
+
+    double sec = (end - start) / 1e9;
+    printf("[ipc] mode=bw transport=%s size=%ld batch=%d msgs=%ld bytes=%lu time_ms=%.3f gb_s=%.3f mmsg_s=%.3f %s\n",
+           t_names[t], size, batch, msgs, (unsigned long) bytes, hr_elapsed_ms(start, end),
+           bytes / sec / 1e9, msgs / sec / 1e6, bad ? "WRONG" : "ok");
+    if (r) ring_free(r);
+    else close(p[0]);
+}
+
+int main(int argc, char *argv[]) {
+    const char *mode = argc > 1 ? argv[1] : "all";
+    const char *which = argc > 2 ? argv[2] : "all";
+    const char *size_arg = argc > 3 ? argv[3] : "sweep";
+    const char *batch_arg = argc > 4 ? argv[4] : "sweep";
+    long mb = argc > 5 ? atol(argv[5]) : 256;
+    shm_spin = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SHM_SPIN : 0;
+
+    long one_size = strcmp(size_arg, "sweep") ? atol(size_arg) : 0;
+    int one_batch = strcmp(batch_arg, "sweep") ? atoi(batch_arg) : 0;
+    int nsizes = one_size ? 1 : (int) (sizeof(sweep_sizes) / sizeof(sweep_sizes[0]));
+    int nbatches = one_batch ? 1 : (int) (sizeof(sweep_batches) / sizeof(sweep_batches[0]));
+    if (one_size <= 0 && strcmp(size_arg, "sweep")) { fprintf(stderr, "bad size %s\n", size_arg); exit(1); }
+    if (one_batch < 0 || one_batch > MAX_BATCH || (!one_batch && strcmp(batch_arg, "sweep"))) {
+        fprintf(stderr, "batch must be 1..%d\n", MAX_BATCH);
+        exit(1);
+    }
+    if (one_size > RING_CAP) { fprintf(stderr, "size must be <= %d\n", RING_CAP); exit(1); }
+
+    int lat = !strcmp(mode, "lat") || !strcmp(mode, "all");
+    int bw = !strcmp(mode, "bw") || !strcmp(mode, "all");
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 0 ? !lat : !bw) continue;
+        for (int t = 0; t < T_NKINDS; t++) {
+            if (strcmp(which, "all") && strcmp(which, t_names[t])) continue;
+            for (int s = 0; s < nsizes; s++) {
+                long size = one_size ? one_size : sweep_sizes[s];
+                if (pass == 0) { run_lat(t, size); continue; }
+                for (int b = 0; b < nbatches; b++)
+                    run_bw(t, size, one_batch ? one_batch : sweep_batches[b], mb);
+            }
+        }
+    }
+    return 0;
+}
@@ -1,37 +1,299 @@
+#define _GNU_SOURCE
 #include <stdio.h>
-#include <sys/time.h>
+#include "../common/hrtime.h"
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#ifdef __linux__
+#include <linux/io_uring.h>
+#endif
+
+//
+// System call cost, single calls vs. their batched forms (Linux).
+//
+//   vdso      clock_gettime through the vDSO: no kernel entry at all
+//   raw       the same clock_gettime as a real syscall; raw - vdso is the
+//             mode switch itself
+//   null      read(fd, buf, 0), the cheapest real syscall (the old test)
+//   read      read 64B from /dev/zero     vs   readv of `batch` 64B iovecs
+//   write     write 64B to /dev/null      vs   writev of `batch` iovecs
+//   udp       send+recv one 64B datagram  vs   sendmmsg+recvmmsg of `batch`
+//             (loopback, the socket sends to itself)
+//   uring     `batch` 64B reads from /dev/zero per io_uring_enter
+//   uring-sqpoll
+//             the same with IORING_SETUP_SQPOLL: a kernel thread polls the
+//             SQ and we poll the CQ, so steady state has no syscalls; it
+//             needs a spare CPU for the poller or it loses to plain uring
+//
+// Everything is reported as ns per logical operation (one 64B read, one
+// datagram, ...), so the batched lines divide straight against batch=1.
+// io_uring is driven through the raw syscalls, no liburing needed; if the
+// kernel or sandbox refuses it the test is skipped with the reason.
+//
+// usage: syscall_test [test|all] [batch|sweep] [ops=100000]
+//   sweep batches: 1 4 16 64
+//
+
+#define MSG       64
+#define MAX_BATCH 64
+#define URING_POLLS 10000           // CQ polls before sqpoll mode sleeps on the ring
+
+static const int sweep_batches[] = { 1, 4, 16, 64 };
+
+static char buf[MAX_BATCH][MSG];
+static int zero_fd, null_fd;
+
+static void report(const char *test, int batch, long ops, uint64_t start, uint64_t end) {
+    printf("[syscall] test=%s batch=%d ops=%ld time_ms=%.3f ns_per_op=%.1f\n",
+           test, batch, ops, hr_elapsed_ms(start, end), (double) (end - start) / ops);
+}
+
+// ---- baselines ---------------------------------------------------------------
+static double run_clock(int raw, long ops) {
+    struct timespec ts;
+    uint64_t start = hr_now_ns();
+    for (long i = 0; i < ops; i++) {
+        if (raw) syscall(SYS_clock_gettime, CLOCK_MONOTONIC, &ts);
+        else clock_gettime(CLOCK_MONOTONIC, &ts);
+    }
+    uint64_t end = hr_now_ns();
+    report(raw ? "raw" : "vdso", 1, ops, start, end);
+    return (double) (end - start) / ops;
+}
+
+static void run_null(long ops) {
+    uint64_t start = hr_now_ns();
+    for (long i = 0; i < ops; i++)
+        if (read(zero_fd, buf, 0) < 0) { perror("read"); exit(1); }   // 0-byte read system call
+    report("null", 1, ops, start, hr_now_ns());
+}
+
+// ---- read/readv, write/writev ----------------------------------------------
+static void run_rw(int do_write, int batch, long ops) {
+    struct iovec iov[MAX_BATCH];
+    for (int i = 0; i < batch; i++) iov[i] = (struct iovec) { buf[i], MSG };
+    int fd = do_write ? null_fd : zero_fd;
+    long loops = ops / batch;
+    uint64_t start = hr_now_ns();
+    for (long i = 0; i < loops; i++) {
+        ssize_t n;
+        if (batch == 1) n = do_write ? write(fd, buf[0], MSG) : read(fd, buf[0], MSG);
+        else n = do_write ? writev(fd, iov, batch) : readv(fd, iov, batch);
+        if (n != (ssize_t) MSG * batch) { perror(do_write ? "write" : "read"); exit(1); }
+    }
+    uint64_t end = hr_now_ns();
+    report(batch == 1 ? (do_write ? "write" : "read") : (do_write ? "writev" : "readv"),
+           batch, loops * batch, start, end);
+}
+
+// ---- sendmmsg/recvmmsg -------------------------------------------------------
+static void run_udp(int batch, long ops) {
+    int s = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t len = sizeof(addr);
+    if (s < 0 || bind(s, (struct sockaddr *) &addr, len) < 0 ||
+        getsockname(s, (struct sockaddr *) &addr, &len) < 0 || connect(s, (struct sockaddr *) &addr, len) < 0) {
+        printf("[syscall] test=udp skipped: %s\n", strerror(errno));
+        if (s >= 0) close(s);
+        return;
+    }
+    struct mmsghdr msgs[MAX_BATCH];
+    struct iovec iov[MAX_BATCH];
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < batch; i++) {
+        iov[i] = (struct iovec) { buf[i], MSG };
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    long loops = ops / batch;
+    uint64_t start = hr_now_ns();
+    for (long i = 0; i < loops; i++) {
+        if (batch == 1) {
+            if (send(s, buf[0], MSG, 0) != MSG || recv(s, buf[0], MSG, 0) != MSG) { perror("send/recv"); exit(1); }
+        } else {
+            // Loopback delivers inside sendmmsg, so all `batch` are queued.
+            if (sendmmsg(s, msgs, batch, 0) != batch || recvmmsg(s, msgs, batch, 0, NULL) != batch) {
+                perror("sendmmsg/recvmmsg");
+                exit(1);
+            }
+        }
+    }
+    uint64_t end = hr_now_ns();
+    report(batch == 1 ? "udp" : "udp-mmsg", batch, loops * batch, start, end);
+    close(s);
+}
+
+// ---- io_uring ----------------------------------------------------------------
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+typedef struct {
+    int fd, sqpoll;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_flags, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring, *cq_ring;
+    size_t sq_bytes, cq_bytes, sqe_bytes;
+} uring_t;
+
+static int uring_init(uring_t *u, unsigned entries, int sqpoll) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(u, 0, sizeof(*u));
+    if (sqpoll) {
+        p.flags = IORING_SETUP_SQPOLL;
+        p.sq_thread_idle = 1000;            // ms before the poller sleeps
+    }
+    u->sqpoll = sqpoll;
+    u->fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (u->fd < 0) return -errno;
+
+    u->sq_bytes = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    u->cq_bytes = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        u->sq_bytes = u->cq_bytes = u->sq_bytes > u->cq_bytes ? u->sq_bytes : u->cq_bytes;
+    u->sq_ring = mmap(NULL, u->sq_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+    u->cq_ring = p.features & IORING_FEAT_SINGLE_MMAP ? u->sq_ring :
+        mmap(NULL, u->cq_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_CQ_RING);
+    u->sqe_bytes = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = mmap(NULL, u->sqe_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+    if (u->sq_ring == MAP_FAILED || u->cq_ring == MAP_FAILED || (void *) u->sqes == MAP_FAILED) {
+        close(u->fd);
+        return -ENOMEM;
+    }
+    char *sq = u->sq_ring, *cq = u->cq_ring;
+    u->sq_head = (unsigned *) (sq + p.sq_off.head);
+    u->sq_tail = (unsigned *) (sq + p.sq_off.tail);
+    u->sq_mask = (unsigned *) (sq + p.sq_off.ring_mask);
+    u->sq_flags = (unsigned *) (sq + p.sq_off.flags);
+    u->sq_array = (unsigned *) (sq + p.sq_off.array);
+    u->cq_head = (unsigned *) (cq + p.cq_off.head);
+    u->cq_tail = (unsigned *) (cq + p.cq_off.tail);
+    u->cq_mask = (unsigned *) (cq + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+    for (unsigned i = 0; i < p.sq_entries; i++) u->sq_array[i] = i;
+    return 0;
+}
+
+static void uring_free(uring_t *u) {
+    munmap(u->sqes, u->sqe_bytes);
+    if (u->cq_ring != u->sq_ring) munmap(u->cq_ring, u->cq_bytes);
+    munmap(u->sq_ring, u->sq_bytes);
+    close(u->fd);
+}
+
+static inline int uring_enter(uring_t *u, unsigned submit, unsigned wait, unsigned flags) {
+    return syscall(__NR_io_uring_enter, u->fd, submit, wait, flags, NULL, 0);
+}
+
+// Queues `batch` 64B reads from /dev/zero and waits for all of them.
+// Returns the number of completions that failed.
+static int uring_batch(uring_t *u, int batch) {
+    unsigned tail = *u->sq_tail, mask = *u->sq_mask;
+    for (int i = 0; i < batch; i++) {
+        struct io_uring_sqe *sqe = &u->sqes[(tail + i) & mask];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = zero_fd;
+        sqe->addr = (unsigned long) buf[i];
+        sqe->len = MSG;
+        sqe->user_data = i;
+    }
+    __atomic_store_n(u->sq_tail, tail + batch, __ATOMIC_RELEASE);
+
+    if (!u->sqpoll) {
+        if (uring_enter(u, batch, batch, IORING_ENTER_GETEVENTS) < 0) { perror("io_uring_enter"); exit(1); }
+    } else {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(u->sq_flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP)
+            uring_enter(u, 0, 0, IORING_ENTER_SQ_WAKEUP);
+    }
+
+    int bad = 0, got = 0, polls = 0;
+    unsigned head = *u->cq_head;
+    while (got < batch) {
+        unsigned ctail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+        if (ctail == head) {
+            // sqpoll: poll briefly, then sleep in the kernel so the poller
+            // thread gets a CPU (matters when there is no spare one).
+            if (++polls >= URING_POLLS) uring_enter(u, 0, batch - got, IORING_ENTER_GETEVENTS);
+            continue;
+        }
+        for (; head != ctail; head++, got++)
+            bad += u->cqes[head & *u->cq_mask].res != MSG;
+        __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+    }
+    return bad;
+}
+
+static void run_uring(int sqpoll, int batch, long ops) {
+    const char *name = sqpoll ? "uring-sqpoll" : "uring";
+    uring_t u;
+    int rc = uring_init(&u, MAX_BATCH, sqpoll);
+    if (rc < 0) {
+        printf("[syscall] test=%s skipped: io_uring_setup: %s\n", name, strerror(-rc));
+        return;
+    }
+    if (uring_batch(&u, 1)) {                   // IORING_OP_READ needs 5.6+
+        printf("[syscall] test=%s skipped: IORING_OP_READ not supported\n", name);
+        uring_free(&u);
+        return;
+    }
+    long loops = ops / batch;
+    int bad = 0;
+    uint64_t start = hr_now_ns();
+    for (long i = 0; i < loops; i++)
+        bad += uring_batch(&u, batch);
+    uint64_t end = hr_now_ns();
+    report(name, batch, loops * batch, start, end);
+    if (bad) printf("[syscall] test=%s failed_completions=%d\n", name, bad);
+    uring_free(&u);
+}
+#else
+static void run_uring(int sqpoll, int batch, long ops) {
+    (void) batch; (void) ops;
+    printf("[syscall] test=%s skipped: no io_uring headers\n", sqpoll ? "uring-sqpoll" : "uring");
+}
+#endif
+
+int main(int argc, char *argv[]) {
+    const char *which = argc > 1 ? argv[1] : "all";
+    const char *batch_arg = argc > 2 ? argv[2] : "sweep";
+    long ops = argc > 3 ? atol(argv[3]) : 100000;   // logical operations per test
+    int one_batch = strcmp(batch_arg, "sweep") ? atoi(batch_arg) : 0;
+    if (one_batch < 0 || one_batch > MAX_BATCH || (!one_batch && strcmp(batch_arg, "sweep"))) {
+        fprintf(stderr, "batch must be 1..%d or sweep\n", MAX_BATCH);
+        exit(1);
+    }
+    if (ops < MAX_BATCH) ops = MAX_BATCH;
+
+    zero_fd = open("/dev/zero", O_RDONLY);
+    null_fd = open("/dev/null", O_WRONLY);
+    if (zero_fd < 0 || null_fd < 0) { perror("open"); exit(1); }
 
-int main() {
-    struct timeval start, end;
-    int iterations = 100000;  // Number of test iterations
-    long time_diff;
-    double time_per_call;
-    
     printf("Measuring system call cost...\n");
-    printf("Running %d read() system calls\n", iterations);
-    
-    // Start timing
-    gettimeofday(&start, NULL);
-    
-    // Execute many system calls
-    for (int i = 0; i < iterations; i++) {
-        read(0, NULL, 0);  // 0-byte read system call
-    }
-    
-    // End timing
-    gettimeofday(&end, NULL);
-    
-    // Calculate time difference (in microseconds)
-    time_diff = (end.tv_sec - start.tv_sec) * 1000000 + 
-                (end.tv_usec - start.tv_usec);
-    
-    // Calculate average time per system call
-    time_per_call = (double)time_diff / iterations;
-    
-    printf("Total time: %ld microseconds\n", time_diff);
-    printf("Average time per system call: %.2f microseconds\n", time_per_call);
-    
+#define WANT(name) (!strcmp(which, "all") || !strcmp(which, name))
+    if (WANT("vdso") || WANT("raw")) {
+        double vdso = run_clock(0, ops), raw = run_clock(1, ops);
+        printf("[syscall] test=mode_switch ns_per_op=%.1f\n", raw - vdso);
+    }
+    if (WANT("null")) run_null(ops);
+
+    int nb = one_batch ? 1 : (int) (sizeof(sweep_batches) / sizeof(sweep_batches[0]));
+    for (int b = 0; b < nb; b++) {
+        int batch = one_batch ? one_batch : sweep_batches[b];
+        if (WANT("read")) run_rw(0, batch, ops);
+        if (WANT("write")) run_rw(1, batch, ops);
+        if (WANT("udp")) run_udp(batch, ops);
+        if (WANT("uring")) run_uring(0, batch, ops);
+        if (WANT("uring-sqpoll")) run_uring(1, batch, ops);
+    }
     return 0;
-}
\ No newline at end of file
+}
@@ -1,45 +1,225 @@
 // memory-user.c
 // Allocate and continuously access a given amount of memory.
+//
+// Each pass writes the whole buffer and reports how fast it went. The first
+// pass also pays for the page faults (unless --alloc=populate already did).
+//
+//   --threads=N       split the buffer into N page-aligned slices, one thread
+//                     each, spread over cores/sockets (default 1)
+//   --mode=byte       array[i] = (char)i, one byte at a time (the original loop)
+//   --mode=page       one write per 4KB page: only faults pages in, fastest
+//                     way to reach an RSS target
+//   --mode=memset     libc memset
+//   --mode=simd       16B (SSE2/NEON) or 32B (AVX) vector stores
+//   --mode=nt         non-temporal streaming stores (x86): bypass the cache,
+//                     no read-for-ownership; falls back to simd elsewhere
+//   --alloc=malloc    (default) | mmap (demand faulting) |
+//             populate  mmap(MAP_POPULATE): the kernel faults everything in
+//                       up front, and the time for that is reported
+//   --interval=MS     sleep between passes (default 1000, 0 = back to back)
+//   --passes=N        stop after N passes (default: run for duration_in_seconds,
+//                     or forever)
+//
+// e.g. fill 64GB with 32 threads once: memory-user 65536 --threads=32 --mode=page --passes=1
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "../common/hrtime.h"
+#include "../common/topology.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
-int main(int argc, char *argv[]) {
-    if (argc < 2) {
-        fprintf(stderr, "Usage: %s <memory_in_MB> [duration_in_seconds]\n", argv[0]);
-        return 1;
+enum { MODE_BYTE, MODE_PAGE, MODE_MEMSET, MODE_SIMD, MODE_NT, MODE_NKINDS };
+static const char *mode_names[MODE_NKINDS] = { "byte", "page", "memset", "simd", "nt" };
+
+#define PAGE 4096
+#define MAX_THREADS 1024
+
+typedef struct {
+    char *lo, *hi;
+    size_t off;                 // lo - array, for the byte pattern
+    int mode, pass;
+    int cpu;                    // -1 = don't pin
+} slice_t;
+
+// Vector stores over [p, end); p and end are page aligned, so 64B aligned.
+static void fill_simd(char *p, char *end, int pass, int nt) {
+#if defined(__AVX__)
+    __m256i v = _mm256_set1_epi8((char) pass);
+    if (nt) { for (; p < end; p += 64) { _mm256_stream_si256((__m256i *) p, v); _mm256_stream_si256((__m256i *) (p + 32), v); } _mm_sfence(); return; }
+    for (; p < end; p += 64) { _mm256_store_si256((__m256i *) p, v); _mm256_store_si256((__m256i *) (p + 32), v); }
+#elif defined(__SSE2__)
+    __m128i v = _mm_set1_epi8((char) pass);
+    if (nt) {
+        for (; p < end; p += 64) {
+            _mm_stream_si128((__m128i *) p, v); _mm_stream_si128((__m128i *) (p + 16), v);
+            _mm_stream_si128((__m128i *) (p + 32), v); _mm_stream_si128((__m128i *) (p + 48), v);
+        }
+        _mm_sfence();
+        return;
+    }
+    for (; p < end; p += 64) {
+        _mm_store_si128((__m128i *) p, v); _mm_store_si128((__m128i *) (p + 16), v);
+        _mm_store_si128((__m128i *) (p + 32), v); _mm_store_si128((__m128i *) (p + 48), v);
+    }
+#elif defined(__ARM_NEON)
+    (void) nt;                  // no streaming store in NEON; STNP would need asm
+    uint8x16_t v = vdupq_n_u8((uint8_t) pass);
+    for (; p < end; p += 64) {
+        vst1q_u8((uint8_t *) p, v); vst1q_u8((uint8_t *) (p + 16), v);
+        vst1q_u8((uint8_t *) (p + 32), v); vst1q_u8((uint8_t *) (p + 48), v);
+    }
+#else
+    (void) nt;
+    uint64_t v = 0x0101010101010101ULL * (uint8_t) pass;
+    for (; p < end; p += 8) *(volatile uint64_t *) p = v;
+#endif
+}
+
+static void *touch(void *arg) {
+    slice_t *s = (slice_t *) arg;
+    if (s->cpu >= 0) topo_pin_self(s->cpu);
+    char *p = s->lo;
+    switch (s->mode) {
+    case MODE_BYTE: {
+        // Touch each byte to ensure physical allocation
+        size_t n = s->hi - s->lo;
+        for (size_t i = 0; i < n; i++) p[i] = (char) (s->off + i);
+        break;
+    }
+    case MODE_PAGE:
+        for (; p < s->hi; p += PAGE) *(volatile char *) p = (char) s->pass;
+        break;
+    case MODE_MEMSET:
+        memset(p, s->pass, s->hi - p);
+        break;
+    case MODE_SIMD:
+    case MODE_NT:
+        fill_simd(p, s->hi, s->pass, s->mode == MODE_NT);
+        break;
+    }
+    return NULL;
+}
+
+static long rss_mb(void) {
+    FILE *f = fopen("/proc/self/statm", "r");
+    long size, res = -1;
+    if (f) {
+        if (fscanf(f, "%ld %ld", &size, &res) != 2) res = -1;
+        fclose(f);
     }
+    return res < 0 ? -1 : res * (sysconf(_SC_PAGESIZE) / 1024) / 1024;
+}
 
-    int megabytes = atoi(argv[1]);
-    int duration = (argc >= 3) ? atoi(argv[2]) : -1;  // -1 = run forever
+int main(int argc, char *argv[]) {
+    int megabytes = 0, duration = -1;  // -1 = run forever
+    int threads = 1, mode = MODE_BYTE, alloc = 0, interval_ms = 1000, passes = -1;
+
+    for (int i = 1, pos = 0; i < argc; i++) {
+        const char *a = argv[i];
+        if (!strncmp(a, "--threads=", 10)) threads = atoi(a + 10);
+        else if (!strncmp(a, "--mode=", 7)) {
+            for (mode = 0; mode < MODE_NKINDS && strcmp(a + 7, mode_names[mode]); mode++)
+                ;
+            if (mode == MODE_NKINDS) { fprintf(stderr, "Error: unknown mode %s\n", a + 7); return 1; }
+        }
+        else if (!strcmp(a, "--alloc=malloc")) alloc = 0;
+        else if (!strcmp(a, "--alloc=mmap")) alloc = 1;
+        else if (!strcmp(a, "--alloc=populate")) alloc = 2;
+        else if (!strncmp(a, "--interval=", 11)) interval_ms = atoi(a + 11);
+        else if (!strncmp(a, "--passes=", 9)) passes = atoi(a + 9);
+        else if (a[0] == '-' && a[1] == '-') { fprintf(stderr, "Error: unknown option %s\n", a); return 1; }
+        else if (pos++ == 0) megabytes = atoi(a);
+        else duration = atoi(a);
+    }
     if (megabytes <= 0) {
-        fprintf(stderr, "Error: memory size must be positive\n");
+        fprintf(stderr, "Usage: %s <memory_in_MB> [duration_in_seconds] [--threads=N]\n"
+                "       [--mode=byte|page|memset|simd|nt] [--alloc=malloc|mmap|populate]\n"
+                "       [--interval=ms] [--passes=N]\n", argv[0]);
         return 1;
     }
+    if (threads < 1 || threads > MAX_THREADS) {
+        fprintf(stderr, "Error: threads must be 1..%d\n", MAX_THREADS);
+        return 1;
+    }
+#if !defined(__SSE2__)
+    if (mode == MODE_NT) fprintf(stderr, "note: no streaming stores on this target, nt = simd\n");
+#endif
 
     size_t bytes = (size_t)megabytes * 1024 * 1024;
-    char *array = malloc(bytes);
+    uint64_t t0 = hr_now_ns();
+    char *array;
+    if (alloc == 0) {
+        // Page aligned so slices and vector stores line up.
+        if (posix_memalign((void **) &array, PAGE, bytes) != 0) array = NULL;
+    } else {
+        array = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | (alloc == 2 ? MAP_POPULATE : 0), -1, 0);
+        if (array == MAP_FAILED) array = NULL;
+    }
     if (!array) {
-        perror("malloc");
+        perror(alloc ? "mmap" : "malloc");
         return 1;
     }
+    uint64_t t1 = hr_now_ns();
 
     printf("Using %d MB of memory...\n", megabytes);
+    printf("[alloc] kind=%s time_ms=%.3f rss_mb=%ld\n",
+           alloc == 0 ? "malloc" : alloc == 1 ? "mmap" : "populate", hr_elapsed_ms(t0, t1), rss_mb());
 
-    int seconds = 0;
-    while (1) {
-        // Touch each byte to ensure physical allocation
-        for (size_t i = 0; i < bytes; i++) {
-            array[i] = (char)(i % 256);
+    // Slices are whole pages; spread threads one per core before doubling
+    // up on hyperthreads.
+    static topo_t topo;
+    static topo_cpu_t order[TOPO_MAX_CPUS];
+    int pin = threads > 1 && topo_load(&topo) > 0;
+    if (pin) topo_order(&topo, PLACE_SCATTER, order);
+    slice_t *sl = malloc(sizeof(slice_t) * threads);
+    pthread_t *tid = malloc(sizeof(pthread_t) * threads);
+    size_t npages = bytes / PAGE;
+    for (int t = 0; t < threads; t++) {
+        sl[t].lo = array + npages * t / threads * PAGE;
+        sl[t].hi = t == threads - 1 ? array + bytes : array + npages * (t + 1) / threads * PAGE;
+        sl[t].off = sl[t].lo - array;
+        sl[t].mode = mode;
+        sl[t].cpu = pin ? order[t % topo.n].cpu : -1;
+    }
+
+    uint64_t run_start = hr_now_ns();
+    for (int pass = 1; passes < 0 || pass <= passes; pass++) {
+        uint64_t s = hr_now_ns();
+        for (int t = 0; t < threads; t++) {
+            sl[t].pass = pass;
+            if (threads == 1) touch(&sl[t]);
+            else pthread_create(&tid[t], NULL, touch, &sl[t]);
         }
+        if (threads > 1)
+            for (int t = 0; t < threads; t++) pthread_join(tid[t], NULL);
+        uint64_t e = hr_now_ns();
+
+        // Rate is against the whole buffer, so for page mode it is pages
+        // covered per second (x 4KB), not bytes written.
+        double sec = (e - s) / 1e9;
+        printf("[pass %d] mode=%s threads=%d bytes=%zu time_ms=%.3f gb_s=%.2f rss_mb=%ld\n",
+               pass, mode_names[mode], threads, bytes, hr_elapsed_ms(s, e), bytes / sec / 1e9, rss_mb());
+        fflush(stdout);
 
-        sleep(1);
-        seconds++;
-        if (duration > 0 && seconds >= duration) break;
+        if (duration > 0 && (hr_now_ns() - run_start) / 1000000000ULL >= (uint64_t) duration) break;
+        if (interval_ms > 0 && (passes < 0 || pass < passes)) usleep(interval_ms * 1000);
     }
 
-    free(array);
+    if (alloc == 0) free(array);
+    else munmap(array, bytes);
+    free(sl);
+    free(tid);
     printf("Done. Freed %d MB.\n", megabytes);
     return 0;
 }
@@ -0,0 +1,127 @@
+// vector-bench.c
+// Build, read back and destroy many vectors of n ints each, with the original
+// Vector (capacity 2, doubling realloc) and the one in vector.h. n runs 1,
+// VEC_INLINE/2 and VEC_INLINE (vectors that never leave the inline buffer),
+// then 10, 100, ... up to max_n:
+//
+//   legacy      the original init/push/destroy
+//   push        vec_push, 1.5x growth, inline buffer for the first VEC_INLINE
+//   push-2x     vec_push with growth_pct = 200, to separate the two effects
+//   reserve     vec_reserve(n) then vec_push: one allocation
+//   push_n      vec_push_n of the whole source in one memcpy
+//
+// Every size builds about `total` elements in all (at least one vector), so
+// short vectors are measured over many construct/destroy cycles.
+//
+// usage: vector-bench [max_n=10000000] [total=10000000]
+//   max_n up to 100000000 (400MB per vector)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../common/hrtime.h"
+#include "vector.h"
+
+// The original vector.c, unchanged apart from the names.
+typedef struct {
+    int *data;
+    int size;
+    int capacity;
+} LegacyVector;
+
+static void legacy_init(LegacyVector *v) {
+    v->size = 0;
+    v->capacity = 2;
+    v->data = malloc(v->capacity * sizeof(int));
+}
+
+static void legacy_push(LegacyVector *v, int value) {
+    if (v->size == v->capacity) {
+        v->capacity *= 2;
+        v->data = realloc(v->data, v->capacity * sizeof(int));
+    }
+    v->data[v->size++] = value;
+}
+
+static void legacy_destroy(LegacyVector *v) {
+    free(v->data);
+    v->data = NULL;
+    v->size = 0;
+    v->capacity = 0;
+}
+
+enum { IMPL_LEGACY, IMPL_PUSH, IMPL_PUSH2X, IMPL_RESERVE, IMPL_PUSHN, IMPL_NKINDS };
+static const char *impl_names[IMPL_NKINDS] = { "legacy", "push", "push-2x", "reserve", "push_n" };
+
+// Builds one vector of n elements and returns the sum of what it holds.
+static long build_one(int impl, const int *src, size_t n) {
+    long sum = 0;
+    if (impl == IMPL_LEGACY) {
+        LegacyVector v;
+        legacy_init(&v);
+        for (size_t i = 0; i < n; i++) legacy_push(&v, src[i]);
+        for (int i = 0; i < v.size; i++) sum += v.data[i];
+        legacy_destroy(&v);
+        return sum;
+    }
+    Vector v;
+    vec_init(&v);
+    switch (impl) {
+    case IMPL_PUSH2X:
+        vec_set_growth(&v, 200);
+        // fall through
+    case IMPL_PUSH:
+        for (size_t i = 0; i < n; i++) vec_push(&v, src[i]);
+        break;
+    case IMPL_RESERVE:
+        if (vec_reserve(&v, n) != 0) { fprintf(stderr, "out of memory\n"); exit(1); }
+        for (size_t i = 0; i < n; i++) vec_push(&v, src[i]);
+        break;
+    case IMPL_PUSHN:
+        if (vec_push_n(&v, src, n) != 0) { fprintf(stderr, "out of memory\n"); exit(1); }
+        break;
+    }
+    for (size_t i = 0; i < v.size; i++) sum += v.data[i];
+    vec_destroy(&v);
+    return sum;
+}
+
+// Sweep step: 1 -> VEC_INLINE/2 -> VEC_INLINE, then the next power of ten.
+static size_t next_n(size_t n) {
+    if (n < VEC_INLINE / 2) return VEC_INLINE / 2;
+    if (n < VEC_INLINE) return VEC_INLINE;
+    size_t p = 10;
+    while (p <= n) p *= 10;
+    return p;
+}
+
+int main(int argc, char *argv[]) {
+    size_t max_n = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+    size_t total = argc > 2 ? strtoull(argv[2], NULL, 10) : 10000000;
+    if (max_n < 10 || max_n > 100000000 || total < 1) {
+        fprintf(stderr, "usage: %s [max_n=10000000 (10..100000000)] [total=10000000]\n", argv[0]);
+        return 1;
+    }
+
+    int *src = malloc(max_n * sizeof(int));
+    if (!src) { perror("malloc"); return 1; }
+    for (size_t i = 0; i < max_n; i++) src[i] = (int) (i * 7 + 1);
+
+    printf("VEC_INLINE=%d VEC_GROWTH_PCT=%d\n", VEC_INLINE, VEC_GROWTH_PCT);
+    for (size_t n = 1; n <= max_n; n = next_n(n)) {
+        size_t reps = total / n ? total / n : 1;
+        long want = 0;
+        for (size_t i = 0; i < n; i++) want += src[i];
+        for (int impl = 0; impl < IMPL_NKINDS; impl++) {
+            long bad = 0;
+            uint64_t s = hr_now_ns();
+            for (size_t r = 0; r < reps; r++) bad += build_one(impl, src, n) != want;
+            uint64_t e = hr_now_ns();
+            printf("[vec] impl=%s n=%zu vectors=%zu time_ms=%.3f ns_per_vec=%.1f ns_per_elem=%.3f%s\n",
+                   impl_names[impl], n, reps, hr_elapsed_ms(s, e), (double) (e - s) / reps,
+                   (double) (e - s) / ((double) reps * n), bad ? " CHECKSUM MISMATCH" : "");
+            fflush(stdout);
+        }
+    }
+    free(src);
+    return 0;
+}
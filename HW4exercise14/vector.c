@@ -1,49 +1,31 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include "vector.h"
 
-typedef struct {
-    int *data;      // pointer to the array
-    int size;       // current number of elements
-    int capacity;   // total allocated capacity
-} Vector;
-
-// initialize the vector
-void init(Vector *v) {
-    v->size = 0;
-    v->capacity = 2;
-    v->data = malloc(v->capacity * sizeof(int));
-}
-
-// add an element (auto expand if full)
-void push(Vector *v, int value) {
-    if (v->size == v->capacity) {
-        v->capacity *= 2;
-        v->data = realloc(v->data, v->capacity * sizeof(int));
-    }
-    v->data[v->size++] = value;
-}
-
-// free the memory
-void destroy(Vector *v) {
-    free(v->data);
-    v->data = NULL;
-    v->size = 0;
-    v->capacity = 0;
-}
+// The Vector itself (inline storage, growth policy, reserve/push_n/shrink)
+// is in vector.h; vector-bench.c compares it with the original version.
 
 int main(void) {
     Vector v;
-    init(&v);
+    vec_init(&v);
 
     for (int i = 0; i < 10; i++) {
-        push(&v, i * 10);
+        vec_push(&v, i * 10);
     }
 
-    for (int i = 0; i < v.size; i++) {
+    for (size_t i = 0; i < v.size; i++) {
         printf("%d ", v.data[i]);
     }
     printf("\n");
 
-    destroy(&v);
+    // bulk append and shrink back to size
+    int more[] = { 100, 110, 120 };
+    if (vec_push_n(&v, more, 3) != 0 || vec_shrink(&v) != 0) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    printf("size=%zu capacity=%zu\n", v.size, v.capacity);
+
+    vec_destroy(&v);
     return 0;
 }
@@ -0,0 +1,137 @@
+#ifndef __vector_h__
+#define __vector_h__
+
+// Growable array of ints.
+//
+//   Vector v;
+//   vec_init(&v);                  // no malloc: starts on the inline buffer
+//   vec_reserve(&v, n);            // make room for n elements, one allocation
+//   vec_push(&v, x);
+//   vec_push_n(&v, src, n);        // append n elements with one memcpy
+//   vec_shrink(&v);                // give back unused capacity
+//   vec_destroy(&v);
+//
+// Short vectors (up to VEC_INLINE elements) live in a buffer inside the
+// struct, so building one costs no malloc at all. Past that the capacity
+// grows by growth_pct percent (VEC_GROWTH_PCT, 150 by default, settable per
+// vector with vec_set_growth). With 1.5x the blocks freed by earlier
+// reallocs add up to more than the next request sooner, so the allocator
+// can reuse them; 2x (the old policy) never can.
+//
+// Functions that allocate return 0, or -1 if malloc/realloc failed; the
+// vector is then left as it was. vec_push aborts instead, like the old push
+// would have crashed, since nobody checks a push.
+//
+// data may point into the struct itself: don't copy a Vector by value,
+// pass it around by pointer.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef VEC_INLINE
+#define VEC_INLINE 8
+#endif
+#ifndef VEC_GROWTH_PCT
+#define VEC_GROWTH_PCT 150
+#endif
+
+typedef struct {
+    int *data;              // inline_buf or a heap block
+    size_t size;            // current number of elements
+    size_t capacity;        // total allocated capacity
+    int growth_pct;         // new capacity = capacity * growth_pct / 100
+    int inline_buf[VEC_INLINE];
+} Vector;
+
+static inline void vec_init(Vector *v) {
+    v->data = v->inline_buf;
+    v->size = 0;
+    v->capacity = VEC_INLINE;
+    v->growth_pct = VEC_GROWTH_PCT;
+}
+
+static inline void vec_set_growth(Vector *v, int pct) {
+    v->growth_pct = pct > 100 ? pct : 101;
+}
+
+// Moves the elements into a block of exactly cap elements (cap >= size).
+static inline int vec_realloc_(Vector *v, size_t cap) {
+    int *p;
+    if (cap <= VEC_INLINE) {
+        if (v->data == v->inline_buf) return 0;
+        memcpy(v->inline_buf, v->data, v->size * sizeof(int));
+        free(v->data);
+        v->data = v->inline_buf;
+        v->capacity = VEC_INLINE;
+        return 0;
+    }
+    if (cap > (size_t) -1 / sizeof(int)) return -1;
+    if (v->data == v->inline_buf) {
+        if ((p = malloc(cap * sizeof(int))) == NULL) return -1;
+        memcpy(p, v->inline_buf, v->size * sizeof(int));
+    } else if ((p = realloc(v->data, cap * sizeof(int))) == NULL) {
+        return -1;
+    }
+    v->data = p;
+    v->capacity = cap;
+    return 0;
+}
+
+// Room for at least n elements in total.
+static inline int vec_reserve(Vector *v, size_t n) {
+    return n <= v->capacity ? 0 : vec_realloc_(v, n);
+}
+
+// Room for `more` elements past size, growing by the growth factor.
+static inline int vec_grow_(Vector *v, size_t more) {
+    size_t need = v->size + more;
+    if (need < v->size) return -1;
+    if (need <= v->capacity) return 0;
+    size_t cap = v->capacity / 100 * v->growth_pct + v->capacity % 100 * v->growth_pct / 100;
+    if (cap <= v->capacity) cap = v->capacity + 1;
+    return vec_realloc_(v, cap > need ? cap : need);
+}
+
+// Kept out of line so the push loop stays small.
+static __attribute__((noinline)) void vec_push_slow_(Vector *v) {
+    if (vec_grow_(v, 1) != 0) {
+        fprintf(stderr, "vec_push: out of memory at %zu elements\n", v->size);
+        abort();
+    }
+}
+
+static inline void vec_push(Vector *v, int value) {
+    if (__builtin_expect(v->size == v->capacity, 0)) vec_push_slow_(v);
+    v->data[v->size++] = value;
+}
+
+static inline int vec_push_n(Vector *v, const int *src, size_t n) {
+    if (vec_grow_(v, n) != 0) return -1;
+    memcpy(v->data + v->size, src, n * sizeof(int));
+    v->size += n;
+    return 0;
+}
+
+// w may be v itself: grow first, then read w->data.
+static inline int vec_append(Vector *v, const Vector *w) {
+    size_t n = w->size;
+    if (vec_grow_(v, n) != 0) return -1;
+    memcpy(v->data + v->size, w->data, n * sizeof(int));
+    v->size += n;
+    return 0;
+}
+
+// Capacity down to size (or back onto the inline buffer).
+static inline int vec_shrink(Vector *v) {
+    return v->size == v->capacity ? 0 : vec_realloc_(v, v->size);
+}
+
+static inline void vec_destroy(Vector *v) {
+    if (v->data != v->inline_buf) free(v->data);
+    v->data = NULL;
+    v->size = 0;
+    v->capacity = 0;
+}
+
+#endif // __vector_h__
@@ -2,6 +2,9 @@
 
 # Bash script to test TLB size by running tlb program with increasing page counts
 
+# Build if needed (the flusher threads need -pthread; keep -O0, see Q3)
+[ tlb -nt tlb.c ] || gcc -o tlb tlb.c -O0 -pthread || exit 1
+
 # Output file for results
 OUTPUT="tlb_results.txt"
 
@@ -28,4 +31,55 @@ cat $OUTPUT
 
 # Optional: Create a simple visualization
 echo ""
-echo "Look for jumps in access time to identify TLB sizes"
\ No newline at end of file
+echo "Look for jumps in access time to identify TLB sizes"
+
+# ---------------------------------------------------------------------------
+# Sweep: access order x page size, then shootdown pressure.
+# Goes further than the test above (up to 256MB) so the second-level TLB
+# overflows for 4KB pages; the trial count shrinks with the page count to
+# keep each run at about BUDGET accesses. Each configuration gets its own
+# tlb_results_<order>_<pages>.txt in the same two-column format, so
+# plot_tlb.py works on any of them (copy it to tlb_results.txt first).
+# SWEEP=0 skips this part.
+# ---------------------------------------------------------------------------
+[ "${SWEEP:-1}" = 0 ] && exit 0
+
+BUDGET=${BUDGET:-100000000}
+SWEEP_PAGES="1 4 16 64 256 1024 2048 4096 8192 16384 32768 65536"
+
+run_sweep() {   # run_sweep <outfile> <tlb options...>
+    local out=$1; shift
+    > $out
+    for PAGES in $SWEEP_PAGES
+    do
+        local trials=$(( BUDGET / PAGES ))
+        [ $trials -lt 10 ] && trials=10
+        if ! ./tlb $PAGES $trials "$@" >> $out 2>/dev/null; then
+            echo "  $* not available here (see ./tlb $PAGES 1 $*)"
+            rm -f $out
+            return
+        fi
+    done
+    echo "  $out"
+}
+
+echo ""
+echo "Sweeping access order x page size..."
+for ORDER in seq random chase
+do
+    for PSIZE in 4k thp 2m
+    do
+        run_sweep tlb_results_${ORDER}_${PSIZE}.txt --order=$ORDER --pages=$PSIZE
+    done
+done
+
+echo ""
+echo "Sweeping shootdown pressure (chase order, 4KB pages)..."
+for THREADS in 2 4
+do
+    run_sweep tlb_results_shootdown_${THREADS}.txt --order=chase --threads=$THREADS
+done
+
+echo ""
+echo "Compare chase_4k against chase_thp/chase_2m past ~1536 pages: that gap is the"
+echo "page-walk cost huge pages remove."
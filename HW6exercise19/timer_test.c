@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <sys/time.h>
+#include "../common/hrtime.h"
 
 int main() {
     struct timeval start, end;
@@ -25,6 +26,22 @@ int main() {
     printf("Minimum detectable time: %ld microseconds\n", min_diff);
     printf("This is approximately: %ld nanoseconds\n\n", min_diff * 1000);
     
+    // Same test for the clocks in common/hrtime.h that tlb.c now uses
+    printf("Testing clock_gettime(CLOCK_MONOTONIC_RAW) precision...\n");
+    printf("Minimum detectable time: %llu nanoseconds\n\n",
+           (unsigned long long)hr_clock_granularity_ns(samples));
+    
+    printf("Testing cycle counter precision...\n");
+    uint64_t min_ticks = UINT64_MAX;
+    for (int i = 0; i < samples; i++) {
+        uint64_t t0 = hr_ticks(), t1 = hr_ticks_end();
+        if (t1 > t0 && t1 - t0 < min_ticks) {
+            min_ticks = t1 - t0;
+        }
+    }
+    printf("Back-to-back reads: %llu ticks = %.1f nanoseconds (%.3f ns/tick)\n\n",
+           (unsigned long long)min_ticks, hr_ticks_to_ns(min_ticks), hr_ns_per_tick());
+    
     // Test 2: How many iterations needed for reliable measurement
     printf("For TLB measurement (5-70 ns per access):\n");
     long target_time_us = 10000;  // Target: 10ms for reliable measurement
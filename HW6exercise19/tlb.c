@@ -1,9 +1,42 @@
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/time.h>
+#include <string.h>
+#include "../common/hrtime.h"
+#include "../common/perfctr.h"
 #include <unistd.h>
 #include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+//
+// Options (after <num_pages> <num_trials>):
+//
+//   --order=seq      a[i] += 1 one page after another (the original loop;
+//                    the prefetcher runs ahead of it)
+//   --order=random   the same pages in a fixed shuffled order
+//   --order=chase    each page holds the index of the next one in a random
+//                    cycle, so every access waits for the previous load:
+//                    nothing to prefetch, pure miss latency
+//   --pages=4k       malloc, normal pages (default)
+//   --pages=thp      mmap + madvise(MADV_HUGEPAGE), 2MB aligned
+//   --pages=2m|1g    mmap(MAP_HUGETLB) from the hugetlbfs pool; needs
+//                    /proc/sys/vm/nr_hugepages (or the 1GB pool) set up
+//   --stride=BYTES   distance between accesses (default: the base page size);
+//                    use 2097152 to walk one access per 2MB page
+//   --threads=N      N-1 extra threads on other CPUs keep mmap/touch/munmap-ing
+//                    a page of their own, so every munmap sends a TLB
+//                    shootdown to all CPUs running this process, ours included
+//   --perf           count cycles, instructions, dTLB/LLC misses and HITM
+//                    around the timed loop (measuring thread only)
+//
+// stdout stays "<num_pages> <ns_per_access>" for plot_tlb.py; anything else
+// (THP coverage, shootdown rate, counters) goes to stderr.
+//
 
 // Pin current thread to a specific CPU core (Linux)
 void pin_to_core(int core_id) {
@@ -15,60 +48,202 @@ void pin_to_core(int core_id) {
     }
 }
 
+enum { ORDER_SEQ, ORDER_RANDOM, ORDER_CHASE };
+enum { PAGES_4K, PAGES_THP, PAGES_2M, PAGES_1G };
+
+volatile int stop_flushers = 0;
+long flushes[64];
+
+// Background thread for --threads: each munmap of a page this process has
+// touched must invalidate it on every CPU in our mm, i.e. an IPI to the
+// measuring thread's CPU.
+void *flusher(void *arg) {
+    long id = (long) arg;
+    long n = 0;
+    pin_to_core(id % sysconf(_SC_NPROCESSORS_ONLN));
+    while (!stop_flushers) {
+        char *p = mmap(NULL, 4096, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) break;
+        p[0] = 1;
+        munmap(p, 4096);
+        n++;
+    }
+    flushes[id] = n;
+    return NULL;
+}
+
+// AnonHugePages of this process, from /proc/self/smaps_rollup (kB, -1 if unknown)
+long thp_kb(void) {
+    FILE *f = fopen("/proc/self/smaps_rollup", "r");
+    char line[256];
+    long kb = -1;
+    if (!f) return -1;
+    while (fgets(line, sizeof(line), f))
+        if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1) break;
+    fclose(f);
+    return kb;
+}
+
 int main(int argc, char *argv[]) {
     // Pin to core 0 immediately
     pin_to_core(0);
-    
+
     // Check arguments
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s <num_pages> <num_trials>\n", argv[0]);
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <num_pages> <num_trials> [--order=seq|random|chase]"
+                " [--pages=4k|thp|2m|1g] [--stride=BYTES] [--threads=N] [--perf]\n", argv[0]);
         return 1;
     }
-    
+
     int NUMPAGES = atoi(argv[1]);
     int trials = atoi(argv[2]);
     int PAGESIZE = getpagesize();  // Typically 4096 bytes
-    
+    int order = ORDER_SEQ, pages = PAGES_4K, threads = 1, use_perf = 0;
+    long stride = PAGESIZE;
+
+    for (int i = 3; i < argc; i++) {
+        if (!strcmp(argv[i], "--order=seq")) order = ORDER_SEQ;
+        else if (!strcmp(argv[i], "--order=random")) order = ORDER_RANDOM;
+        else if (!strcmp(argv[i], "--order=chase")) order = ORDER_CHASE;
+        else if (!strcmp(argv[i], "--pages=4k")) pages = PAGES_4K;
+        else if (!strcmp(argv[i], "--pages=thp")) pages = PAGES_THP;
+        else if (!strcmp(argv[i], "--pages=2m")) pages = PAGES_2M;
+        else if (!strcmp(argv[i], "--pages=1g")) pages = PAGES_1G;
+        else if (!strncmp(argv[i], "--stride=", 9)) stride = atol(argv[i] + 9);
+        else if (!strncmp(argv[i], "--threads=", 10)) threads = atoi(argv[i] + 10);
+        else if (!strcmp(argv[i], "--perf")) use_perf = 1;
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (stride < (long) sizeof(int) || threads < 1 || threads > 64) {
+        fprintf(stderr, "bad --stride or --threads\n");
+        return 1;
+    }
+
     // Allocate array
-    int jump = PAGESIZE / sizeof(int);  // Number of ints per page
-    int array_size = NUMPAGES * jump;
-    int *a = (int *)malloc(array_size * sizeof(int));
-    
+    long jump = stride / sizeof(int);  // Number of ints per page
+    long array_size = (long) NUMPAGES * jump;
+    size_t bytes = array_size * sizeof(int);
+    int *a = NULL;
+    void *base = NULL;       // mmap'd region (thp, 2m, 1g)
+    size_t map_bytes = 0;
+    if (pages == PAGES_4K) {
+        a = (int *)malloc(bytes);
+    } else if (pages == PAGES_THP) {
+        // Over-allocate so the array can start on a 2MB boundary.
+        size_t huge = 2UL << 20;
+        map_bytes = (bytes + 2 * huge - 1) & ~(huge - 1);
+        char *p = mmap(NULL, map_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p != MAP_FAILED) {
+            base = p;
+            a = (int *) (((unsigned long) p + huge - 1) & ~(huge - 1));
+            if (madvise(a, bytes, MADV_HUGEPAGE) != 0) perror("madvise(MADV_HUGEPAGE)");
+        }
+    } else {
+        int shift = pages == PAGES_2M ? 21 : 30;
+        size_t huge = 1UL << shift;
+        map_bytes = (bytes + huge - 1) & ~(huge - 1);
+        void *p = mmap(NULL, map_bytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (shift << MAP_HUGE_SHIFT), -1, 0);
+        if (p == MAP_FAILED) {
+            perror("mmap(MAP_HUGETLB)");
+            fprintf(stderr, "reserve pages first, e.g. echo 512 > /proc/sys/vm/nr_hugepages\n");
+            return 1;
+        }
+        base = a = p;
+    }
+
     if (a == NULL) {
         fprintf(stderr, "Memory allocation failed\n");
         return 1;
     }
-    
+
     // Initialize array to avoid demand zeroing overhead
-    for (int i = 0; i < array_size; i += jump) {
+    for (long i = 0; i < array_size; i += jump) {
         a[i] = 0;
     }
-    
-    struct timeval start, end;
-    
+
+    // Visiting order. For chase the permutation is turned into a cycle
+    // stored in the pages themselves: a[perm[k] * jump] = perm[k + 1].
+    int *perm = malloc(sizeof(int) * NUMPAGES);
+    for (int i = 0; i < NUMPAGES; i++) perm[i] = i;
+    if (order != ORDER_SEQ) {
+        srand(5600);
+        for (int i = NUMPAGES - 1; i > 0; i--) {
+            int j = rand() % (i + 1), t = perm[i];
+            perm[i] = perm[j];
+            perm[j] = t;
+        }
+    }
+    if (order == ORDER_CHASE)
+        for (int i = 0; i < NUMPAGES; i++)
+            a[perm[i] * jump] = perm[(i + 1) % NUMPAGES];
+
+    if (pages == PAGES_THP)
+        fprintf(stderr, "thp: AnonHugePages %ld kB of %zu kB\n", thp_kb(), bytes / 1024);
+
+    // Without inherit: the flushers' cycles and misses stay out, so the
+    // per-op figures are this thread's accesses only.
+    perfctr_t pc;
+    if (use_perf) perf_open_self(&pc);
+
+    pthread_t tids[64];
+    for (long i = 1; i < threads; i++)
+        pthread_create(&tids[i], NULL, flusher, (void *) i);
+
     // Start timing
-    gettimeofday(&start, NULL);
-    
+    if (use_perf) perf_start(&pc);
+    uint64_t start = hr_now_ns();
+
     // Main measurement loop
+    int p = perm[0];
     for (int t = 0; t < trials; t++) {
-        for (int i = 0; i < NUMPAGES * jump; i += jump) {
-            a[i] += 1;  // Access one int per page
+        if (order == ORDER_SEQ) {
+            for (long i = 0; i < array_size; i += jump) {
+                a[i] += 1;  // Access one int per page
+            }
+        } else if (order == ORDER_RANDOM) {
+            for (int i = 0; i < NUMPAGES; i++) {
+                a[perm[i] * jump] += 1;
+            }
+        } else {
+            for (int i = 0; i < NUMPAGES; i++) {
+                p = a[p * jump];
+            }
         }
     }
-    
+
     // End timing
-    gettimeofday(&end, NULL);
-    
-    // Calculate elapsed time in microseconds
-    long elapsed_usec = (end.tv_sec - start.tv_sec) * 1000000L + 
-                        (end.tv_usec - start.tv_usec);
-    
+    uint64_t end = hr_now_ns();
+    if (use_perf) perf_stop(&pc);
+
+    stop_flushers = 1;
+    long total_flushes = 0;
+    for (long i = 1; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+        total_flushes += flushes[i];
+    }
+    if (threads > 1)
+        fprintf(stderr, "shootdown: %d flusher threads, %.0f munmaps/s\n",
+                threads - 1, total_flushes / ((end - start) / 1e9));
+
     // Convert to nanoseconds per access (use double to avoid overflow)
     double total_accesses = (double)trials * (double)NUMPAGES;
-    double ns_per_access = (elapsed_usec * 1000.0) / total_accesses;
-    
+    double ns_per_access = (double)(end - start) / total_accesses;
+
     printf("%d %.2f\n", NUMPAGES, ns_per_access);
-    
-    free(a);
+    if (use_perf) {
+        fprintf(stderr, "perf: pages=%d", NUMPAGES);
+        perf_print(stderr, &pc, total_accesses);
+        fprintf(stderr, "\n");
+        perf_close(&pc);
+    }
+
+    if (p < 0) printf("%d\n", p);   // keep the chase result live
+    free(perm);
+    if (base) munmap(base, map_bytes);
+    else free(a);
     return 0;
 }
@@ -1,6 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/time.h>
+#include "../common/hrtime.h"
 #include <unistd.h>
 
 // macOS version - no CPU pinning (not reliably supported)
@@ -31,10 +31,8 @@ int main(int argc, char *argv[]) {
         a[i] = 0;
     }
     
-    struct timeval start, end;
-    
     // Start timing
-    gettimeofday(&start, NULL);
+    uint64_t start = hr_now_ns();
     
     // Main measurement loop
     for (int t = 0; t < trials; t++) {
@@ -44,15 +42,11 @@ int main(int argc, char *argv[]) {
     }
     
     // End timing
-    gettimeofday(&end, NULL);
-    
-    // Calculate elapsed time in microseconds
-    long elapsed_usec = (end.tv_sec - start.tv_sec) * 1000000L + 
-                        (end.tv_usec - start.tv_usec);
+    uint64_t end = hr_now_ns();
     
     // Convert to nanoseconds per access (use double to avoid overflow)
     double total_accesses = (double)trials * (double)NUMPAGES;
-    double ns_per_access = (elapsed_usec * 1000.0) / total_accesses;
+    double ns_per_access = (double)(end - start) / total_accesses;
     
     printf("%d %.2f\n", NUMPAGES, ns_per_access);
     
@@ -1,57 +1,286 @@
 /* ============================================================
  * OSTEP Chapter 29: Lock-Based Concurrent Data Structures
- * Combined implementation for Q1 - Q6
- * Build: gcc -O2 -pthread -o ch29 ch29_all.c
+ * Combined implementation for Q1 - Q6 (plus extensions, Q7+)
+ * Build: gcc -O2 -pthread -o ch29 ch29_all.c -lm
  * ============================================================ */
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
-#include <sys/time.h>
+#include <sched.h>
+#include <sys/mman.h>
 #include <stdint.h>
 #include <assert.h>
 #include <string.h>
+#include <time.h>
+#include <limits.h>
+#include "../../common/hrtime.h"
+#include "../../common/histogram.h"
+#include "../../common/topology.h"
+#include "../../common/lock.h"
+#include "../../common/perfctr.h"
+#include "../../common/workload.h"
+#include "../../common/reclaim.h"
+#include "../../HW8exercise31/taskpool.h"
 
 // Common helpers ---------------------------------------------------------------
-static inline uint64_t now_us(void) {
-    struct timeval tv; gettimeofday(&tv, NULL);
-    return (uint64_t)tv.tv_sec * 1000000ULL + (uint64_t)tv.tv_usec;
+// Run timing uses the monotonic raw clock (ns); per-op timing uses hr_ticks().
+static inline uint64_t now_ns(void){ return hr_now_ns(); }
+static inline double elapsed_ms(uint64_t a, uint64_t b){ return hr_elapsed_ms(a,b); }
+
+// Node pool: with --arena each thread carves nodes out of its own slabs, so the
+// timed regions never enter malloc or touch another thread's allocator state.
+// node_free recycles into the calling thread's size-class free list, and
+// pool_release_all hands every slab back in bulk once a run is over (after
+// reclaim_drain(), so nothing retired still points into a slab). Each release
+// bumps g_pool_gen, so a thread that outlives it (a --tasks pool worker)
+// notices that its tl_pool is gone and starts a new one.
+#define POOL_SLAB   (64*1024)
+#define POOL_CLASSES 8          // 16-byte size classes, up to 128 bytes
+typedef struct slab { struct slab *next; } slab_t;
+typedef struct pool { slab_t *slabs; char *cur, *end; void *freel[POOL_CLASSES]; struct pool *next; } pool_t;
+static int g_use_pool;
+static __thread pool_t *tl_pool;
+static __thread unsigned tl_pool_gen;
+static unsigned g_pool_gen;
+static pool_t *g_pools;
+static pthread_mutex_t g_pools_lock=PTHREAD_MUTEX_INITIALIZER;
+static pool_t* pool_self(void){
+    unsigned gen=__atomic_load_n(&g_pool_gen,__ATOMIC_ACQUIRE);
+    if(!tl_pool || tl_pool_gen!=gen){
+        tl_pool=(pool_t*)calloc(1,sizeof(pool_t)); tl_pool_gen=gen;
+        pthread_mutex_lock(&g_pools_lock); tl_pool->next=g_pools; g_pools=tl_pool; pthread_mutex_unlock(&g_pools_lock);
+    }
+    return tl_pool;
+}
+static void* node_alloc(size_t sz){
+    if(!g_use_pool) return malloc(sz);
+    size_t cls=(sz+15)/16-1; assert(cls<POOL_CLASSES);
+    pool_t *p=pool_self(); void *n=p->freel[cls];
+    if(n){ p->freel[cls]=*(void**)n; return n; }
+    sz=(cls+1)*16;
+    if(p->cur+sz>p->end){
+        slab_t *s=(slab_t*)malloc(POOL_SLAB); if(!s) return NULL;
+        s->next=p->slabs; p->slabs=s; p->cur=(char*)s+16; p->end=(char*)s+POOL_SLAB;
+    }
+    n=p->cur; p->cur+=sz; return n;
+}
+static void node_free(void *n,size_t sz){
+    if(!g_use_pool){ free(n); return; }
+    pool_t *p=pool_self(); size_t cls=(sz+15)/16-1;
+    *(void**)n=p->freel[cls]; p->freel[cls]=n;
+}
+// Only call once every thread that allocated from a pool has been joined (or,
+// under --tasks, has finished its task).
+static void pool_release_all(void){
+    pthread_mutex_lock(&g_pools_lock);
+    for(pool_t *p=g_pools,*np;p;p=np){ np=p->next; for(slab_t *s=p->slabs,*ns;s;s=ns){ ns=s->next; free(s); } free(p); }
+    g_pools=NULL; tl_pool=NULL;
+    __atomic_add_fetch(&g_pool_gen,1,__ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_pools_lock);
+}
+
+// Thread placement: with --place=compact|scatter|numa every worker is created
+// with its CPU mask already set (see common/topology.h), and per-thread or
+// per-slice data is first-touched by a thread placed the same way, so Linux
+// backs it with memory on that thread's NUMA node.
+static int g_place;
+static topo_t g_topo;
+static topo_cpu_t g_order[TOPO_MAX_CPUS];
+static void place_setup(int policy){
+    g_place=policy; if(!policy) return;
+    topo_load(&g_topo); topo_order(&g_topo,policy,g_order);
+    printf("[place] policy=%s cpus=%d packages=%d nodes=%d\n",topo_policy_name(policy),g_topo.n,g_topo.npackages,g_topo.nnodes);
+}
+// Task mode: with --tasks, workers are tasks on one work-stealing pool made
+// at startup (HW8exercise31/taskpool.h), so a run costs a spawn per worker
+// instead of a pthread_create/join. Tasks may run on any pool thread, so
+// "thread" in the reports means the task, and nothing is pinned per tid.
+static tp_pool_t *g_tasks;
+static tp_group_t g_group;
+// CPU a pinned worker runs on, or -1 when it is not pinned to a single CPU.
+static int place_cpu(int tid){ return !g_tasks && (g_place==PLACE_COMPACT||g_place==PLACE_SCATTER)? g_order[tid%g_topo.n].cpu : -1; }
+static int spawn_thread(pthread_t *t,void*(*fn)(void*),void *arg,int tid,int threads){
+    if(!g_place) return pthread_create(t,NULL,fn,arg);
+    pthread_attr_t attr; pthread_attr_init(&attr);
+#ifdef __linux__
+    cpu_set_t set; topo_cpuset_for(&g_topo,g_order,g_place,tid,threads,&set);
+    pthread_attr_setaffinity_np(&attr,sizeof(set),&set);
+#endif
+    int rv=pthread_create(t,&attr,fn,arg); pthread_attr_destroy(&attr); return rv;
+}
+static int spawn_worker(pthread_t *t,void*(*fn)(void*),void *arg,int tid,int threads){
+    if(g_tasks){ tp_spawn(g_tasks,&g_group,fn,arg); return 0; }
+    return spawn_thread(t,fn,arg,tid,threads);
+}
+// The first join of a run waits for every task; later ones return at once.
+static void join_worker(pthread_t *t){ if(g_tasks) tp_sync(g_tasks,&g_group); else pthread_join(*t,NULL); }
+static void tasks_setup(int n){
+    if(n<=0) n=(int)sysconf(_SC_NPROCESSORS_ONLN);
+    g_tasks=tp_create(n); tp_group_init(&g_group);
+#ifdef __linux__
+    if(g_place) for(int i=0;i<n;i++){ cpu_set_t set; topo_cpuset_for(&g_topo,g_order,g_place,i,n,&set); pthread_setaffinity_np(g_tasks->w[i].thread,sizeof(set),&set); }
+#endif
+    printf("[tasks] workers=%d\n",n);
+}
+// Untouched, page-aligned memory: nothing is backed until someone writes it.
+static void* place_alloc(size_t sz){ void *p=mmap(NULL,sz,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0); return p==MAP_FAILED?NULL:p; }
+static void place_free(void *p,size_t sz){ if(p) munmap(p,sz); }
+// Runs fn(tid,arg) once per tid on a thread placed like worker `tid`.
+typedef struct { void (*fn)(int,int,void*); void *arg; int tid, threads; } place_job_t;
+static void* place_job(void *arg){ place_job_t *j=(place_job_t*)arg; j->fn(j->tid,j->threads,j->arg); return NULL; }
+static void place_touch(int threads,void (*fn)(int,int,void*),void *arg){
+    pthread_t *t=(pthread_t*)malloc(sizeof(pthread_t)*threads); place_job_t *j=(place_job_t*)malloc(sizeof(place_job_t)*threads);
+    for(int i=0;i<threads;i++){ j[i]=(place_job_t){fn,arg,i,threads}; spawn_thread(&t[i],place_job,&j[i],i,threads); }
+    for(int i=0;i<threads;i++) pthread_join(t[i],NULL);
+    free(t); free(j);
+}
+
+// Per-thread op stats. Every worker keeps a wstat_t private to itself and the
+// driver merges them after join. Op counts are always kept; with --lat each op
+// is also timed in ticks into a per-thread histogram and a report (CSV rows
+// or one JSON object per run) follows the usual summary line.
+enum { OP_UPDATE, OP_INSERT, OP_LOOKUP, OP_DELETE, OP_SCAN, NOPS };
+static const char *op_names[NOPS]={"update","insert","lookup","delete","scan"};
+enum { LAT_OFF=0, LAT_CSV, LAT_JSON };
+static int g_lat;
+typedef struct { long ops[NOPS]; hist_t *lat[NOPS]; uint64_t start, end; } wstat_t;
+static void wstat_init(wstat_t *w){
+    memset(w,0,sizeof(*w));
+    if(g_lat) for(int o=0;o<NOPS;o++){ w->lat[o]=(hist_t*)malloc(sizeof(hist_t)); hist_init(w->lat[o]); }
+}
+static void wstat_free(wstat_t *w){ for(int o=0;o<NOPS;o++){ free(w->lat[o]); w->lat[o]=NULL; } }
+// Workers copy their wstat_t to the stack and back, so counting never writes
+// a cache line shared with a neighbouring thread's arguments.
+#define OP(w,op,stmt) do{ if(g_lat){ uint64_t t0_=hr_ticks(); stmt; hist_record((w)->lat[op],hr_ticks_end()-t0_); } else { stmt; } (w)->ops[op]++; }while(0)
+
+// Hardware counters: with --perf each run's spawn..join region is counted and
+// a [perf] line (totals and per-op figures) follows the summary line. Under
+// --tasks the pool workers outlive the run, so only the driver is counted.
+static int g_perf_on; static perfctr_t g_perf;
+static uint64_t run_begin(void){ if(g_perf_on) perf_start(&g_perf); return now_ns(); }
+static uint64_t run_end(void){ uint64_t e=now_ns(); if(g_perf_on) perf_stop(&g_perf); return e; }
+static void report_perf(const char *bench,const char *variant,int threads,wstat_t **ws){
+    long ops=0; for(int i=0;i<threads;i++) for(int o=0;o<NOPS;o++) ops+=ws[i]->ops[o];
+    printf("[perf] bench=%s variant=%s threads=%d ops=%ld",bench,variant,threads,ops); perf_print(stdout,&g_perf,ops); printf("\n");
+}
+
+// Reclamation: the nodes that the lazy list and the lock-free chains unlink,
+// and the tables that a resizable hash drains, are retired through
+// common/reclaim.h (--reclaim=none|ebr|hp, default ebr). After such a run a
+// [reclaim] line follows the summary. Then everything still retired is freed,
+// before the structure is destroyed and the pools are released.
+static void report_reclaim(const char *bench,const char *variant,double ms){
+    reclaim_stats_t r; reclaim_stats(&r);
+    reclaim_drain();
+    printf("[reclaim] bench=%s variant=%s mode=%s retired=%lu freed=%lu left=%lu peak_pending=%ld peak_kb=%.1f scans=%lu mfree_s=%.2f ns_per_free=%.1f\n",
+        bench,variant,reclaim_mode_name(),(unsigned long)r.retired,(unsigned long)r.freed,(unsigned long)(r.retired-r.freed),
+        r.peak_nodes,r.peak_bytes/1024.0,(unsigned long)r.scans,r.freed/(ms*1e3),r.freed?r.scan_ns/r.freed:0.0);
+    reclaim_stats_reset();
+}
+
+// Workload: with --dist/--mix/--keys the counter, list and hash drivers
+// replay a pre-generated per-thread op stream (common/workload.h) instead of
+// their fixed partitioned key pattern. Streams are built before run_begin(),
+// so the timed region never runs the RNG. Counters have no keys: a lookup is
+// a read of the counter and an insert or delete is an update.
+static int g_wl_on, g_wl_mix_set; static wl_t g_wl; static long g_wl_keys;
+// Copy of g_wl for key space [0,keys); the driver's own mix applies unless --mix was given.
+static wl_t wl_for(long keys,int ins,int look,int del){
+    wl_t w=g_wl; if(!g_wl_mix_set){ w.mix[WL_INSERT]=ins; w.mix[WL_LOOKUP]=look; w.mix[WL_DELETE]=del; }
+    wl_prepare(&w,g_wl_keys>0?g_wl_keys:keys); return w;
+}
+static wl_op_t** wl_streams(const wl_t *w,int threads,long n){
+    wl_op_t **s=(wl_op_t**)malloc(sizeof(wl_op_t*)*threads);
+    for(int i=0;i<threads;i++) if(!(s[i]=wl_stream(w,i,n))){ fprintf(stderr,"out of memory for op streams\n"); exit(1); }
+    return s;
+}
+static void wl_streams_free(wl_op_t **s,int threads){ if(!s) return; for(int i=0;i<threads;i++) free(s[i]); free(s); }
+
+static void report_lat(const char *bench,const char *variant,int threads,wstat_t **ws){
+    static int csv_header;
+    if(g_perf_on) report_perf(bench,variant,threads,ws);
+    if(!g_lat) return;
+    double ns=hr_ns_per_tick();
+    hist_t all[NOPS]; for(int o=0;o<NOPS;o++){ hist_init(&all[o]); for(int i=0;i<threads;i++) hist_merge(&all[o],ws[i]->lat[o]); }
+    if(g_lat==LAT_CSV){
+        if(!csv_header++) printf("bench,variant,threads,thread,op,thread_ms,count,mean_ns,p50_ns,p90_ns,p99_ns,p999_ns,max_ns\n");
+        for(int o=0;o<NOPS;o++){
+            if(!all[o].n) continue;
+            printf("%s,%s,%d,all,%s,,%llu,",bench,variant,threads,op_names[o],(unsigned long long)all[o].n); hist_print_csv(stdout,&all[o],ns); printf("\n");
+            for(int i=0;i<threads;i++){
+                printf("%s,%s,%d,%d,%s,%.3f,%ld,",bench,variant,threads,i,op_names[o],elapsed_ms(ws[i]->start,ws[i]->end),ws[i]->ops[o]); hist_print_csv(stdout,ws[i]->lat[o],ns); printf("\n");
+            }
+        }
+    } else {
+        printf("{\"bench\":\"%s\",\"variant\":\"%s\",\"threads\":%d,\"ops\":{",bench,variant,threads);
+        for(int o=0,first=1;o<NOPS;o++){ if(!all[o].n) continue; printf("%s\"%s\":{",first?"":",",op_names[o]); hist_print_json(stdout,&all[o],ns); printf("}"); first=0; }
+        printf("},\"per_thread\":[");
+        for(int i=0;i<threads;i++){
+            printf("%s{\"thread\":%d,\"thread_ms\":%.3f",i?",":"",i,elapsed_ms(ws[i]->start,ws[i]->end));
+            for(int o=0;o<NOPS;o++){ if(!all[o].n) continue; printf(",\"%s\":{",op_names[o]); hist_print_json(stdout,ws[i]->lat[o],ns); printf("}"); }
+            printf("}");
+        }
+        printf("]}\n");
+    }
+    fflush(stdout);
 }
-static inline double elapsed_ms(uint64_t a, uint64_t b){ return (double)(b-a)/1000.0; }
 
 // ==============================================================================
 //// ==== Q1: Timer Accuracy ====================================================
-int run_q1(int samples){
-    if(samples<=0) samples=100000;
-    uint64_t min_delta=UINT64_MAX, zero=0, last=now_us();
+// Compares the original gettimeofday() clock with the monotonic raw clock and
+// the cycle counter used for per-op timing.
+static uint64_t q1_gettimeofday_us(void){ struct timeval tv; gettimeofday(&tv,NULL); return (uint64_t)tv.tv_sec*1000000ULL+(uint64_t)tv.tv_usec; }
+static void q1_sample(const char *name,uint64_t (*clk)(void),int samples,double unit_ns){
+    uint64_t min_delta=UINT64_MAX, zero=0, last=clk(), t0=now_ns();
     for(int i=0;i<samples;i++){
-        uint64_t t=now_us();
+        uint64_t t=clk();
         if(t==last){ zero++; continue; }
         if(t-last<min_delta) min_delta=t-last;
         last=t;
     }
-    printf("[Q1] samples=%d zero=%llu min_nonzero_delta_us=%llu\n",
-        samples,(unsigned long long)zero,(unsigned long long)(min_delta==UINT64_MAX?0:min_delta));
+    double cost=(double)(now_ns()-t0)/samples;
+    printf("[Q1] clock=%s samples=%d zero=%llu min_nonzero_delta_ns=%.1f read_cost_ns=%.1f\n",
+        name,samples,(unsigned long long)zero,min_delta==UINT64_MAX?0.0:(double)min_delta*unit_ns,cost);
+}
+int run_q1(int samples){
+    if(samples<=0) samples=100000;
+    q1_sample("gettimeofday",q1_gettimeofday_us,samples,1000.0);
+    q1_sample("monotonic_raw",hr_now_ns,samples,1.0);
+    q1_sample("ticks",hr_ticks,samples,hr_ns_per_tick());
     return 0;
 }
 
 // ==============================================================================
 //// ==== Q2: Simple Concurrent Counter (Single Lock) ===========================
-typedef struct { int value; pthread_mutex_t lock; } counter_t;
-void counter_init(counter_t *c){ c->value=0; pthread_mutex_init(&c->lock,NULL); }
-void counter_inc(counter_t *c){ pthread_mutex_lock(&c->lock); c->value++; pthread_mutex_unlock(&c->lock); }
-int counter_get(counter_t *c){ pthread_mutex_lock(&c->lock); int v=c->value; pthread_mutex_unlock(&c->lock); return v; }
+typedef struct { long value; lock_t lock; } counter_t;
+void counter_init(counter_t *c){ c->value=0; lock_init(&c->lock); }
+void counter_inc(counter_t *c){ lock_acquire(&c->lock); c->value++; lock_release(&c->lock); }
+void counter_add_n(counter_t *c,long n){ lock_acquire(&c->lock); c->value+=n; lock_release(&c->lock); }
+long counter_get(counter_t *c){ lock_acquire(&c->lock); long v=c->value; lock_release(&c->lock); return v; }
 
-typedef struct { counter_t *ctr; long iters; } q2_arg_t;
-void* q2_worker(void *arg){ q2_arg_t *a=(q2_arg_t*)arg; for(long i=0;i<a->iters;i++) counter_inc(a->ctr); return NULL; }
+typedef struct { counter_t *ctr; long iters; const wl_op_t *ops; volatile long sink; wstat_t st; } q2_arg_t;
+void* q2_worker(void *arg){
+    q2_arg_t *a=(q2_arg_t*)arg; wstat_t w=a->st; long sink=0; w.start=now_ns();
+    if(a->ops) for(long i=0;i<a->iters;i++){ if(a->ops[i].op==WL_LOOKUP) OP(&w,OP_LOOKUP,sink+=counter_get(a->ctr)); else OP(&w,OP_UPDATE,counter_inc(a->ctr)); }
+    else for(long i=0;i<a->iters;i++) OP(&w,OP_UPDATE,counter_inc(a->ctr));
+    w.end=now_ns(); a->sink=sink; a->st=w; return NULL;
+}
 int run_q2(int threads,long iters){
     counter_t c; counter_init(&c);
     pthread_t *t = (pthread_t*)malloc(sizeof(pthread_t)*threads);
     q2_arg_t *a = (q2_arg_t*)malloc(sizeof(q2_arg_t)*threads);
-    uint64_t s=now_us();
-    for(int i=0;i<threads;i++){ a[i]=(q2_arg_t){.ctr=&c,.iters=iters}; pthread_create(&t[i],NULL,q2_worker,&a[i]); }
-    for(int i=0;i<threads;i++) pthread_join(t[i],NULL);
-    uint64_t e=now_us();
-    printf("[Q2] threads=%d total=%d time_ms=%.3f\n",threads,counter_get(&c),elapsed_ms(s,e));
+    wl_t wl; wl_op_t **ops=NULL; if(g_wl_on){ wl=wl_for(1,50,0,50); ops=wl_streams(&wl,threads,iters); }
+    uint64_t s=run_begin();
+    for(int i=0;i<threads;i++){ a[i]=(q2_arg_t){.ctr=&c,.iters=iters,.ops=ops?ops[i]:NULL}; wstat_init(&a[i].st); spawn_worker(&t[i],q2_worker,&a[i],i,threads); }
+    for(int i=0;i<threads;i++) join_worker(&t[i]);
+    uint64_t e=run_end();
+    printf("[Q2] lock=%s threads=%d total=%ld time_ms=%.3f mops=%.2f",lock_kind_name(),threads,counter_get(&c),elapsed_ms(s,e),(double)threads*iters/((e-s)/1e3));
+    if(ops){ char d[128]; printf(" %s",wl_describe(&wl,d,sizeof(d))); wl_streams_free(ops,threads); }
+    printf("\n");
+    wstat_t *ws[threads]; for(int i=0;i<threads;i++) ws[i]=&a[i].st;
+    report_lat("q2",lock_kind_name(),threads,ws);
+    for(int i=0;i<threads;i++) wstat_free(&a[i].st);
     free(t); free(a);
     return 0;
 }
@@ -60,124 +289,962 @@ int run_q2(int threads,long iters){
 //// ==== Q3: Approximate Counter (Per-CPU + Global) ============================
 #define MAXCPUS 128
 typedef struct {
-    int global; pthread_mutex_t glock;
-    int local[MAXCPUS]; pthread_mutex_t llock[MAXCPUS];
+    int global; lock_t glock;
+    int local[MAXCPUS]; lock_t llock[MAXCPUS];
     int threshold; int ncpu;
 } approx_t;
-void approx_init(approx_t *c,int th,int ncpu){ c->threshold=th; c->global=0; pthread_mutex_init(&c->glock,NULL); c->ncpu=ncpu>0?ncpu:4; for(int i=0;i<c->ncpu;i++){c->local[i]=0; pthread_mutex_init(&c->llock[i],NULL);} }
-void approx_update(approx_t *c,int tid){int cpu=tid%c->ncpu;pthread_mutex_lock(&c->llock[cpu]);c->local[cpu]++;if(c->local[cpu]>=c->threshold){pthread_mutex_lock(&c->glock);c->global+=c->local[cpu];pthread_mutex_unlock(&c->glock);c->local[cpu]=0;}pthread_mutex_unlock(&c->llock[cpu]);}
-int approx_get(approx_t *c){pthread_mutex_lock(&c->glock);int v=c->global;pthread_mutex_unlock(&c->glock);return v;}
-
-typedef struct { approx_t *ctr; long iters; int tid; } q3_arg_t;
-void* q3_worker(void *arg){ q3_arg_t *a=(q3_arg_t*)arg; for(long i=0;i<a->iters;i++) approx_update(a->ctr,a->tid); return NULL; }
-int run_q3(int threads,long iters,int th){
-    approx_t c; approx_init(&c,th,threads);
+void approx_init(approx_t *c,int th,int ncpu){ c->threshold=th; c->global=0; lock_init(&c->glock); c->ncpu=ncpu>0?ncpu:4; for(int i=0;i<c->ncpu;i++){c->local[i]=0; lock_init(&c->llock[i]);} }
+void approx_update(approx_t *c,int cpu){cpu%=c->ncpu;lock_acquire(&c->llock[cpu]);c->local[cpu]++;if(c->local[cpu]>=c->threshold){lock_acquire(&c->glock);c->global+=c->local[cpu];lock_release(&c->glock);c->local[cpu]=0;}lock_release(&c->llock[cpu]);}
+int approx_get(approx_t *c){lock_acquire(&c->glock);int v=c->global;lock_release(&c->glock);return v;}
+
+// Padded layout: each thread owns one 64-byte slot, so updates never share a
+// line with a neighbour and need no lock (only the owner ever writes its slot).
+// Under --place the slots are a page apart and first-touched by their owner,
+// so each one lives on its thread's NUMA node.
+#define CACHELINE 64
+typedef struct { long v; } __attribute__((aligned(CACHELINE))) pad_slot_t;
+typedef struct {
+    char *local; size_t stride, bytes; int threshold; int nslots;
+    long global __attribute__((aligned(CACHELINE)));
+} approx_pad_t;
+#define PAD_SLOT(c,tid) ((pad_slot_t*)((c)->local+(size_t)((tid)%(c)->nslots)*(c)->stride))
+static void approx_pad_touch(int tid,int threads,void *arg){ (void)threads; PAD_SLOT((approx_pad_t*)arg,tid)->v=0; }
+void approx_pad_init(approx_pad_t *c,int th,int nslots){
+    c->threshold=th; c->global=0; c->nslots=nslots>0?nslots:4;
+    c->stride=g_place?(size_t)getpagesize():sizeof(pad_slot_t); c->bytes=c->stride*c->nslots;
+    c->local=(char*)place_alloc(c->bytes); if(!c->local) abort();
+    if(g_place) place_touch(c->nslots,approx_pad_touch,c);
+}
+void approx_pad_update(approx_pad_t *c,int tid){
+    pad_slot_t *s=PAD_SLOT(c,tid);
+    long v=__atomic_load_n(&s->v,__ATOMIC_RELAXED)+1;
+    if(v>=c->threshold){ __atomic_fetch_add(&c->global,v,__ATOMIC_RELAXED); v=0; }
+    __atomic_store_n(&s->v,v,__ATOMIC_RELAXED);
+}
+long approx_pad_get(approx_pad_t *c){ return __atomic_load_n(&c->global,__ATOMIC_RELAXED); }
+void approx_pad_free(approx_pad_t *c){ place_free(c->local,c->bytes); c->local=NULL; }
+
+// Without --place the locked layout keeps the textbook tid -> slot mapping;
+// with it, each update goes to the slot of the CPU the thread is running on.
+static inline int current_cpu(int tid){
+#ifdef __linux__
+    if(g_place) return sched_getcpu();
+#endif
+    return tid;
+}
+typedef struct { approx_t *ctr; approx_pad_t *pad; long iters; int tid; const wl_op_t *ops; volatile long sink; wstat_t st; } q3_arg_t;
+void* q3_worker(void *arg){
+    q3_arg_t *a=(q3_arg_t*)arg; wstat_t w=a->st; long sink=0; w.start=now_ns();
+    if(a->ops){
+        int cpu=place_cpu(a->tid);
+        for(long i=0;i<a->iters;i++){
+            if(a->ops[i].op==WL_LOOKUP) OP(&w,OP_LOOKUP,sink+=a->pad?approx_pad_get(a->pad):approx_get(a->ctr));
+            else if(a->pad) OP(&w,OP_UPDATE,approx_pad_update(a->pad,a->tid));
+            else OP(&w,OP_UPDATE,approx_update(a->ctr,cpu>=0?cpu:current_cpu(a->tid)));
+        }
+    }
+    else if(a->pad) for(long i=0;i<a->iters;i++) OP(&w,OP_UPDATE,approx_pad_update(a->pad,a->tid));
+    else if(place_cpu(a->tid)>=0){ int cpu=place_cpu(a->tid); for(long i=0;i<a->iters;i++) OP(&w,OP_UPDATE,approx_update(a->ctr,cpu)); }
+    else for(long i=0;i<a->iters;i++) OP(&w,OP_UPDATE,approx_update(a->ctr,current_cpu(a->tid)));
+    w.end=now_ns(); a->sink=sink; a->st=w; return NULL;
+}
+static void run_q3_layout(int threads,long iters,int th,int padded){
+    approx_t c; approx_pad_t p;
+    int ncpu=threads;
+    if(g_place){ ncpu=0; for(int i=0;i<g_topo.n;i++) if(g_topo.cpu[i].cpu>=ncpu) ncpu=g_topo.cpu[i].cpu+1; if(ncpu>MAXCPUS) ncpu=MAXCPUS; }
+    if(padded) approx_pad_init(&p,th,threads); else approx_init(&c,th,ncpu);
     pthread_t *t = (pthread_t*)malloc(sizeof(pthread_t)*threads);
     q3_arg_t *a = (q3_arg_t*)malloc(sizeof(q3_arg_t)*threads);
-    uint64_t s=now_us();
-    for(int i=0;i<threads;i++){a[i]=(q3_arg_t){.ctr=&c,.iters=iters,.tid=i}; pthread_create(&t[i],NULL,q3_worker,&a[i]);}
-    for(int i=0;i<threads;i++) pthread_join(t[i],NULL);
-    uint64_t e=now_us();
-    printf("[Q3] threads=%d threshold=%d total=%d time_ms=%.3f\n",threads,th,approx_get(&c),elapsed_ms(s,e));
+    wl_t wl; wl_op_t **ops=NULL; if(g_wl_on){ wl=wl_for(1,50,0,50); ops=wl_streams(&wl,threads,iters); }
+    uint64_t s=run_begin();
+    for(int i=0;i<threads;i++){a[i]=(q3_arg_t){.ctr=&c,.pad=padded?&p:NULL,.iters=iters,.tid=i,.ops=ops?ops[i]:NULL}; wstat_init(&a[i].st); spawn_worker(&t[i],q3_worker,&a[i],i,threads);}
+    for(int i=0;i<threads;i++) join_worker(&t[i]);
+    uint64_t e=run_end();
+    long total=padded?approx_pad_get(&p):approx_get(&c);
+    double ms=elapsed_ms(s,e), mops=ms>0?(double)threads*iters/(ms*1000.0):0;
+    printf("[Q3] layout=%s threads=%d threshold=%d total=%ld time_ms=%.3f mops=%.2f",padded?"padded":"locked",threads,th,total,ms,mops);
+    if(ops){ char d[128]; printf(" %s",wl_describe(&wl,d,sizeof(d))); wl_streams_free(ops,threads); }
+    printf("\n");
+    wstat_t *ws[threads]; for(int i=0;i<threads;i++) ws[i]=&a[i].st;
+    report_lat("q3",padded?"padded":"locked",threads,ws);
+    for(int i=0;i<threads;i++) wstat_free(&a[i].st);
+    if(padded) approx_pad_free(&p);
     free(t); free(a);
+}
+// layout: 0 = locked arrays only, 1 = padded slots only, 2 = both side by side
+int run_q3(int threads,long iters,int th,int layout){
+    if(layout!=1) run_q3_layout(threads,iters,th,0);
+    if(layout!=0) run_q3_layout(threads,iters,th,1);
     return 0;
 }
 
 // ==============================================================================
-//// ==== Q4: Linked List (Single Lock vs Hand-over-hand) =======================
-typedef struct node { int key; struct node *next; pthread_mutex_t lock; } node_t;
-typedef struct { node_t *head; pthread_mutex_t lock; int hoh; } list_t;
-void list_init(list_t *L,int hoh){ L->head=NULL; pthread_mutex_init(&L->lock,NULL); L->hoh=hoh; }
+//// ==== Q4: Linked List (Single Lock vs Hand-over-hand vs Lazy) + B+-tree =====
+enum { LIST_SINGLE=0, LIST_HOH=1, LIST_LAZY=2, LIST_BTREE=3, LIST_NMODES };
+// List nodes carry their own lock for hand-over-hand and lazy modes; hash nodes below do not.
+typedef struct lnode { int key; int marked; struct lnode *next; lock_t lock; } lnode_t;
+// LIST_BTREE is not a list: the same interface over a B+-tree rooted at root.
+typedef struct { lnode_t *head; lock_t lock; int mode; struct btnode *root; } list_t;
+static lnode_t* lnode_new(list_t *L,int key,lnode_t *next){
+    lnode_t *n=(lnode_t*)node_alloc(sizeof(lnode_t)); if(!n) return NULL;
+    n->key=key; n->marked=0; n->next=next; if(L->mode!=LIST_SINGLE) lock_init(&n->lock);
+    return n;
+}
+// Lazy mode keeps the list sorted between INT_MIN/INT_MAX sentinels.
+static struct btnode* bt_new(int leaf);
+void list_init(list_t *L,int mode){
+    L->head=NULL; L->root=NULL; lock_init(&L->lock); L->mode=mode;
+    if(mode==LIST_BTREE) L->root=bt_new(1);
+    if(mode==LIST_LAZY) L->head=lnode_new(L,INT_MIN,lnode_new(L,INT_MAX,NULL));
+}
+
+// Lazy synchronization (Heller et al.): readers take no locks and never retry;
+// writers lock only pred and curr, then validate that neither was removed and
+// that pred still points at curr. Removal sets `marked` before unlinking, so a
+// reader that lands on a removed node still answers correctly. Removed nodes
+// are retired (common/reclaim.h), since a reader may still be on them. Under
+// hazard pointers a walk holds the node it is on and the one before it, in
+// slots 0 and 1 alternately, and a step that can't be validated restarts at
+// the head; under ebr and none readers still never retry.
+static void lnode_reclaim(void *p,size_t sz){ lock_destroy(&((lnode_t*)p)->lock); node_free(p,sz); }
+// Steps from c to c->next, publishing the new node in slot s under hp. It is
+// trusted only if c is still linked (unmarked and still pointing at it) after
+// that, so it can't have been retired yet; NULL means restart.
+static lnode_t* lazy_step(lnode_t *c,int s){
+    lnode_t *n=__atomic_load_n(&c->next,__ATOMIC_ACQUIRE);
+    if(!reclaim_hp()) return n;
+    reclaim_hazard(s,n);
+    return !__atomic_load_n(&c->marked,__ATOMIC_SEQ_CST) && __atomic_load_n(&c->next,__ATOMIC_SEQ_CST)==n ? n : NULL;
+}
+static int lazy_validate(lnode_t *pred,lnode_t *curr){
+    return !__atomic_load_n(&pred->marked,__ATOMIC_ACQUIRE) && !__atomic_load_n(&curr->marked,__ATOMIC_ACQUIRE)
+        && __atomic_load_n(&pred->next,__ATOMIC_ACQUIRE)==curr;
+}
+// The sentinels are never removed, so the walk can start at L->head unprotected.
+static void lazy_locate(list_t *L,int key,lnode_t **pred,lnode_t **curr){
+restart:;
+    int s=0; lnode_t *p=L->head, *c=lazy_step(p,s);
+    while(c && c->key<key){ p=c; c=lazy_step(c,s^=1); }
+    if(!c) goto restart;
+    *pred=p; *curr=c;
+}
+static int lazy_lookup(list_t *L,int key){
+    reclaim_enter();
+    lnode_t *c;
+restart:
+    c=L->head;
+    for(int s=0;c->key<key;s^=1) if(!(c=lazy_step(c,s))) goto restart;
+    int rv=c->key==key && !__atomic_load_n(&c->marked,__ATOMIC_ACQUIRE) ? 0 : -1;
+    reclaim_exit(); return rv;
+}
+static int lazy_insert(list_t *L,int key){
+    reclaim_enter();
+    for(;;){
+        lnode_t *p,*c; lazy_locate(L,key,&p,&c);
+        lock_acquire(&p->lock); lock_acquire(&c->lock);
+        int ok=lazy_validate(p,c), rv=-1;
+        if(ok && c->key!=key){ lnode_t *n=lnode_new(L,key,c); if(n){ __atomic_store_n(&p->next,n,__ATOMIC_RELEASE); rv=0; } }
+        lock_release(&c->lock); lock_release(&p->lock);
+        if(ok){ reclaim_exit(); return rv; }
+    }
+}
+static int lazy_delete(list_t *L,int key){
+    reclaim_enter();
+    for(;;){
+        lnode_t *p,*c; lazy_locate(L,key,&p,&c);
+        lock_acquire(&p->lock); lock_acquire(&c->lock);
+        int ok=lazy_validate(p,c), rv=-1;
+        if(ok && c->key==key){
+            __atomic_store_n(&c->marked,1,__ATOMIC_RELEASE);
+            __atomic_store_n(&p->next,c->next,__ATOMIC_RELEASE);
+            rv=0;
+        }
+        lock_release(&c->lock); lock_release(&p->lock);
+        if(ok){
+            if(rv==0) reclaim_retire(c,sizeof(lnode_t),lnode_reclaim);
+            reclaim_exit(); return rv;
+        }
+    }
+}
+// Up to len unmarked keys >= key, in order. A restart under hp starts the
+// scan over, so no key is counted twice.
+static int lazy_scan(list_t *L,int key,int len,long *sum){
+    reclaim_enter();
+    lnode_t *c; int got, s;
+    long t;
+restart:
+    c=L->head; got=0; t=0; s=0;
+    while(c->key<key) if(!(c=lazy_step(c,s^=1))) goto restart;
+    for(;got<len && c->key!=INT_MAX;){
+        if(!__atomic_load_n(&c->marked,__ATOMIC_ACQUIRE)){ t+=c->key; got++; }
+        if(!(c=lazy_step(c,s^=1))) goto restart;
+    }
+    reclaim_exit();
+    *sum=t; return got;
+}
+
+// B+-tree with optimistic lock coupling (Leis et al.). Every node carries a
+// version word used like a seqlock: odd = write-locked, and each unlock moves
+// it on. Readers take no locks: they note a node's version, read the node,
+// and re-check the version before trusting what they read or descending (a
+// mismatch restarts from the root). A writer upgrades the version it noted to
+// a lock with one CAS, so a node that changed since it was read can't be
+// locked. Full nodes are split on the way down, so a split only ever locks a
+// node and its parent. Nodes are four cache lines, searched with a
+// branch-free count instead of pointer chasing; leaves are chained for range
+// scans. Deletes never merge nodes (Q4 keeps the key count stable), so no
+// node is unlinked or freed before bt_free.
+#define BT_MAX 14
+typedef struct btnode { uint64_t ver; int leaf, n; int key[BT_MAX]; struct btnode *child[BT_MAX+1]; struct btnode *next; } __attribute__((aligned(64))) btnode_t;
+#define bt_ld(p) __atomic_load_n(p,__ATOMIC_RELAXED)
+#define bt_st(p,v) __atomic_store_n(p,v,__ATOMIC_RELAXED)
+static btnode_t* bt_new(int leaf){
+    btnode_t *n; if(posix_memalign((void**)&n,64,sizeof(btnode_t))) return NULL;
+    memset(n,0,sizeof(*n)); n->leaf=leaf; return n;
+}
+// Waits out a writer and returns the (even) version to validate against.
+static uint64_t bt_read_lock(btnode_t *n){
+    uint64_t v; while((v=__atomic_load_n(&n->ver,__ATOMIC_ACQUIRE))&1) sched_yield();
+    return v;
+}
+static int bt_check(btnode_t *n,uint64_t v){ __atomic_thread_fence(__ATOMIC_ACQUIRE); return bt_ld(&n->ver)==v; }
+static int bt_upgrade(btnode_t *n,uint64_t v){
+    if(!__atomic_compare_exchange_n(&n->ver,&v,v+1,0,__ATOMIC_ACQUIRE,__ATOMIC_RELAXED)) return 0;
+    __atomic_thread_fence(__ATOMIC_RELEASE); return 1;
+}
+static void bt_unlock(btnode_t *n){ __atomic_fetch_add(&n->ver,1,__ATOMIC_RELEASE); }
+// Inner nodes: index of the child that holds k (keys equal to a separator go
+// right). Leaves: index of the first key >= k.
+static int bt_pos(btnode_t *n,int cnt,int k){
+    int p=0; if(n->leaf){ for(int i=0;i<cnt;i++) p+=bt_ld(&n->key[i])<k; } else { for(int i=0;i<cnt;i++) p+=bt_ld(&n->key[i])<=k; }
+    return p;
+}
+// A reader may see a count that is being changed; keep it in bounds until the version check.
+static int bt_count(btnode_t *n){ int c=bt_ld(&n->n); return c<0?0:c>BT_MAX?BT_MAX:c; }
+// Descends to the leaf for k; returns it with its version in *vp, or NULL to restart.
+static btnode_t* bt_find_leaf(list_t *L,int k,uint64_t *vp){
+    btnode_t *n=__atomic_load_n(&L->root,__ATOMIC_ACQUIRE); uint64_t v=bt_read_lock(n);
+    if(n!=__atomic_load_n(&L->root,__ATOMIC_ACQUIRE)) return NULL;
+    while(!n->leaf){
+        btnode_t *c=bt_ld(&n->child[bt_pos(n,bt_count(n),k)]);
+        if(!bt_check(n,v)) return NULL;
+        uint64_t cv=bt_read_lock(c); if(!bt_check(n,v)) return NULL;
+        n=c; v=cv;
+    }
+    *vp=v; return n;
+}
+static int bt_lookup(list_t *L,int k){
+    for(;;){
+        uint64_t v; btnode_t *n=bt_find_leaf(L,k,&v); if(!n) continue;
+        int cnt=bt_count(n), p=bt_pos(n,cnt,k), hit=p<cnt && bt_ld(&n->key[p])==k;
+        if(bt_check(n,v)) return hit?0:-1;
+    }
+}
+// Moves the upper half of full node n (locked) into the new node r; returns the separator.
+static int bt_split(btnode_t *n,btnode_t *r){
+    int m=BT_MAX/2, sep;
+    if(n->leaf){
+        r->n=BT_MAX-m; for(int i=0;i<r->n;i++) r->key[i]=n->key[m+i];
+        sep=r->key[0]; r->next=n->next; __atomic_store_n(&n->next,r,__ATOMIC_RELEASE);
+    } else {
+        sep=n->key[m]; r->n=BT_MAX-m-1;
+        for(int i=0;i<r->n;i++) r->key[i]=n->key[m+1+i];
+        for(int i=0;i<=r->n;i++) r->child[i]=n->child[m+1+i];
+    }
+    bt_st(&n->n,m); return sep;
+}
+static void bt_insert_at(btnode_t *n,int p,int k,btnode_t *right){
+    int cnt=n->n;
+    for(int i=cnt;i>p;i--) bt_st(&n->key[i],n->key[i-1]);
+    if(right) for(int i=cnt+1;i>p+1;i--) bt_st(&n->child[i],n->child[i-1]);
+    bt_st(&n->key[p],k); if(right) bt_st(&n->child[p+1],right);
+    bt_st(&n->n,cnt+1);
+}
+static int bt_insert(list_t *L,int k){
+restart:;
+    btnode_t *n=__atomic_load_n(&L->root,__ATOMIC_ACQUIRE), *par=NULL; uint64_t v=bt_read_lock(n), pv=0;
+    if(n!=__atomic_load_n(&L->root,__ATOMIC_ACQUIRE)) goto restart;
+    for(;;){
+        if(bt_count(n)==BT_MAX){
+            // par was not full when we passed it, and locking it proves it hasn't changed since.
+            if(par && !bt_upgrade(par,pv)) goto restart;
+            if(!bt_upgrade(n,v)){ if(par) bt_unlock(par); goto restart; }
+            if(!par && n!=__atomic_load_n(&L->root,__ATOMIC_ACQUIRE)){ bt_unlock(n); goto restart; }
+            btnode_t *r=bt_new(n->leaf), *root=par?NULL:bt_new(0);
+            if(!r || (!par && !root)){ free(r); free(root); bt_unlock(n); if(par) bt_unlock(par); return -1; }
+            int sep=bt_split(n,r);
+            if(par) bt_insert_at(par,bt_pos(par,par->n,sep),sep,r);
+            else { root->n=1; root->key[0]=sep; root->child[0]=n; root->child[1]=r; __atomic_store_n(&L->root,root,__ATOMIC_RELEASE); }
+            bt_unlock(n); if(par) bt_unlock(par);
+            goto restart;
+        }
+        if(par && !bt_check(par,pv)) goto restart;
+        if(n->leaf) break;
+        btnode_t *c=bt_ld(&n->child[bt_pos(n,bt_count(n),k)]);
+        if(!bt_check(n,v)) goto restart;
+        uint64_t cv=bt_read_lock(c);
+        par=n; pv=v; n=c; v=cv;
+    }
+    if(!bt_upgrade(n,v)) goto restart;
+    int p=bt_pos(n,n->n,k), rv=-1;
+    if(p>=n->n || n->key[p]!=k){ bt_insert_at(n,p,k,NULL); rv=0; }
+    bt_unlock(n); return rv;
+}
+static int bt_delete(list_t *L,int k){
+    for(;;){
+        uint64_t v; btnode_t *n=bt_find_leaf(L,k,&v);
+        if(!n || !bt_upgrade(n,v)) continue;
+        int cnt=n->n, p=bt_pos(n,cnt,k), rv=-1;
+        if(p<cnt && n->key[p]==k){ for(int i=p;i<cnt-1;i++) bt_st(&n->key[i],n->key[i+1]); bt_st(&n->n,cnt-1); rv=0; }
+        bt_unlock(n); return rv;
+    }
+}
+// Visits up to len keys >= k in order along the leaf chain; returns how many
+// and their sum in *sum. A leaf that changed under us restarts the scan.
+static int bt_scan(list_t *L,int k,int len,long *sum){
+restart:;
+    uint64_t v; btnode_t *n=bt_find_leaf(L,k,&v); if(!n) goto restart;
+    int got=0, from=k; long s=0;
+    for(;;){
+        int cnt=bt_count(n), p=bt_pos(n,cnt,from), take=cnt-p<len-got?cnt-p:len-got;
+        long part=0; for(int i=p;i<p+take;i++) part+=bt_ld(&n->key[i]);
+        btnode_t *nx=__atomic_load_n(&n->next,__ATOMIC_ACQUIRE);
+        if(!bt_check(n,v)) goto restart;
+        got+=take; s+=part;
+        if(!nx || got>=len) break;
+        v=bt_read_lock(nx); n=nx; from=INT_MIN;
+    }
+    *sum=s; return got;
+}
+static void bt_free(btnode_t *n){ if(!n->leaf) for(int i=0;i<=n->n;i++) bt_free(n->child[i]); free(n); }
+
 int list_insert(list_t *L,int key){
-    node_t *n=(node_t*)malloc(sizeof(node_t)); if(!n) return -1;
-    n->key=key; n->next=NULL; pthread_mutex_init(&n->lock,NULL);
-    if(!L->hoh){
-        pthread_mutex_lock(&L->lock); n->next=L->head; L->head=n; pthread_mutex_unlock(&L->lock);
+    if(L->mode==LIST_BTREE) return bt_insert(L,key);
+    if(L->mode==LIST_LAZY) return lazy_insert(L,key);
+    lnode_t *n=lnode_new(L,key,NULL); if(!n) return -1;
+    if(L->mode==LIST_SINGLE){
+        lock_acquire(&L->lock); n->next=L->head; L->head=n; lock_release(&L->lock);
     } else {
-        pthread_mutex_lock(&L->lock);
-        if(L->head) pthread_mutex_lock(&L->head->lock);
+        lock_acquire(&L->lock);
+        if(L->head) lock_acquire(&L->head->lock);
         n->next=L->head; L->head=n;
-        if(n->next) pthread_mutex_unlock(&n->next->lock);
-        pthread_mutex_unlock(&L->lock);
+        if(n->next) lock_release(&n->next->lock);
+        lock_release(&L->lock);
     }
     return 0;
 }
 int list_lookup(list_t *L,int key){
-    if(!L->hoh){
-        int rv=-1; pthread_mutex_lock(&L->lock);
-        for(node_t*c=L->head;c;c=c->next) if(c->key==key){rv=0;break;}
-        pthread_mutex_unlock(&L->lock); return rv;
+    if(L->mode==LIST_BTREE) return bt_lookup(L,key);
+    if(L->mode==LIST_LAZY) return lazy_lookup(L,key);
+    if(L->mode==LIST_SINGLE){
+        int rv=-1; lock_acquire(&L->lock);
+        for(lnode_t*c=L->head;c;c=c->next) if(c->key==key){rv=0;break;}
+        lock_release(&L->lock); return rv;
     } else {
-        pthread_mutex_lock(&L->lock); node_t *c=L->head; if(c) pthread_mutex_lock(&c->lock); pthread_mutex_unlock(&L->lock);
+        lock_acquire(&L->lock); lnode_t *c=L->head; if(c) lock_acquire(&c->lock); lock_release(&L->lock);
         while(c){
-            if(c->key==key){ pthread_mutex_unlock(&c->lock); return 0; }
-            node_t*n=c->next; if(n) pthread_mutex_lock(&n->lock); pthread_mutex_unlock(&c->lock); c=n;
+            if(c->key==key){ lock_release(&c->lock); return 0; }
+            lnode_t*n=c->next; if(n) lock_acquire(&n->lock); lock_release(&c->lock); c=n;
         }
         return -1;
     }
 }
-typedef struct { list_t *L; int *keys; long n; } q4_arg_t;
-void* q4_worker(void*arg){ q4_arg_t*a=(q4_arg_t*)arg; for(long i=0;i<a->n;i++) list_lookup(a->L,a->keys[i]); return NULL; }
-int run_q4(int threads,long ops){
-    int N=threads*(int)ops; int *keys=(int*)malloc(sizeof(int)*N); for(int i=0;i<N;i++) keys[i]=i;
-    list_t A,B; list_init(&A,0); list_init(&B,1);
-    for(int i=0;i<N;i++){ list_insert(&A,keys[i]); list_insert(&B,keys[i]); }
+int list_delete(list_t *L,int key){
+    lnode_t *victim=NULL;
+    if(L->mode==LIST_BTREE) return bt_delete(L,key);
+    if(L->mode==LIST_LAZY) return lazy_delete(L,key);
+    if(L->mode==LIST_SINGLE){
+        lock_acquire(&L->lock);
+        for(lnode_t**pp=&L->head;*pp;pp=&(*pp)->next) if((*pp)->key==key){ victim=*pp; *pp=victim->next; break; }
+        lock_release(&L->lock);
+    } else {
+        // The list lock guards L->head, so hold it until we are past the first node.
+        lock_acquire(&L->lock); lnode_t *p=L->head;
+        if(!p){ lock_release(&L->lock); return -1; }
+        lock_acquire(&p->lock);
+        if(p->key==key){ victim=p; L->head=p->next; lock_release(&p->lock); lock_release(&L->lock); }
+        else {
+            lock_release(&L->lock);
+            for(lnode_t *c=p->next;c;c=p->next){
+                lock_acquire(&c->lock);
+                if(c->key==key){ victim=c; p->next=c->next; lock_release(&c->lock); break; }
+                lock_release(&p->lock); p=c;
+            }
+            lock_release(&p->lock);
+        }
+        if(victim) lock_destroy(&victim->lock);
+    }
+    if(!victim) return -1;
+    node_free(victim,sizeof(lnode_t)); return 0;
+}
+// Range scan: ordered modes only (lazy, btree); -1 for the unsorted lists.
+int list_scan(list_t *L,int key,int len,long *sum){
+    if(L->mode==LIST_BTREE) return bt_scan(L,key,len,sum);
+    if(L->mode==LIST_LAZY) return lazy_scan(L,key,len,sum);
+    return -1;
+}
+void list_destroy(list_t *L){
+    if(L->root){ bt_free(L->root); L->root=NULL; }
+    for(lnode_t*c=L->head,*n;c;c=n){ n=c->next; if(L->mode!=LIST_SINGLE) lock_destroy(&c->lock); if(!g_use_pool) node_free(c,sizeof(lnode_t)); }
+    L->head=NULL; lock_destroy(&L->lock);
+}
+
+// Each thread works on its own slice of keys: a read looks up the next key, a
+// write alternately deletes a key and puts it back, so the list size is stable.
+// With scan_len>0 every read is a range scan of scan_len keys from that key.
+static inline uint32_t xorshift32(uint32_t *s){ uint32_t x=*s; x^=x<<13; x^=x>>17; x^=x<<5; return *s=x; }
+typedef struct { list_t *L; int *keys; long n; int read_pct, scan_len; long sum; const wl_op_t *ops; wstat_t st; } q4_arg_t;
+void* q4_worker(void*arg){
+    q4_arg_t*a=(q4_arg_t*)arg; uint32_t seed=0x9e3779b9u^(uint32_t)a->keys[0]; long wr=0, sum=0, s;
+    wstat_t w=a->st; w.start=now_ns();
+    for(long i=0;a->ops && i<a->n;i++){
+        int k=a->ops[i].key;
+        switch(a->ops[i].op){
+        case WL_INSERT: OP(&w,OP_INSERT,list_insert(a->L,k)); break;
+        case WL_DELETE: OP(&w,OP_DELETE,list_delete(a->L,k)); break;
+        default: if(a->scan_len>0){ OP(&w,OP_SCAN,list_scan(a->L,k,a->scan_len,&s)); sum+=s; } else OP(&w,OP_LOOKUP,list_lookup(a->L,k)); break;
+        }
+    }
+    for(long i=0;!a->ops && i<a->n;i++){
+        if(a->read_pct>=100 || (int)(xorshift32(&seed)%100)<a->read_pct){
+            if(a->scan_len>0){ OP(&w,OP_SCAN,list_scan(a->L,a->keys[i],a->scan_len,&s)); sum+=s; }
+            else OP(&w,OP_LOOKUP,list_lookup(a->L,a->keys[i]));
+            continue;
+        }
+        int k=a->keys[(wr/2)%a->n];
+        if(wr++&1) OP(&w,OP_INSERT,list_insert(a->L,k)); else OP(&w,OP_DELETE,list_delete(a->L,k));
+    }
+    w.end=now_ns(); a->sum=sum; a->st=w; return NULL;
+}
+static const char *list_mode_names[LIST_NMODES]={"single","hoh","lazy","btree"};
+static double run_q4_mode(list_t *L,int threads,long ops,int *keys,int read_pct,int scan_len,wl_op_t **streams){
     pthread_t *t = (pthread_t*)malloc(sizeof(pthread_t)*threads);
     q4_arg_t *a = (q4_arg_t*)malloc(sizeof(q4_arg_t)*threads);
-    uint64_t s1=now_us();
-    for(int i=0;i<threads;i++){ a[i]=(q4_arg_t){.L=&A,.keys=&keys[i*ops],.n=ops}; pthread_create(&t[i],NULL,q4_worker,&a[i]); }
-    for(int i=0;i<threads;i++) pthread_join(t[i],NULL);
-    uint64_t e1=now_us();
-    uint64_t s2=now_us();
-    for(int i=0;i<threads;i++){ a[i]=(q4_arg_t){.L=&B,.keys=&keys[i*ops],.n=ops}; pthread_create(&t[i],NULL,q4_worker,&a[i]); }
-    for(int i=0;i<threads;i++) pthread_join(t[i],NULL);
-    uint64_t e2=now_us();
-    printf("[Q4] threads=%d ops_each=%ld single=%.3fms hoh=%.3fms\n",threads,ops,elapsed_ms(s1,e1),elapsed_ms(s2,e2));
-    free(keys); free(t); free(a); return 0;
+    uint64_t s=run_begin();
+    for(int i=0;i<threads;i++){ a[i]=(q4_arg_t){.L=L,.keys=&keys[i*ops],.n=ops,.read_pct=read_pct,.scan_len=scan_len,.ops=streams?streams[i]:NULL}; wstat_init(&a[i].st); spawn_worker(&t[i],q4_worker,&a[i],i,threads); }
+    for(int i=0;i<threads;i++) join_worker(&t[i]);
+    uint64_t e=run_end();
+    wstat_t *ws[threads]; for(int i=0;i<threads;i++) ws[i]=&a[i].st;
+    report_lat("q4",list_mode_names[L->mode],threads,ws);
+    for(int i=0;i<threads;i++) wstat_free(&a[i].st);
+    free(t); free(a); return elapsed_ms(s,e);
+}
+// Scans only make sense on the sorted structures, so scan_len>0 skips single and hoh.
+// With a workload every structure starts with the even keys of the key space
+// and all of them replay the same streams (read_pct sets the mix unless --mix
+// does). single and hoh don't check for duplicates, so there an insert of a
+// present key adds a second copy.
+int run_q4(int threads,long ops,int read_pct,int scan_len){
+    int N=threads*(int)ops; int *keys=(int*)malloc(sizeof(int)*N); for(int i=0;i<N;i++) keys[i]=i;
+    list_t L[LIST_NMODES]; double ms[LIST_NMODES]; int m0=scan_len>0?LIST_LAZY:0;
+    wl_t wl; wl_op_t **streams=NULL; int fill=N, step=1;
+    if(g_wl_on){ int rp=read_pct<0?0:read_pct>100?100:read_pct; wl=wl_for(N,(100-rp)/2,rp,100-rp-(100-rp)/2); streams=wl_streams(&wl,threads,ops); fill=(int)wl.keys; step=2; }
+    for(int m=m0;m<LIST_NMODES;m++){
+        list_init(&L[m],m);
+        if(m==LIST_LAZY) for(int i=(fill-1)/step*step;i>=0;i-=step) list_insert(&L[m],i);  // descending = O(1) sorted inserts
+        else for(int i=0;i<fill;i+=step) list_insert(&L[m],i);
+        ms[m]=run_q4_mode(&L[m],threads,ops,keys,read_pct,scan_len,streams);
+    }
+    double total=(double)threads*ops;
+    printf("[Q4] threads=%d ops_each=%ld read_pct=%d",threads,ops,read_pct);
+    if(scan_len>0) printf(" scan_len=%d",scan_len);
+    for(int m=m0;m<LIST_NMODES;m++) printf(" %s=%.3fms",list_mode_names[m],ms[m]);
+    for(int m=m0;m<LIST_NMODES;m++) printf(" %s_ops_s=%.0f",list_mode_names[m],total*1000.0/ms[m]);
+    if(streams){ char d[128]; printf(" %s",wl_describe(&wl,d,sizeof(d))); wl_streams_free(streams,threads); }
+    printf("\n");
+    report_reclaim("q4","lazy",ms[LIST_LAZY]);
+    for(int m=m0;m<LIST_NMODES;m++) list_destroy(&L[m]);
+    pool_release_all();
+    free(keys); return 0;
 }
 
 // ==============================================================================
-//// ==== Q5 & Q6: Hash Table (Global Lock vs Per-bucket) =======================
-typedef struct bucket { node_t *head; pthread_mutex_t lock; } bucket_t;
-typedef struct { bucket_t *b; int nb; pthread_mutex_t glock; int per_bucket; } hash_t;
-void hash_init(hash_t *H,int nb,int per){ H->nb=nb>0?nb:101; H->per_bucket=per; H->b=(bucket_t*)calloc(H->nb,sizeof(bucket_t)); for(int i=0;i<H->nb;i++) pthread_mutex_init(&H->b[i].lock,NULL); pthread_mutex_init(&H->glock,NULL); }
+//// ==== Q5, Q6 & Q7: Hash Table (Global Lock vs Per-bucket vs Lock-free) =====
+enum { HASH_GLOBAL=0, HASH_BUCKET=1, HASH_LOCKFREE=2, HASH_RESIZE=3 };
+typedef struct node { int key; struct node *next; } node_t;
+typedef struct bucket { node_t *head; lock_t lock; int moved; } bucket_t;
+// Lock-free chains (Harris): a node is logically deleted by setting the low bit
+// of its own next pointer; anyone who walks past a marked node may CAS it out.
+// Whoever's CAS unlinks a node retires it (common/reclaim.h), since a
+// lock-free reader may still be on it.
+#define LF_MARKED(p)  ((uintptr_t)(p)&1)
+#define LF_MARK(p)    ((node_t*)((uintptr_t)(p)|1))
+#define LF_UNMARK(p)  ((node_t*)((uintptr_t)(p)&~(uintptr_t)1))
+static void lf_insert(bucket_t *b,node_t *n){
+    node_t *h=__atomic_load_n(&b->head,__ATOMIC_ACQUIRE);
+    do { n->next=h; } while(!__atomic_compare_exchange_n(&b->head,&h,n,1,__ATOMIC_RELEASE,__ATOMIC_ACQUIRE));
+}
+// Wait-free: one pass over the chain as it was when we started, never retries.
+// Only safe under ebr or none, where nothing a reader can reach is freed.
+static int lf_lookup(bucket_t *b,int k){
+    for(node_t *c=__atomic_load_n(&b->head,__ATOMIC_ACQUIRE);c;){
+        node_t *nx=__atomic_load_n(&c->next,__ATOMIC_ACQUIRE);
+        if(c->key==k && !LF_MARKED(nx)) return 0;
+        c=LF_UNMARK(nx);
+    }
+    return -1;
+}
+// Finds k, unlinking every marked node on the way; with del, also marks and
+// unlinks the match. Delete always goes through here, and so does lookup
+// under hazard pointers: there each step publishes the next node (slots
+// PREV/CUR/NEXT hold the node owning prev, c and c->next) and then checks
+// that c->next and *prev haven't changed, so c was still linked and its
+// successor not yet retired (Michael's scheme); a failed check retries.
+enum { LF_HP_PREV, LF_HP_CUR, LF_HP_NEXT };
+static int lf_search(bucket_t *b,int k,int del){
+    int hp=reclaim_hp();
+retry:;
+    node_t **prev=&b->head, *c=reclaim_protect(LF_HP_CUR,prev);
+    while(c){
+        node_t *nx=__atomic_load_n(&c->next,__ATOMIC_ACQUIRE);
+        if(hp){
+            reclaim_hazard(LF_HP_NEXT,nx);
+            if(__atomic_load_n(&c->next,__ATOMIC_SEQ_CST)!=nx || __atomic_load_n(prev,__ATOMIC_SEQ_CST)!=c) goto retry;
+        }
+        if(LF_MARKED(nx)){   // help unlink; fails if prev itself got marked
+            node_t *exp=c;
+            if(!__atomic_compare_exchange_n(prev,&exp,LF_UNMARK(nx),0,__ATOMIC_ACQ_REL,__ATOMIC_ACQUIRE)) goto retry;
+            reclaim_retire(c,sizeof(node_t),node_free);
+            c=LF_UNMARK(nx); reclaim_hazard(LF_HP_CUR,c); continue;
+        }
+        if(c->key==k){
+            if(!del) return 0;
+            if(!__atomic_compare_exchange_n(&c->next,&nx,LF_MARK(nx),0,__ATOMIC_ACQ_REL,__ATOMIC_ACQUIRE)) goto retry;
+            node_t *exp=c;
+            if(__atomic_compare_exchange_n(prev,&exp,nx,0,__ATOMIC_ACQ_REL,__ATOMIC_RELAXED)) reclaim_retire(c,sizeof(node_t),node_free);
+            return 0;
+        }
+        prev=&c->next; reclaim_hazard(LF_HP_PREV,c); reclaim_hazard(LF_HP_CUR,nx); c=nx;
+    }
+    return -1;
+}
+
+// Resizable per-bucket table: when the load factor passes RH_LOAD a table twice
+// the size is linked in as t->next and the old buckets move over one at a time,
+// either on demand by whoever touches them or RH_HELP per insert via a shared
+// cursor, so no writer ever rehashes the whole table. A moved bucket is dead:
+// whoever finds it moved follows t->next. Tables only grow while no migration
+// is running. A drained table is retired (common/reclaim.h) when the head
+// moves past it, since a slow thread may still hold a pointer into one; under
+// hazard pointers a walk holds its current table in slot 0 or 1.
+#define RH_LOAD 2
+#define RH_HELP 2
+#define RH_FLUSH 64
+typedef struct htab { bucket_t *b; int nb; struct htab *next; int cursor, done; } htab_t;
+typedef struct { htab_t *first, *head, *cur; long count; lock_t resize_lock; } rhash_t;
+static __thread long rh_pending;
+static htab_t* htab_new(int nb){
+    htab_t *t=(htab_t*)calloc(1,sizeof(htab_t)); t->nb=nb; t->b=(bucket_t*)calloc(nb,sizeof(bucket_t));
+    for(int i=0;i<nb;i++) lock_init(&t->b[i].lock);
+    return t;
+}
+static void htab_free(void *p,size_t sz){
+    htab_t *t=(htab_t*)p; (void)sz;
+    for(int i=0;i<t->nb;i++) lock_destroy(&t->b[i].lock);
+    free(t->b); free(t);
+}
+void rhash_init(rhash_t *R,int nb){ R->first=R->head=R->cur=htab_new(nb>0?nb:1); R->count=0; lock_init(&R->resize_lock); }
+static int rh_index(htab_t *t,int k){ return (k%t->nb+t->nb)%t->nb; }
+// Caller holds t->b[i].lock and has checked it is not moved yet.
+static void rh_migrate_locked(rhash_t *R,htab_t *t,int i){
+    bucket_t *ob=&t->b[i]; htab_t *nt=t->next;
+    for(node_t *c=ob->head,*nx;c;c=nx){
+        nx=c->next; bucket_t *dst=&nt->b[rh_index(nt,c->key)];
+        lock_acquire(&dst->lock); c->next=dst->head; dst->head=c; lock_release(&dst->lock);
+    }
+    ob->head=NULL; ob->moved=1;
+    if(__atomic_add_fetch(&t->done,1,__ATOMIC_ACQ_REL)==t->nb){
+        __atomic_store_n(&R->head,nt,__ATOMIC_SEQ_CST);
+        R->first=nt;
+        reclaim_retire(t,sizeof(htab_t)+sizeof(bucket_t)*t->nb,htab_free);
+    }
+}
+// Steps from t (held in slot *s) to t->next. Under hp the next table goes in
+// the other slot and is trusted only while the head is still t or it: a table
+// is retired only once the head has moved past it. Otherwise the walk starts
+// again at the head, the oldest live table.
+static htab_t* rh_next(rhash_t *R,htab_t *t,int *s){
+    htab_t *nt=__atomic_load_n(&t->next,__ATOMIC_ACQUIRE);
+    if(!reclaim_hp()) return nt;
+    reclaim_hazard(*s^=1,nt);
+    htab_t *h=__atomic_load_n(&R->head,__ATOMIC_SEQ_CST);
+    return h==t || h==nt ? nt : reclaim_protect(*s,&R->head);
+}
+static void rh_help(rhash_t *R){
+    htab_t *t=reclaim_protect(0,&R->head);
+    if(!__atomic_load_n(&t->next,__ATOMIC_ACQUIRE)) return;
+    for(int j=0;j<RH_HELP;j++){
+        int i=__atomic_fetch_add(&t->cursor,1,__ATOMIC_RELAXED); if(i>=t->nb) return;
+        lock_acquire(&t->b[i].lock); if(!t->b[i].moved) rh_migrate_locked(R,t,i); lock_release(&t->b[i].lock);
+    }
+}
+static void rh_maybe_grow(rhash_t *R){
+    long n=__atomic_add_fetch(&R->count,rh_pending,__ATOMIC_RELAXED); rh_pending=0;
+    htab_t *c=reclaim_protect(0,&R->cur);
+    if(n<=(long)RH_LOAD*c->nb || __atomic_load_n(&R->head,__ATOMIC_ACQUIRE)!=c) return;
+    if(!lock_try(&R->resize_lock)) return;
+    if(R->head==c && R->cur==c && c->nb<(1<<30)){
+        htab_t *nt=htab_new(c->nb*2);
+        __atomic_store_n(&c->next,nt,__ATOMIC_RELEASE);   // from here on c's buckets drain into nt
+        __atomic_store_n(&R->cur,nt,__ATOMIC_RELEASE);
+    }
+    lock_release(&R->resize_lock);
+}
+// Returns the live bucket for k, locked. Writers migrate an old bucket first so
+// new keys always land in the newest table.
+static bucket_t* rh_lock_bucket(rhash_t *R,int k,int migrate){
+    int s=0; htab_t *t=reclaim_protect(s,&R->head);
+    for(;;){
+        int i=rh_index(t,k); bucket_t *b=&t->b[i];
+        lock_acquire(&b->lock);
+        if(!b->moved){
+            if(!migrate || !__atomic_load_n(&t->next,__ATOMIC_ACQUIRE)) return b;
+            rh_migrate_locked(R,t,i);
+        }
+        lock_release(&b->lock);
+        t=rh_next(R,t,&s);
+    }
+}
+// Nodes are only reached under a bucket lock, so only tables need reclaim_*.
+void rhash_insert(rhash_t *R,node_t *n){
+    reclaim_enter();
+    bucket_t *b=rh_lock_bucket(R,n->key,1);
+    n->next=b->head; b->head=n; lock_release(&b->lock);
+    rh_help(R);
+    if(++rh_pending>=RH_FLUSH) rh_maybe_grow(R);
+    reclaim_exit();
+}
+int rhash_lookup(rhash_t *R,int k){
+    reclaim_enter();
+    int rv=-1; bucket_t *b=rh_lock_bucket(R,k,0);
+    for(node_t*c=b->head;c;c=c->next) if(c->key==k){rv=0;break;}
+    lock_release(&b->lock); reclaim_exit(); return rv;
+}
+node_t* rhash_remove(rhash_t *R,int k){
+    reclaim_enter();
+    node_t *victim=NULL; bucket_t *b=rh_lock_bucket(R,k,0);
+    for(node_t**pp=&b->head;*pp;pp=&(*pp)->next) if((*pp)->key==k){ victim=*pp; *pp=victim->next; break; }
+    lock_release(&b->lock); reclaim_exit(); return victim;
+}
+int rhash_buckets(rhash_t *R){ return __atomic_load_n(&R->cur,__ATOMIC_ACQUIRE)->nb; }
+void rhash_destroy(rhash_t *R){
+    for(htab_t *t=R->first,*nt;t;t=nt){
+        nt=t->next;
+        for(int i=0;i<t->nb;i++){ if(!g_use_pool) for(node_t*c=t->b[i].head,*cn;c;c=cn){ cn=c->next; node_free(c,sizeof(node_t)); } lock_destroy(&t->b[i].lock); }
+        free(t->b); free(t);
+    }
+    R->first=R->head=R->cur=NULL;
+}
+
+typedef struct { bucket_t *b; int nb; lock_t glock; int engine; rhash_t rh; } hash_t;
+// Buckets are split into one contiguous slice per thread; under --place each
+// slice is initialized (first-touched) by a thread placed like its worker, so
+// the table is spread over the nodes the workers run on.
+static void hash_init_slice(int tid,int threads,void *arg){
+    hash_t *H=(hash_t*)arg; int lo=(int)((long)H->nb*tid/threads), hi=(int)((long)H->nb*(tid+1)/threads);
+    for(int i=lo;i<hi;i++){ H->b[i].head=NULL; H->b[i].moved=0; lock_init(&H->b[i].lock); }
+}
+void hash_init(hash_t *H,int nb,int engine,int threads){
+    H->nb=nb>0?nb:101; H->engine=engine; H->b=NULL; lock_init(&H->glock);
+    if(engine==HASH_RESIZE){ rhash_init(&H->rh,nb); return; }
+    H->b=(bucket_t*)place_alloc(sizeof(bucket_t)*H->nb); if(!H->b) abort();
+    if(g_place) place_touch(threads<H->nb?threads:H->nb,hash_init_slice,H); else hash_init_slice(0,1,H);
+}
 int hfunc(hash_t*H,int k){ return (k%H->nb+H->nb)%H->nb; }
+int hash_buckets(hash_t*H){ return H->engine==HASH_RESIZE? rhash_buckets(&H->rh) : H->nb; }
+// Frees every node still reachable (with --arena the pool's bulk release does it).
+void hash_destroy(hash_t*H){
+    if(H->engine==HASH_RESIZE){ rhash_destroy(&H->rh); return; }
+    for(int i=0;i<H->nb;i++){ if(!g_use_pool) for(node_t*c=LF_UNMARK(H->b[i].head),*cn;c;c=cn){ cn=LF_UNMARK(c->next); node_free(c,sizeof(node_t)); } lock_destroy(&H->b[i].lock); }
+    place_free(H->b,sizeof(bucket_t)*H->nb); H->b=NULL;
+}
+
+static lock_t* hash_lock_for(hash_t*H,int b){ return H->engine==HASH_GLOBAL? &H->glock : &H->b[b].lock; }
 void hash_insert(hash_t*H,int k){
-    int b=hfunc(H,k); node_t*n=(node_t*)malloc(sizeof(node_t)); if(!n) return; n->key=k; pthread_mutex_init(&n->lock,NULL);
-    if(!H->per_bucket){ pthread_mutex_lock(&H->glock); n->next=H->b[b].head; H->b[b].head=n; pthread_mutex_unlock(&H->glock); }
-    else { pthread_mutex_lock(&H->b[b].lock); n->next=H->b[b].head; H->b[b].head=n; pthread_mutex_unlock(&H->b[b].lock); }
-}
-typedef struct { hash_t *H; int start; int n; } q56_arg_t;
-void* q56_worker(void*arg){ q56_arg_t*a=(q56_arg_t*)arg; for(int i=0;i<a->n;i++) hash_insert(a->H,a->start+i); return NULL; }
-int run_hash(int threads,int nops,int nb,int per){
-    hash_t H; hash_init(&H,nb,per);
+    int b=H->b?hfunc(H,k):0; node_t*n=(node_t*)node_alloc(sizeof(node_t)); if(!n) return; n->key=k;
+    if(H->engine==HASH_LOCKFREE){ lf_insert(&H->b[b],n); return; }
+    if(H->engine==HASH_RESIZE){ rhash_insert(&H->rh,n); return; }
+    lock_t *l=hash_lock_for(H,b);
+    lock_acquire(l); n->next=H->b[b].head; H->b[b].head=n; lock_release(l);
+}
+int hash_lookup(hash_t*H,int k){
+    if(H->engine==HASH_RESIZE) return rhash_lookup(&H->rh,k);
+    int b=hfunc(H,k), rv=-1;
+    if(H->engine==HASH_LOCKFREE){
+        reclaim_enter(); rv=reclaim_hp()? lf_search(&H->b[b],k,0) : lf_lookup(&H->b[b],k); reclaim_exit();
+        return rv;
+    }
+    lock_t *l=hash_lock_for(H,b);
+    lock_acquire(l); for(node_t*c=H->b[b].head;c;c=c->next) if(c->key==k){rv=0;break;} lock_release(l);
+    return rv;
+}
+int hash_delete(hash_t*H,int k){
+    node_t *victim=NULL;
+    if(H->engine==HASH_RESIZE) victim=rhash_remove(&H->rh,k);
+    else {
+        int b=hfunc(H,k);
+        if(H->engine==HASH_LOCKFREE){ reclaim_enter(); int rv=lf_search(&H->b[b],k,1); reclaim_exit(); return rv; }
+        lock_t *l=hash_lock_for(H,b);
+        lock_acquire(l);
+        for(node_t**pp=&H->b[b].head;*pp;pp=&(*pp)->next) if((*pp)->key==k){ victim=*pp; *pp=victim->next; break; }
+        lock_release(l);
+    }
+    if(!victim) return -1;
+    node_free(victim,sizeof(node_t)); return 0;
+}
+
+// Each worker inserts its keys, looks every one of them up, then deletes every
+// other one; phase spans are taken across all threads (first start, last end).
+// With a workload there is one mixed phase instead, replaying the thread's stream.
+typedef struct { hash_t *H; int start; int n; long found, deleted; uint64_t t[4]; const wl_op_t *ops; wstat_t st; } q56_arg_t;
+void* q56_worker(void*arg){
+    q56_arg_t*a=(q56_arg_t*)arg; wstat_t w=a->st; long found=0, deleted=0; int rv;
+    if(a->ops){
+        w.start=now_ns();
+        for(int i=0;i<a->n;i++){
+            int k=a->ops[i].key;
+            if(a->ops[i].op==WL_INSERT) OP(&w,OP_INSERT,hash_insert(a->H,k));
+            else if(a->ops[i].op==WL_LOOKUP){ OP(&w,OP_LOOKUP,rv=hash_lookup(a->H,k)); found+=rv==0; }
+            else { OP(&w,OP_DELETE,rv=hash_delete(a->H,k)); deleted+=rv==0; }
+        }
+        w.end=now_ns(); a->found=found; a->deleted=deleted; a->st=w; return NULL;
+    }
+    w.start=a->t[0]=now_ns(); for(int i=0;i<a->n;i++) OP(&w,OP_INSERT,hash_insert(a->H,a->start+i));
+    a->t[1]=now_ns(); for(int i=0;i<a->n;i++){ OP(&w,OP_LOOKUP,rv=hash_lookup(a->H,a->start+i)); found+=rv==0; }
+    a->t[2]=now_ns(); for(int i=0;i<a->n;i+=2){ OP(&w,OP_DELETE,rv=hash_delete(a->H,a->start+i)); deleted+=rv==0; }
+    w.end=a->t[3]=now_ns(); a->found=found; a->deleted=deleted; a->st=w; return NULL;
+}
+int run_hash(int threads,int nops,int nb,int engine){
+    static const char *names[]={"Q5-global","Q6-per-bucket","Q7-lock-free","Q6-resizable"};
+    static const char *variants[]={"global","per-bucket","lock-free","resizable"};
+    hash_t H; hash_init(&H,nb,engine,threads);
     pthread_t *t = (pthread_t*)malloc(sizeof(pthread_t)*threads);
     q56_arg_t *a = (q56_arg_t*)malloc(sizeof(q56_arg_t)*threads);
-    uint64_t s=now_us();
-    for(int i=0;i<threads;i++){ a[i]=(q56_arg_t){.H=&H,.start=i*nops,.n=nops}; pthread_create(&t[i],NULL,q56_worker,&a[i]); }
-    for(int i=0;i<threads;i++) pthread_join(t[i],NULL);
-    uint64_t e=now_us();
-    printf("[%s] threads=%d ops_each=%d buckets=%d time_ms=%.3f\n", per? "Q6-per-bucket":"Q5-global", threads, nops, nb, elapsed_ms(s,e));
-    free(t); free(a); return 0;
+    wl_t wl; wl_op_t **ops=NULL;
+    // Workload runs start from the even keys, like Q4, and may insert a key twice (chains are multisets).
+    if(g_wl_on){ wl=wl_for((long)threads*nops,10,80,10); ops=wl_streams(&wl,threads,nops); for(long k=0;k<wl.keys;k+=2) hash_insert(&H,(int)k); }
+    uint64_t s=run_begin();
+    for(int i=0;i<threads;i++){ a[i]=(q56_arg_t){.H=&H,.start=i*nops,.n=nops,.ops=ops?ops[i]:NULL}; wstat_init(&a[i].st); spawn_worker(&t[i],q56_worker,&a[i],i,threads); }
+    for(int i=0;i<threads;i++) join_worker(&t[i]);
+    uint64_t e=run_end();
+    if(ops){
+        long found=0, deleted=0; char d[128];
+        for(int i=0;i<threads;i++){ found+=a[i].found; deleted+=a[i].deleted; }
+        printf("[%s] threads=%d ops_each=%d buckets=%d %s time_ms=%.3f mops=%.2f found=%ld deleted=%ld\n",
+            names[engine], threads, nops, hash_buckets(&H), wl_describe(&wl,d,sizeof(d)), elapsed_ms(s,e), (double)threads*nops/((e-s)/1e3), found, deleted);
+        wl_streams_free(ops,threads);
+    } else {
+        uint64_t lo[3], hi[3]; long found=0, deleted=0;
+        for(int p=0;p<3;p++){ lo[p]=UINT64_MAX; hi[p]=0; for(int i=0;i<threads;i++){ if(a[i].t[p]<lo[p]) lo[p]=a[i].t[p]; if(a[i].t[p+1]>hi[p]) hi[p]=a[i].t[p+1]; } }
+        for(int i=0;i<threads;i++){ found+=a[i].found; deleted+=a[i].deleted; }
+        printf("[%s] threads=%d ops_each=%d buckets=%d time_ms=%.3f insert_ms=%.3f lookup_ms=%.3f delete_ms=%.3f found=%ld deleted=%ld\n",
+            names[engine], threads, nops, hash_buckets(&H), elapsed_ms(s,e), elapsed_ms(lo[0],hi[0]), elapsed_ms(lo[1],hi[1]), elapsed_ms(lo[2],hi[2]), found, deleted);
+    }
+    wstat_t *ws[threads]; for(int i=0;i<threads;i++) ws[i]=&a[i].st;
+    report_lat(engine==HASH_GLOBAL?"q5":engine==HASH_LOCKFREE?"q7":"q6",variants[engine],threads,ws);
+    if(engine==HASH_LOCKFREE || engine==HASH_RESIZE) report_reclaim(engine==HASH_LOCKFREE?"q7":"q6",variants[engine],elapsed_ms(s,e));
+    for(int i=0;i<threads;i++) wstat_free(&a[i].st);
+    hash_destroy(&H); pool_release_all(); free(t); free(a); return 0;
+}
+
+// ==============================================================================
+//// ==== Q8: Insert Tail Latency (Fixed vs Resizable Per-bucket Table) =========
+// Always times every insert, with or without --lat.
+typedef struct { hash_t *H; int start; int n; wstat_t st; } q8_arg_t;
+void* q8_worker(void*arg){
+    q8_arg_t*a=(q8_arg_t*)arg; wstat_t w=a->st; w.start=now_ns();
+    for(int i=0;i<a->n;i++){ uint64_t t0=hr_ticks(); hash_insert(a->H,a->start+i); hist_record(w.lat[OP_INSERT],hr_ticks_end()-t0); w.ops[OP_INSERT]++; }
+    w.end=now_ns(); a->st=w; return NULL;
+}
+static void run_q8_table(int threads,long keys,int nb,int engine){
+    hash_t H; hash_init(&H,nb,engine,threads);
+    pthread_t *t = (pthread_t*)malloc(sizeof(pthread_t)*threads);
+    q8_arg_t *a = (q8_arg_t*)calloc(threads,sizeof(q8_arg_t));
+    int per=(int)(keys/threads);
+    double ns=hr_ns_per_tick();
+    for(int i=0;i<threads;i++){ wstat_init(&a[i].st); if(!a[i].st.lat[OP_INSERT]){ a[i].st.lat[OP_INSERT]=(hist_t*)malloc(sizeof(hist_t)); hist_init(a[i].st.lat[OP_INSERT]); } }
+    uint64_t s=run_begin();
+    for(int i=0;i<threads;i++){ a[i].H=&H; a[i].start=i*per; a[i].n=per; spawn_worker(&t[i],q8_worker,&a[i],i,threads); }
+    for(int i=0;i<threads;i++) join_worker(&t[i]);
+    uint64_t e=run_end();
+    hist_t all; hist_init(&all); for(int i=0;i<threads;i++) hist_merge(&all,a[i].st.lat[OP_INSERT]);
+    printf("[Q8] table=%s threads=%d keys=%ld start_buckets=%d final_buckets=%d time_ms=%.3f p50_ns=%.0f p99_ns=%.0f p999_ns=%.0f max_ns=%.0f\n",
+        engine==HASH_RESIZE?"resizable":"fixed", threads, (long)per*threads, nb, hash_buckets(&H), elapsed_ms(s,e),
+        hist_quantile(&all,0.50)*ns, hist_quantile(&all,0.99)*ns, hist_quantile(&all,0.999)*ns, all.max*ns);
+    wstat_t *ws[threads]; for(int i=0;i<threads;i++) ws[i]=&a[i].st;
+    report_lat("q8",engine==HASH_RESIZE?"resizable":"fixed",threads,ws);
+    if(engine==HASH_RESIZE) report_reclaim("q8","resizable",elapsed_ms(s,e));
+    for(int i=0;i<threads;i++) wstat_free(&a[i].st);
+    hash_destroy(&H); pool_release_all(); free(t); free(a);
+}
+int run_q8(int threads,long keys,int fixed_nb){
+    run_q8_table(threads,keys,fixed_nb,HASH_BUCKET);
+    run_q8_table(threads,keys,1,HASH_RESIZE);
+    return 0;
+}
+
+// ==============================================================================
+//// ==== Q9: Sharded Counter (Batched Updates, Exact vs Approximate Reads) =====
+// One padded shard per thread (same slot layout as the padded Q3 counter, so
+// --place makes every shard node-local). Only the owner writes a shard, so
+// add_n is a plain load+store: no lock, no atomic RMW, and one update covers
+// a whole batch of increments. Readers choose:
+//   sctr_read_sum    - walks every shard; exact once writers are quiet, and
+//                      never behind by more than the batches in flight
+//   sctr_read_approx - returns the last sum, re-walking at most once per
+//                      SCTR_REFRESH_NS (one reader wins the refresh, the rest
+//                      return the cached value without touching any shard);
+//                      the age check uses hr_ticks(), not a clock syscall
+#define SCTR_REFRESH_NS 1000000ULL
+typedef struct {
+    char *local; size_t stride, bytes; int nslots;
+    long cached __attribute__((aligned(CACHELINE))); uint64_t cached_at, refresh_ticks;
+} sctr_t;
+static void sctr_touch(int tid,int threads,void *arg){ (void)threads; PAD_SLOT((sctr_t*)arg,tid)->v=0; }
+void sctr_init(sctr_t *c,int nshards){
+    c->nslots=nshards>0?nshards:1; c->cached=0; c->cached_at=0;
+    c->refresh_ticks=(uint64_t)(SCTR_REFRESH_NS/hr_ns_per_tick());
+    c->stride=g_place?(size_t)getpagesize():sizeof(pad_slot_t); c->bytes=c->stride*c->nslots;
+    c->local=(char*)place_alloc(c->bytes); if(!c->local) abort();
+    if(g_place) place_touch(c->nslots,sctr_touch,c);
+}
+static inline void sctr_add_n(sctr_t *c,int tid,long n){
+    pad_slot_t *s=PAD_SLOT(c,tid);
+    __atomic_store_n(&s->v,__atomic_load_n(&s->v,__ATOMIC_RELAXED)+n,__ATOMIC_RELAXED);
+}
+long sctr_read_sum(sctr_t *c){
+    long sum=0;
+    for(int i=0;i<c->nslots;i++) sum+=__atomic_load_n(&PAD_SLOT(c,i)->v,__ATOMIC_RELAXED);
+    return sum;
+}
+long sctr_read_approx(sctr_t *c){
+    uint64_t now=hr_ticks(), at=__atomic_load_n(&c->cached_at,__ATOMIC_RELAXED);
+    if(now-at>=c->refresh_ticks && __atomic_compare_exchange_n(&c->cached_at,&at,now,0,__ATOMIC_RELAXED,__ATOMIC_RELAXED))
+        __atomic_store_n(&c->cached,sctr_read_sum(c),__ATOMIC_RELAXED);
+    return __atomic_load_n(&c->cached,__ATOMIC_RELAXED);
+}
+void sctr_free(sctr_t *c){ place_free(c->local,c->bytes); c->local=NULL; }
+
+// Each op is a read with probability read_pct%, otherwise add_n(batch).
+enum { Q9_LOCKED, Q9_EXACT, Q9_APPROX, Q9_NVARIANTS };
+static const char *q9_names[Q9_NVARIANTS]={"locked","sharded-exact","sharded-approx"};
+typedef struct { counter_t *ctr; sctr_t *sc; int variant, tid, batch, read_pct; long ops, incs; volatile long sink; const wl_op_t *stream; wstat_t st; } q9_arg_t;
+void* q9_worker(void *arg){
+    q9_arg_t *a=(q9_arg_t*)arg; wstat_t w=a->st; uint32_t seed=0x9e3779b9u^(uint32_t)(a->tid+1); long incs=0, sink=0;
+    w.start=now_ns();
+    for(long i=0;i<a->ops;i++){
+        if(a->stream ? a->stream[i].op==WL_LOOKUP : a->read_pct>0 && (int)(xorshift32(&seed)%100)<a->read_pct){
+            if(a->variant==Q9_LOCKED) OP(&w,OP_LOOKUP,sink+=counter_get(a->ctr));
+            else if(a->variant==Q9_EXACT) OP(&w,OP_LOOKUP,sink+=sctr_read_sum(a->sc));
+            else OP(&w,OP_LOOKUP,sink+=sctr_read_approx(a->sc));
+        } else {
+            if(a->variant==Q9_LOCKED) OP(&w,OP_UPDATE,counter_add_n(a->ctr,a->batch));
+            else OP(&w,OP_UPDATE,sctr_add_n(a->sc,a->tid,a->batch));
+            incs+=a->batch;
+        }
+    }
+    w.end=now_ns(); a->incs=incs; a->sink=sink; a->st=w; return NULL;
+}
+static void run_q9_one(int threads,long ops,int batch,int read_pct,int variant){
+    counter_t c; counter_init(&c); sctr_t sc; sctr_init(&sc,threads);
+    pthread_t *t=(pthread_t*)malloc(sizeof(pthread_t)*threads);
+    q9_arg_t *a=(q9_arg_t*)calloc(threads,sizeof(q9_arg_t));
+    wl_t wl; wl_op_t **st=NULL;
+    if(g_wl_on){ wl=wl_for(1,(100-read_pct)/2,read_pct,100-read_pct-(100-read_pct)/2); st=wl_streams(&wl,threads,ops); read_pct=wl.mix[WL_LOOKUP]; }
+    uint64_t s=run_begin();
+    for(int i=0;i<threads;i++){ a[i].stream=st?st[i]:NULL; a[i].ctr=&c; a[i].sc=&sc; a[i].variant=variant; a[i].tid=i; a[i].batch=batch; a[i].read_pct=read_pct; a[i].ops=ops; wstat_init(&a[i].st); spawn_worker(&t[i],q9_worker,&a[i],i,threads); }
+    for(int i=0;i<threads;i++) join_worker(&t[i]);
+    uint64_t e=run_end();
+    long incs=0, reads=0; for(int i=0;i<threads;i++){ incs+=a[i].incs; reads+=a[i].st.ops[OP_LOOKUP]; }
+    long total=variant==Q9_LOCKED?counter_get(&c):sctr_read_sum(&sc);
+    double sec=(e-s)/1e9;
+    printf("[Q9] counter=%s threads=%d batch=%d read_pct=%d time_ms=%.3f incs=%ld reads=%ld minc_s=%.2f mread_s=%.3f exact=%s",
+        q9_names[variant],threads,batch,read_pct,elapsed_ms(s,e),incs,reads,incs/sec/1e6,reads/sec/1e6,total==incs?"yes":"NO");
+    if(st){ char d[128]; printf(" %s",wl_describe(&wl,d,sizeof(d))); }
+    printf("\n");
+    char var[48]; snprintf(var,sizeof(var),"%s/b%d/r%d",q9_names[variant],batch,read_pct);
+    wstat_t *ws[threads]; for(int i=0;i<threads;i++) ws[i]=&a[i].st;
+    report_lat("q9",var,threads,ws);
+    for(int i=0;i<threads;i++) wstat_free(&a[i].st);
+    wl_streams_free(st,threads); sctr_free(&sc); free(t); free(a);
+}
+// batch<=0 sweeps 1,8,64,512; read_pct<0 sweeps 0,1,10,50.
+int run_q9(int threads,long ops,int batch,int read_pct){
+    static const int batches[]={1,8,64,512}, mixes[]={0,1,10,50};
+    for(int bi=0;bi<4;bi++){ if(batch>0 && bi) break; int b=batch>0?batch:batches[bi];
+        for(int mi=0;mi<4;mi++){ if(read_pct>=0 && mi) break; int r=read_pct>=0?read_pct:mixes[mi];
+            for(int v=0;v<Q9_NVARIANTS;v++) run_q9_one(threads,ops,b,r,v);
+        }
+    }
+    return 0;
 }
 
 // ==============================================================================
 //// ==== Main Dispatch =========================================================
 static void usage(const char*p){
-    printf("Usage: %s q1 [samples]\n"
+    printf("Usage: %s [--arena] [--lat[=csv|json]] [--place=none|compact|scatter|numa]\n"
+           "          [--lock=mutex|ttas|ticket|mcs] [--tasks[=N]] [--perf] [--reclaim=none|ebr|hp]\n"
+           "          [--dist=uniform|zipf[:theta]|hotspot[:frac:pct]] [--mix=I:L:D] [--keys=N] <mode> ...\n"
+           "  --arena   allocate list/hash nodes from per-thread slabs (bulk-freed per run)\n"
+           "  --lat     time every op; print p50/p90/p99/p999/max per op and per thread\n"
+           "  --place   pin workers: fill cores (compact), spread over sockets (scatter)\n"
+           "            or bind thread blocks to NUMA nodes (numa); data is node-local\n"
+           "  --lock    lock used by every counter/list/hash structure (default mutex)\n"
+           "  --tasks   run workers as tasks on a work-stealing pool of N threads\n"
+           "            (default: one per CPU) instead of one pthread each\n"
+           "  --perf    count cycles, instructions, dTLB/LLC misses and HITM per run\n"
+           "  --reclaim when unlinked lazy-list/lock-free nodes and drained tables are\n"
+           "            freed: at run end (none), by epochs (ebr, default) or hazard pointers (hp)\n"
+           "  --dist, --mix, --keys\n"
+           "            replay pre-generated per-thread op streams in q2-q7 and q9: key\n"
+           "            distribution, insert:lookup:delete percentages, key space size\n"
+           "Modes: %s q1 [samples]\n"
            "       %s q2 <threads> <iters>\n"
-           "       %s q3 <threads> <iters> <threshold>\n"
-           "       %s q4 <threads> <ops>\n"
+           "       %s q3 <threads> <iters> <threshold> [locked|padded|both]\n"
+           "       %s q4 <threads> <ops> [read_pct=100] [scan_len=0]\n"
            "       %s q5 <threads> <ops> <buckets>\n"
-           "       %s q6 <threads> <ops> <buckets>\n",p,p,p,p,p,p);
+           "       %s q6 <threads> <ops> <buckets> [grow]\n"
+           "       %s q7 <threads> <ops> <buckets>\n"
+           "       %s q8 <threads> [keys=10000000] [fixed_buckets=1]\n"
+           "       %s q9 <threads> <ops> [batch|sweep] [read_pct|sweep]\n",p,p,p,p,p,p,p,p,p,p);
 }
 int main(int argc,char**argv){
+    int tasks=-1; wl_init(&g_wl);
+    while(argc>1 && !strncmp(argv[1],"--",2)){
+        if(!strcmp(argv[1],"--arena")) g_use_pool=1;
+        else if(!strcmp(argv[1],"--lat")||!strcmp(argv[1],"--lat=csv")) g_lat=LAT_CSV;
+        else if(!strcmp(argv[1],"--lat=json")) g_lat=LAT_JSON;
+        else if(!strncmp(argv[1],"--place=",8)){ int p=topo_parse_policy(argv[1]+8); if(p<0){usage(argv[0]);return 1;} place_setup(p); }
+        else if(!strncmp(argv[1],"--lock=",7)){ int k=lock_parse_kind(argv[1]+7); if(k<0){usage(argv[0]);return 1;} lock_set_kind(k); }
+        else if(!strcmp(argv[1],"--tasks")) tasks=0;
+        else if(!strncmp(argv[1],"--tasks=",8)) tasks=atoi(argv[1]+8);
+        else if(!strcmp(argv[1],"--perf")){ g_perf_on=1; perf_open(&g_perf); }
+        else if(!strncmp(argv[1],"--reclaim=",10)){ int m=reclaim_parse_mode(argv[1]+10); if(m<0){usage(argv[0]);return 1;} reclaim_set_mode(m); }
+        else if(!strncmp(argv[1],"--dist=",7)){ if(wl_parse_dist(&g_wl,argv[1]+7)){usage(argv[0]);return 1;} g_wl_on=1; }
+        else if(!strncmp(argv[1],"--mix=",6)){ if(wl_parse_mix(&g_wl,argv[1]+6)){usage(argv[0]);return 1;} g_wl_on=g_wl_mix_set=1; }
+        else if(!strncmp(argv[1],"--keys=",7)){ g_wl_keys=atol(argv[1]+7); if(g_wl_keys<1||g_wl_keys>INT_MAX){usage(argv[0]);return 1;} g_wl_on=1; }
+        else { usage(argv[0]); return 1; }
+        argv[1]=argv[0]; argv++; argc--;
+    }
+    if(tasks>=0) tasks_setup(tasks);
     if(argc<2){ usage(argv[0]); return 1; }
     if(!strcmp(argv[1],"q1")){ return run_q1(argc>2?atoi(argv[2]):100000); }
     if(!strcmp(argv[1],"q2")){ if(argc<4){usage(argv[0]);return 1;} return run_q2(atoi(argv[2]),atol(argv[3])); }
-    if(!strcmp(argv[1],"q3")){ if(argc<5){usage(argv[0]);return 1;} return run_q3(atoi(argv[2]),atol(argv[3]),atoi(argv[4])); }
-    if(!strcmp(argv[1],"q4")){ if(argc<4){usage(argv[0]);return 1;} return run_q4(atoi(argv[2]),atol(argv[3])); }
-    if(!strcmp(argv[1],"q5")){ if(argc<5){usage(argv[0]);return 1;} return run_hash(atoi(argv[2]),atoi(argv[3]),atoi(argv[4]),0); }
-    if(!strcmp(argv[1],"q6")){ if(argc<5){usage(argv[0]);return 1;} return run_hash(atoi(argv[2]),atoi(argv[3]),atoi(argv[4]),1); }
+    if(!strcmp(argv[1],"q3")){
+        if(argc<5){usage(argv[0]);return 1;}
+        int layout=2;
+        if(argc>5){ if(!strcmp(argv[5],"locked")) layout=0; else if(!strcmp(argv[5],"padded")) layout=1; else if(strcmp(argv[5],"both")){usage(argv[0]);return 1;} }
+        return run_q3(atoi(argv[2]),atol(argv[3]),atoi(argv[4]),layout);
+    }
+    if(!strcmp(argv[1],"q4")){ if(argc<4){usage(argv[0]);return 1;} return run_q4(atoi(argv[2]),atol(argv[3]),argc>4?atoi(argv[4]):100,argc>5?atoi(argv[5]):0); }
+    if(!strcmp(argv[1],"q5")){ if(argc<5){usage(argv[0]);return 1;} return run_hash(atoi(argv[2]),atoi(argv[3]),atoi(argv[4]),HASH_GLOBAL); }
+    if(!strcmp(argv[1],"q6")){ if(argc<5){usage(argv[0]);return 1;} return run_hash(atoi(argv[2]),atoi(argv[3]),atoi(argv[4]),argc>5&&!strcmp(argv[5],"grow")?HASH_RESIZE:HASH_BUCKET); }
+    if(!strcmp(argv[1],"q7")){ if(argc<5){usage(argv[0]);return 1;} return run_hash(atoi(argv[2]),atoi(argv[3]),atoi(argv[4]),HASH_LOCKFREE); }
+    if(!strcmp(argv[1],"q8")){ if(argc<3){usage(argv[0]);return 1;} return run_q8(atoi(argv[2]),argc>3?atol(argv[3]):10000000L,argc>4?atoi(argv[4]):1); }
+    if(!strcmp(argv[1],"q9")){
+        if(argc<4){usage(argv[0]);return 1;}
+        int batch=argc>4&&strcmp(argv[4],"sweep")?atoi(argv[4]):(argc>4?0:1), rp=argc>5&&strcmp(argv[5],"sweep")?atoi(argv[5]):(argc>5?-1:0);
+        return run_q9(atoi(argv[2]),atol(argv[3]),batch,rp);
+    }
     usage(argv[0]); return 1;
 }
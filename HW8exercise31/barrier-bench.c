@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "barrier-fast.h"
+#include "../common/hrtime.h"
+
+// ns per barrier episode for each barrier in barrier-fast.h, at 2, 4, ...
+// up to max_threads threads. Each thread writes the episode number to its own
+// slot before the barrier and checks a neighbour's slot after it, so a
+// barrier that lets anyone through early is reported as BROKEN.
+//
+// usage: barrier-bench [episodes=10000] [max_threads=128] [sem|sense|dissem|all]
+//
+// kind=sem runs on POSIX semaphores, or on the futex semaphore in
+// common_threads.h when built with -DFAST_SEM; sem= on each line says which.
+
+typedef struct {
+    long episode;
+} __attribute__((aligned(64))) slot_t;
+
+barrier_t b;
+slot_t *slots;
+int num_threads;
+long episodes;
+int broken;
+
+void *child(void *arg) {
+    int id = (int) (long) arg, next = (id + 1) % num_threads;
+    barrier(&b);                                   // warm up (and take a dissem id)
+    for (long e = 0; e < episodes; e++) {
+        __atomic_store_n(&slots[id].episode, e, __ATOMIC_RELAXED);
+        barrier(&b);
+        if (__atomic_load_n(&slots[next].episode, __ATOMIC_RELAXED) < e)
+            broken = 1;
+    }
+    return NULL;
+}
+
+static void run(int kind, int threads) {
+    pthread_t p[threads];
+    num_threads = threads;
+    broken = 0;
+    slots = calloc(threads, sizeof(slot_t));
+    barrier_set_kind(kind);
+    barrier_init(&b, threads);
+
+    uint64_t start = hr_now_ns();
+    for (int i = 0; i < threads; i++)
+        Pthread_create(&p[i], NULL, child, (void *) (long) i);
+    for (int i = 0; i < threads; i++)
+        Pthread_join(p[i], NULL);
+    uint64_t end = hr_now_ns();
+
+    // Thread start-up is included but amortized over the episodes.
+    printf("[barrier] kind=%s sem=%s threads=%d episodes=%ld time_ms=%.3f ns_per_episode=%.1f %s\n",
+           barrier_names[kind], kind == BARRIER_SEM ? SEM_IMPL : "-", threads, episodes,
+           hr_elapsed_ms(start, end), (double) (end - start) / (episodes + 1), broken ? "BROKEN" : "ok");
+    barrier_destroy(&b);
+    free(slots);
+}
+
+int main(int argc, char *argv[]) {
+    episodes = argc > 1 ? atol(argv[1]) : 10000;
+    int max_threads = argc > 2 ? atoi(argv[2]) : 128;
+    int only = -1;
+    if (argc > 3 && strcmp(argv[3], "all")) {
+        only = barrier_parse_kind(argv[3]);
+        if (only < 0) {
+            fprintf(stderr, "usage: %s [episodes=10000] [max_threads=128] [sem|sense|dissem|all]\n", argv[0]);
+            return 1;
+        }
+    }
+    for (int kind = 0; kind < BARRIER_NKINDS; kind++) {
+#ifndef HAVE_SEM
+        if (kind == BARRIER_SEM) continue;
+#endif
+        if (only >= 0 && kind != only) continue;
+        for (int t = 2; t <= max_threads; t *= 2)
+            run(kind, t);
+    }
+    return 0;
+}
@@ -0,0 +1,197 @@
+#ifndef __barrier_fast_h__
+#define __barrier_fast_h__
+
+// Reusable barriers behind one barrier_init()/barrier() API. The kind is
+// chosen with barrier_set_kind() before barrier_init() (default: sense).
+//
+//   sem     two-turnstile semaphore barrier (Downey 3.7): reusable, but the
+//           last arriver posts N times under one mutex, twice per episode
+//   sense   sense-reversing: one fetch_sub per arrival; the last arriver
+//           resets the count and flips a shared sense word that everyone
+//           else is waiting on
+//   dissem  dissemination barrier: ceil(log2 N) rounds in which thread i
+//           signals thread (i + 2^k) % N and waits for its own flag, so no
+//           word is shared by more than two threads and latency is O(log N)
+//
+// Waiters spin for BARRIER_SPIN polls, then set the PARKED bit in the word
+// they are waiting on and sleep on it with Futex_wait; whoever changes the
+// word sees PARKED and issues the Futex_wake. Short episodes never enter the
+// kernel. With more threads than online CPUs the waiter we'd be spinning for
+// can't be running, so barrier_init() turns spinning off and waits park at
+// once.
+//
+// dissem needs a thread index in [0, N): it is handed out on each thread's
+// first barrier() call and cached thread-locally (up to BARRIER_TLS barriers
+// per thread). The same N threads must use the barrier every episode.
+//
+// With -DTRACE every barrier() call is traced as arrive ... depart, and
+// each futex sleep inside it as park ... wake (common/trace.h).
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include "common_threads.h"
+
+enum { BARRIER_SEM, BARRIER_SENSE, BARRIER_DISSEM, BARRIER_NKINDS };
+static const char *barrier_names[BARRIER_NKINDS] = { "sem", "sense", "dissem" };
+
+#ifndef BARRIER_SPIN
+#define BARRIER_SPIN 2000
+#endif
+#define BARRIER_MAX_ROUNDS 8          // up to 256 threads for dissem
+#define BARRIER_TLS 4
+#define BARRIER_PARKED 2              // bit 0 of a waited-on word is the sense/flag
+
+typedef struct {
+    int flag[2][BARRIER_MAX_ROUNDS];  // [parity][round], written by partners
+    int parity, sense;                // private to the owning thread
+} __attribute__((aligned(64))) barrier_node_t;
+
+typedef struct __barrier_t {
+    int kind, num_threads, rounds, spin;
+    // sem
+#ifdef HAVE_SEM
+    Sem_t mutex, turnstile, turnstile2;
+#endif
+    int count;
+    // sense
+    int left __attribute__((aligned(64)));
+    int sense __attribute__((aligned(64)));
+    // dissem
+    barrier_node_t *node;
+    int next_id;
+} barrier_t;
+
+static int barrier_kind_ = BARRIER_SENSE;
+static inline void barrier_set_kind(int kind) { barrier_kind_ = kind; }
+static inline int barrier_parse_kind(const char *s) {
+    for (int i = 0; i < BARRIER_NKINDS; i++)
+        if (!strcmp(s, barrier_names[i])) return i;
+    return -1;
+}
+
+static inline void barrier_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __asm__ __volatile__("pause");
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// Waits until bit 0 of *word equals want.
+static inline void barrier_wait_word(int *word, int want, int spin) {
+    for (int i = 0; i < spin; i++) {
+        if ((__atomic_load_n(word, __ATOMIC_ACQUIRE) & 1) == want) return;
+        barrier_relax();
+    }
+    for (;;) {
+        int v = __atomic_load_n(word, __ATOMIC_ACQUIRE);
+        if ((v & 1) == want) return;
+        if (!(v & BARRIER_PARKED) &&
+            !__atomic_compare_exchange_n(word, &v, v | BARRIER_PARKED, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            continue;
+        trace_event(TR_PARK, word);
+        Futex_wait(word, v | BARRIER_PARKED);
+        trace_event(TR_WAKE, word);
+    }
+}
+// Sets *word to val (bit 0 only, PARKED cleared) and wakes any sleepers.
+static inline void barrier_set_word(int *word, int val) {
+    if (__atomic_exchange_n(word, val, __ATOMIC_ACQ_REL) & BARRIER_PARKED)
+        Futex_wake(word, INT_MAX);
+}
+
+void barrier_init(barrier_t *b, int num_threads) {
+    memset(b, 0, sizeof(*b));
+    b->kind = barrier_kind_;
+    b->num_threads = num_threads;
+    b->left = num_threads;
+    b->spin = num_threads <= sysconf(_SC_NPROCESSORS_ONLN) ? BARRIER_SPIN : 0;
+#ifdef HAVE_SEM
+    Sem_init(&b->mutex, 1);
+    Sem_init(&b->turnstile, 0);
+    Sem_init(&b->turnstile2, 0);
+#else
+    assert(b->kind != BARRIER_SEM);
+#endif
+    while ((1 << b->rounds) < num_threads) b->rounds++;
+    assert(b->rounds <= BARRIER_MAX_ROUNDS);
+    if (b->kind == BARRIER_DISSEM) {
+        int rc = posix_memalign((void **) &b->node, 64, sizeof(barrier_node_t) * num_threads);
+        assert(rc == 0);
+        memset(b->node, 0, sizeof(barrier_node_t) * num_threads);
+        for (int i = 0; i < num_threads; i++) b->node[i].sense = 1;
+    }
+}
+
+void barrier_destroy(barrier_t *b) {
+    free(b->node);
+    b->node = NULL;
+}
+
+static __thread struct { barrier_t *b; int id; } barrier_ids_[BARRIER_TLS];
+static inline int barrier_my_id(barrier_t *b) {
+    int i;
+    for (i = 0; i < BARRIER_TLS && barrier_ids_[i].b; i++)
+        if (barrier_ids_[i].b == b) return barrier_ids_[i].id;
+    assert(i < BARRIER_TLS && "thread uses too many dissemination barriers");
+    barrier_ids_[i].b = b;
+    barrier_ids_[i].id = __atomic_fetch_add(&b->next_id, 1, __ATOMIC_RELAXED);
+    assert(barrier_ids_[i].id < b->num_threads);
+    return barrier_ids_[i].id;
+}
+
+#ifdef HAVE_SEM
+static void barrier_sem(barrier_t *b) {
+    Sem_wait(&b->mutex);
+    if (++b->count == b->num_threads)
+        for (int i = 0; i < b->num_threads; i++) Sem_post(&b->turnstile);
+    Sem_post(&b->mutex);
+    Sem_wait(&b->turnstile);
+
+    // Second turnstile: nobody can lap the barrier before all have left it.
+    Sem_wait(&b->mutex);
+    if (--b->count == 0)
+        for (int i = 0; i < b->num_threads; i++) Sem_post(&b->turnstile2);
+    Sem_post(&b->mutex);
+    Sem_wait(&b->turnstile2);
+}
+#endif
+
+static void barrier_sense(barrier_t *b) {
+    // The episode can't end before our decrement, so this is its sense.
+    int want = !(__atomic_load_n(&b->sense, __ATOMIC_ACQUIRE) & 1);
+    if (__atomic_sub_fetch(&b->left, 1, __ATOMIC_ACQ_REL) == 0) {
+        b->left = b->num_threads;             // published by the sense flip
+        barrier_set_word(&b->sense, want);
+    } else {
+        barrier_wait_word(&b->sense, want, b->spin);
+    }
+}
+
+static void barrier_dissem(barrier_t *b) {
+    int id = barrier_my_id(b), n = b->num_threads;
+    barrier_node_t *me = &b->node[id];
+    for (int k = 0; k < b->rounds; k++) {
+        barrier_node_t *partner = &b->node[(id + (1 << k)) % n];
+        barrier_set_word(&partner->flag[me->parity][k], me->sense);
+        barrier_wait_word(&me->flag[me->parity][k], me->sense, b->spin);
+    }
+    if (me->parity) me->sense = !me->sense;
+    me->parity = !me->parity;
+}
+
+void barrier(barrier_t *b) {
+    trace_event(TR_BARRIER_ARRIVE, b);
+    switch (b->kind) {
+#ifdef HAVE_SEM
+    case BARRIER_SEM:    barrier_sem(b); break;
+#endif
+    case BARRIER_SENSE:  barrier_sense(b); break;
+    case BARRIER_DISSEM: barrier_dissem(b); break;
+    }
+    trace_event(TR_BARRIER_DEPART, b);
+}
+
+#endif // __barrier_fast_h__
@@ -16,8 +16,9 @@
 
 typedef struct __barrier_t {
     // add semaphores and other information here
-    sem_t mutex;        // protects the counter
-    sem_t turnstile;    // the gate that blocks threads
+    Sem_t mutex;        // protects the counter
+    Sem_t turnstile;    // the gate that blocks threads
+    Sem_t turnstile2;   // second gate, so the barrier can be reused
     int count;          // number of threads that have arrived
     int num_threads;    // total number of threads to wait for
 } barrier_t;
@@ -32,10 +33,16 @@ void barrier_init(barrier_t *b, int num_threads) {
     b->count = 0;
     Sem_init(&b->mutex, 1);      // binary semaphore = 1 (unlocked)
     Sem_init(&b->turnstile, 0);  // initially closed
+    Sem_init(&b->turnstile2, 0); // initially closed
 }
 
+// Two-turnstile reusable barrier (Downey 3.7): count goes back to 0 in
+// phase 2, and no thread can re-enter phase 1 until everyone has left it.
+// For faster reusable barriers (sense-reversing, dissemination) see
+// barrier-fast.h and barrier-bench.c.
 void barrier(barrier_t *b) {
     // barrier code goes here
+    trace_event(TR_BARRIER_ARRIVE, b);
     // Phase 1: arrive at the barrier
     Sem_wait(&b->mutex);
     b->count++;
@@ -49,6 +56,18 @@ void barrier(barrier_t *b) {
 
     // Phase 2: wait for gate to open
     Sem_wait(&b->turnstile);
+
+    // Phase 3: leave; the last one out resets count and opens the second gate
+    Sem_wait(&b->mutex);
+    b->count--;
+    if (b->count == 0) {
+        for (int i = 0; i < b->num_threads; i++) {
+            Sem_post(&b->turnstile2);
+        }
+    }
+    Sem_post(&b->mutex);
+    Sem_wait(&b->turnstile2);
+    trace_event(TR_BARRIER_DEPART, b);
 }
 
 //
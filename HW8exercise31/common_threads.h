@@ -4,10 +4,14 @@
 #include <pthread.h>
 #include <assert.h>
 #include <sched.h>
+#include <unistd.h>
 
 #ifdef __linux__
 #include <semaphore.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
 #endif
+#include "../common/trace.h"
 
 #define Pthread_create(thread, attr, start_routine, arg) assert(pthread_create(thread, attr, start_routine, arg) == 0);
 #define Pthread_join(thread, value_ptr)                  assert(pthread_join(thread, value_ptr) == 0);
@@ -28,10 +32,125 @@
 #define Cond_signal(cond)                                assert(pthread_cond_signal(cond) == 0);
 #define Cond_wait(cond, mutex)                           assert(pthread_cond_wait(cond, mutex) == 0);
 
+// Futex_wait sleeps only while *addr still equals val; it may return early
+// (EAGAIN, EINTR, spurious), so callers always re-check in a loop.
+// Elsewhere there is no futex, so waiting degrades to yielding.
 #ifdef __linux__
+#define Futex_wait(addr, val)                            syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0)
+#define Futex_wake(addr, n)                              syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0)
+#else
+#define Futex_wait(addr, val)                            sched_yield()
+#define Futex_wake(addr, n)                              ((void)0)
+#endif // __linux__
+
+// Sem_t is what the Sem_* macros operate on. By default it is POSIX sem_t
+// (Linux only). Built with -DFAST_SEM it is fsem_t below, on any platform.
+// HAVE_SEM says whether there is one; SEM_IMPL names it for report lines.
+#ifdef FAST_SEM
+
+// Lightweight counting semaphore: an atomic count plus a waiter count, and
+// a futex on the count for sleeping.
+//
+// Sem_wait takes a token with a CAS when one is there. Otherwise it polls
+// for up to about twice the recent spin estimate (bounded by FSEM_SPIN_MAX)
+// before parking. The estimate moves 1/8 of the way toward what the last
+// wait needed: up when a token showed up while polling, down when the
+// waiter had to park anyway.
+// Sem_post skips the wake syscall when nobody is parked: a parking waiter
+// bumps waiters before its last look at the count, and a poster bumps the
+// count before it looks at waiters, so at least one of them sees the other.
+// With one online CPU a token can't arrive while we spin, so nobody spins.
+
+#define FSEM_SPIN_INIT 100
+#define FSEM_SPIN_MIN  16
+#define FSEM_SPIN_MAX  4000
+
+typedef struct {
+    int value;                  // tokens available
+    int waiters;                // threads parked or about to park
+    int spin;                   // spin estimate in polls; 0 = never spin
+} fsem_t;
+
+static inline void fsem_init(fsem_t *s, int value) {
+    s->value = value;
+    s->waiters = 0;
+    s->spin = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? FSEM_SPIN_INIT : 0;
+}
+
+static inline int fsem_trytake_(fsem_t *s) {
+    int v = __atomic_load_n(&s->value, __ATOMIC_RELAXED);
+    while (v > 0)
+        if (__atomic_compare_exchange_n(&s->value, &v, v - 1, 1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            return 1;
+    return 0;
+}
+
+static inline void fsem_relax_(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __asm__ __volatile__("pause");
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+static inline void fsem_wait(fsem_t *s) {
+    if (fsem_trytake_(s)) return;
+    int spin = __atomic_load_n(&s->spin, __ATOMIC_RELAXED);
+    if (spin > 0) {
+        int limit = spin * 2 + 10 < FSEM_SPIN_MAX ? spin * 2 + 10 : FSEM_SPIN_MAX;
+        for (int i = 1; i <= limit; i++) {
+            fsem_relax_();
+            if (__atomic_load_n(&s->value, __ATOMIC_RELAXED) > 0 && fsem_trytake_(s)) {
+                spin += (i - spin) / 8;
+                __atomic_store_n(&s->spin, spin > FSEM_SPIN_MIN ? spin : FSEM_SPIN_MIN, __ATOMIC_RELAXED);
+                return;
+            }
+        }
+        spin -= spin / 8;
+        __atomic_store_n(&s->spin, spin > FSEM_SPIN_MIN ? spin : FSEM_SPIN_MIN, __ATOMIC_RELAXED);
+    }
+    trace_event(TR_PARK, s);
+    __atomic_add_fetch(&s->waiters, 1, __ATOMIC_SEQ_CST);
+    while (!fsem_trytake_(s))
+        Futex_wait(&s->value, 0);
+    __atomic_sub_fetch(&s->waiters, 1, __ATOMIC_RELAXED);
+    trace_event(TR_WAKE, s);
+}
+
+static inline void fsem_post(fsem_t *s) {
+    __atomic_add_fetch(&s->value, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&s->waiters, __ATOMIC_SEQ_CST) > 0)
+        Futex_wake(&s->value, 1);
+}
+
+typedef fsem_t Sem_t;
+#define HAVE_SEM 1
+#define SEM_IMPL "fast"
+#define Sem_init(sem, value)                             fsem_init(sem, value);
+#define Sem_wait(sem)                                    fsem_wait(sem);
+#define Sem_post(sem)                                    fsem_post(sem);
+
+#elif defined(__linux__)
+
+typedef sem_t Sem_t;
+#define HAVE_SEM 1
+#define SEM_IMPL "posix"
 #define Sem_init(sem, value)                             assert(sem_init(sem, 0, value) == 0);
-#define Sem_wait(sem)                                    assert(sem_wait(sem) == 0);
 #define Sem_post(sem)                                    assert(sem_post(sem) == 0);
-#endif // __linux__
+#ifdef TRACE
+// A wait that can't take the semaphore at once is traced as park ... wake.
+static inline int Sem_wait_traced_(sem_t *sem) {
+    if (sem_trywait(sem) == 0) return 0;
+    trace_event(TR_PARK, sem);
+    int rc = sem_wait(sem);
+    trace_event(TR_WAKE, sem);
+    return rc;
+}
+#define Sem_wait(sem)                                    assert(Sem_wait_traced_(sem) == 0);
+#else
+#define Sem_wait(sem)                                    assert(sem_wait(sem) == 0);
+#endif // TRACE
+
+#endif // FAST_SEM
 
 #endif // __common_threads_h__
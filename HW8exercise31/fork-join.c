@@ -4,7 +4,7 @@
 #include "common_threads.h"
 #include <semaphore.h>
 
-sem_t s; 
+Sem_t s; 
 
 void *child(void *arg) {
     printf("child\n");
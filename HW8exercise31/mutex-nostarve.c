@@ -1,82 +1,203 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <limits.h>
 #include <pthread.h>
-#include <semaphore.h>
 #include "common_threads.h"
+#include "../common/hrtime.h"
 
-#define MAX_THREADS 10
+//
+// Starvation-free mutex: an MCS queue lock whose waiters park on a futex.
+//
+// Each waiter appends its own queue node to the tail with one atomic swap,
+// so the queue has no size limit (the old version used a ring of
+// MAX_THREADS semaphores that broke once more than 10 threads waited).
+// The lock is handed to waiters in arrival order, so nobody starves.
+// A waiter spins on its own node for `spin` polls, then parks on it with
+// Futex_wait; release wakes exactly that one waiter.
+// Queue nodes come from a small per-thread pool, so the acquire/release API
+// is unchanged.
+// With -DTRACE the queue wait, the futex sleep and the hold are traced
+// (common/trace.h); set TRACE_FILE to keep the per-run trace.json apart.
+//
+
+#define NS_SPIN_DEFAULT 1000
+#define NS_QNODES       4       // locks one thread may hold at once
+
+enum { NS_GRANTED = 0, NS_WAITING = 1, NS_PARKED = 2 };
+
+typedef struct __ns_qnode_t {
+    struct __ns_qnode_t *next;
+    int state;                  // NS_WAITING until the lock is handed over
+} __attribute__((aligned(64))) ns_qnode_t;
 
 typedef struct __ns_mutex_t {
-    sem_t room;           // Control entry to queueing room
-    sem_t mutex;          // Protect shared variables
-    sem_t queue[MAX_THREADS];  // One semaphore per thread position
-    int ticket;           // Next ticket number
-    int turn;             // Current turn number
+    ns_qnode_t *tail;           // last waiter (or holder), NULL when free
+    ns_qnode_t *holder;         // holder's node, read back by release
+    int spin;                   // polls before parking; 0 = park at once
 } ns_mutex_t;
 
+static __thread ns_qnode_t ns_qnodes[NS_QNODES];
+static __thread unsigned ns_qmask;
+
+static ns_qnode_t *ns_qnode_get(void) {
+    assert(ns_qmask != (1u << NS_QNODES) - 1);
+    int i = __builtin_ctz(~ns_qmask);
+    ns_qmask |= 1u << i;
+    return &ns_qnodes[i];
+}
+
+static void ns_qnode_put(ns_qnode_t *q) {
+    ns_qmask &= ~(1u << (q - ns_qnodes));
+}
+
+static inline void ns_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __asm__ __volatile__("pause");
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
 void ns_mutex_init(ns_mutex_t *m) {
-    Sem_init(&m->room, 1);   // One thread at a time in room
-    Sem_init(&m->mutex, 1);  // Protect ticket/turn
-    for (int i = 0; i < MAX_THREADS; i++) {
-        Sem_init(&m->queue[i], 0);  // All waiting initially
-    }
-    m->ticket = 0;
-    m->turn = 0;
-    Sem_post(&m->queue[0]);  // First thread can enter
+    m->tail = NULL;
+    m->holder = NULL;
+    m->spin = NS_SPIN_DEFAULT;
+}
+
+void ns_mutex_set_spin(ns_mutex_t *m, int spin) {
+    m->spin = spin;
 }
 
 void ns_mutex_acquire(ns_mutex_t *m) {
-    Sem_wait(&m->room);      // Enter queueing room
-    Sem_wait(&m->mutex);
-    int my_ticket = m->ticket++;  // Get ticket number
-    Sem_post(&m->mutex);
-    
-    Sem_wait(&m->queue[my_ticket % MAX_THREADS]);  // Wait for my turn
-    Sem_post(&m->room);      // Leave queueing room
+    ns_qnode_t *q = ns_qnode_get();
+    q->next = NULL;
+    q->state = NS_WAITING;
+    ns_qnode_t *pred = __atomic_exchange_n(&m->tail, q, __ATOMIC_ACQ_REL);
+    if (pred) {
+        trace_event(TR_LOCK_WAIT, m);
+        __atomic_store_n(&pred->next, q, __ATOMIC_RELEASE);
+        for (int i = 0; i < m->spin && __atomic_load_n(&q->state, __ATOMIC_ACQUIRE) != NS_GRANTED; i++)
+            ns_relax();
+        int s = NS_WAITING;
+        if (__atomic_compare_exchange_n(&q->state, &s, NS_PARKED, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            trace_event(TR_PARK, m);
+            while (__atomic_load_n(&q->state, __ATOMIC_ACQUIRE) != NS_GRANTED)
+                Futex_wait(&q->state, NS_PARKED);
+            trace_event(TR_WAKE, m);
+        }
+    }
+    m->holder = q;
+    trace_event(TR_LOCK_ACQUIRED, m);
 }
 
 void ns_mutex_release(ns_mutex_t *m) {
-    Sem_wait(&m->mutex);
-    m->turn++;               // Next turn
-    Sem_post(&m->queue[m->turn % MAX_THREADS]);  // Wake next thread
-    Sem_post(&m->mutex);
+    ns_qnode_t *q = m->holder;
+    trace_event(TR_LOCK_RELEASED, m);
+    ns_qnode_t *succ = __atomic_load_n(&q->next, __ATOMIC_ACQUIRE);
+    if (!succ) {
+        ns_qnode_t *expect = q;
+        if (__atomic_compare_exchange_n(&m->tail, &expect, NULL, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            ns_qnode_put(q);
+            return;
+        }
+        // A new waiter swapped itself in but hasn't linked to us yet.
+        while (!(succ = __atomic_load_n(&q->next, __ATOMIC_ACQUIRE)))
+            ns_relax();
+    }
+    if (__atomic_exchange_n(&succ->state, NS_GRANTED, __ATOMIC_ACQ_REL) == NS_PARKED)
+        Futex_wake(&succ->state, 1);
+    ns_qnode_put(q);
 }
 
+//
+// Throughput/fairness benchmark: every thread acquires the lock in a loop
+// for a fixed time, doing cs_work iterations inside and out. Fairness is
+// Jain's index over per-thread acquire counts (1.0 = perfectly even, 1/N =
+// one thread got everything). pthread_mutex runs as a baseline.
+//
+// usage: mutex-nostarve [threads=64] [ms=1000] [spin] [cs_work=100]
+//   spin defaults to NS_SPIN_DEFAULT, or 0 when threads outnumber CPUs
+//   (a queued waiter then can't be running, so spinning only wastes time)
+//
+
 ns_mutex_t lock;
-int counter = 0;
+pthread_mutex_t plock = PTHREAD_MUTEX_INITIALIZER;
+int use_pthread;
+int cs_work;
+int go, stop;
+long counter = 0;
+
+typedef struct {
+    long acquired;
+} __attribute__((aligned(64))) wstat_t;
+
+static inline void work(void) {
+    for (volatile int i = 0; i < cs_work; i++)
+        ;
+}
 
 void *worker(void *arg) {
-    int id = *(int *)arg;
-    for (int i = 0; i < 3; i++) {
-        ns_mutex_acquire(&lock);
-        printf("Thread %d: acquired lock (counter=%d)\n", id, counter);
+    wstat_t *w = (wstat_t *) arg;
+    long n = 0;
+    while (!__atomic_load_n(&go, __ATOMIC_ACQUIRE))   // start everyone together
+        sched_yield();
+    while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+        if (use_pthread) pthread_mutex_lock(&plock); else ns_mutex_acquire(&lock);
         counter++;
-        sleep(1);  // Simulate work
-        printf("Thread %d: releasing lock (counter=%d)\n", id, counter);
-        ns_mutex_release(&lock);
+        work();
+        if (use_pthread) pthread_mutex_unlock(&plock); else ns_mutex_release(&lock);
+        n++;
+        work();
     }
+    w->acquired = n;
     return NULL;
 }
 
-int main(int argc, char *argv[]) {
-    printf("parent: begin\n");
-    
-    ns_mutex_init(&lock);
-    
-    pthread_t threads[5];
-    int ids[5];
-    
-    for (int i = 0; i < 5; i++) {
-        ids[i] = i;
-        Pthread_create(&threads[i], NULL, worker, &ids[i]);
-    }
-    
-    for (int i = 0; i < 5; i++) {
+static void run(const char *name, int num_threads, int ms) {
+    pthread_t threads[num_threads];
+    wstat_t w[num_threads];
+    counter = 0;
+    go = stop = 0;
+
+    for (int i = 0; i < num_threads; i++)
+        Pthread_create(&threads[i], NULL, worker, &w[i]);
+    uint64_t start = hr_now_ns();
+    __atomic_store_n(&go, 1, __ATOMIC_RELEASE);
+    usleep(ms * 1000);
+    __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+    for (int i = 0; i < num_threads; i++)
         Pthread_join(threads[i], NULL);
+    uint64_t end = hr_now_ns();
+
+    long total = 0, lo = LONG_MAX, hi = 0;
+    double sq = 0;
+    for (int i = 0; i < num_threads; i++) {
+        total += w[i].acquired;
+        sq += (double) w[i].acquired * w[i].acquired;
+        if (w[i].acquired < lo) lo = w[i].acquired;
+        if (w[i].acquired > hi) hi = w[i].acquired;
     }
-    
-    printf("parent: end (final counter=%d)\n", counter);
-    return 0;
+    double jain = sq > 0 ? (double) total * total / (num_threads * sq) : 0;
+    printf("[mutex] impl=%s threads=%d spin=%d cs_work=%d time_ms=%.1f acquires=%ld acq_per_s=%.0f"
+           " min=%ld max=%ld jain=%.3f %s\n",
+           name, num_threads, use_pthread ? 0 : lock.spin, cs_work, hr_elapsed_ms(start, end), total,
+           total / ((end - start) / 1e9), lo, hi, jain, counter == total ? "ok" : "WRONG");
 }
 
+int main(int argc, char *argv[]) {
+    int num_threads = argc > 1 ? atoi(argv[1]) : 64;
+    int ms = argc > 2 ? atoi(argv[2]) : 1000;
+    int spin = argc > 3 ? atoi(argv[3]) : num_threads <= sysconf(_SC_NPROCESSORS_ONLN) ? NS_SPIN_DEFAULT : 0;
+    cs_work = argc > 4 ? atoi(argv[4]) : 100;
+    assert(num_threads > 0);
+
+    ns_mutex_init(&lock);
+    ns_mutex_set_spin(&lock, spin);
+
+    use_pthread = 0;
+    run("ns_mutex", num_threads, ms);
+    use_pthread = 1;
+    run("pthread", num_threads, ms);
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "queue.h"
+#include "../common/hrtime.h"
+
+// Messages per second through one queue, for every engine in queue.h and
+// every producers x consumers x batch combination up to max_threads. Each
+// producer pushes msgs distinct non-zero values; consumers pop with
+// queue_batch_pop and add up what they got, so a lost or duplicated message
+// shows up as WRONG. Each consumer stops at a NULL, pushed once per consumer
+// after all producers are done.
+//
+// usage: queue-bench [msgs=1000000] [max_threads=4] [cap=1024] [cond|mpmc|all]
+
+queue_t q;
+long msgs;
+int batch;
+
+typedef struct {
+    int id;
+    unsigned long sum;
+    long count;
+} __attribute__((aligned(64))) qarg_t;
+
+void *producer(void *arg) {
+    qarg_t *a = (qarg_t *) arg;
+    for (long i = 1; i <= msgs; i++)
+        queue_push(&q, (void *) (uintptr_t) (((unsigned long) a->id << 40) | i));
+    return NULL;
+}
+
+void *consumer(void *arg) {
+    qarg_t *a = (qarg_t *) arg;
+    void *out[batch];
+    unsigned long sum = 0;
+    long count = 0;
+    for (;;) {
+        int k = queue_batch_pop(&q, out, batch), stop = 0;
+        for (int i = 0; i < k; i++) {
+            if (!out[i]) { stop = 1; continue; }
+            sum += (uintptr_t) out[i];
+            count++;
+        }
+        // A batch can hold other consumers' NULLs too; hand them back.
+        for (int i = 0, seen = 0; i < k; i++)
+            if (!out[i] && seen++) queue_push(&q, NULL);
+        if (stop) break;
+    }
+    a->sum = sum;
+    a->count = count;
+    return NULL;
+}
+
+static void run(int kind, int np, int nc, long cap) {
+    pthread_t pp[np], pc[nc];
+    qarg_t ap[np], ac[nc];
+    queue_init(&q, kind, cap);
+
+    uint64_t start = hr_now_ns();
+    for (int i = 0; i < nc; i++) { ac[i].id = i; Pthread_create(&pc[i], NULL, consumer, &ac[i]); }
+    for (int i = 0; i < np; i++) { ap[i].id = i; Pthread_create(&pp[i], NULL, producer, &ap[i]); }
+    for (int i = 0; i < np; i++) Pthread_join(pp[i], NULL);
+    for (int i = 0; i < nc; i++) queue_push(&q, NULL);
+    for (int i = 0; i < nc; i++) Pthread_join(pc[i], NULL);
+    uint64_t end = hr_now_ns();
+
+    unsigned long sum = 0, want = 0;
+    long count = 0;
+    for (int i = 0; i < nc; i++) { sum += ac[i].sum; count += ac[i].count; }
+    for (int p = 0; p < np; p++)
+        want += ((unsigned long) p << 40) * msgs + (unsigned long) msgs * (msgs + 1) / 2;
+    printf("[queue] engine=%s producers=%d consumers=%d batch=%d cap=%ld msgs=%ld time_ms=%.3f mmsg_s=%.2f %s\n",
+           queue_names[kind], np, nc, batch, q.cap, count, hr_elapsed_ms(start, end),
+           count / ((end - start) / 1e3), sum == want && count == msgs * np ? "ok" : "WRONG");
+    queue_destroy(&q);
+}
+
+int main(int argc, char *argv[]) {
+    msgs = argc > 1 ? atol(argv[1]) : 1000000;
+    int max_threads = argc > 2 ? atoi(argv[2]) : 4;
+    long cap = argc > 3 ? atol(argv[3]) : 1024;
+    const char *which = argc > 4 ? argv[4] : "all";
+    static const int batches[] = { 1, 8, 64 };
+
+    for (int kind = 0; kind < QUEUE_NKINDS; kind++) {
+        if (strcmp(which, "all") && strcmp(which, queue_names[kind])) continue;
+        for (int np = 1; np <= max_threads; np *= 2)
+            for (int nc = 1; nc <= max_threads; nc *= 2)
+                for (int b = 0; b < 3; b++) {
+                    batch = batches[b];
+                    run(kind, np, nc, cap);
+                }
+    }
+    return 0;
+}
@@ -0,0 +1,185 @@
+#ifndef __queue_h__
+#define __queue_h__
+
+// Bounded multi-producer/multi-consumer queue of pointers, two engines behind
+// one API (picked at queue_init):
+//
+//   QUEUE_COND  the textbook queue: a ring under one mutex, producers wait on
+//               `notfull` and consumers on `notempty` (Cond_wait/Cond_signal)
+//   QUEUE_MPMC  Vyukov's bounded MPMC ring: every cell carries a sequence
+//               number that says whose turn it is, so push and pop are one
+//               CAS on their own position counter each; head and tail live
+//               on separate cache lines and never contend with each other
+//
+//   queue_push(q, p)             blocks while full
+//   queue_pop(q)                 blocks while empty
+//   queue_batch_pop(q, out, n)   blocks until at least one item is there,
+//                                then takes up to n in one lock/one CAS
+//
+// The MPMC engine never sleeps: a full or empty queue is polled, yielding
+// every QUEUE_SPIN polls. cap is rounded up to a power of two.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "common_threads.h"
+
+enum { QUEUE_COND, QUEUE_MPMC, QUEUE_NKINDS };
+static const char *queue_names[QUEUE_NKINDS] = { "cond", "mpmc" };
+
+#define QUEUE_SPIN 64
+
+typedef struct {
+    long seq;
+    void *data;
+} queue_cell_t;
+
+typedef struct __queue_t {
+    int kind;
+    long cap, mask;
+    // cond
+    void **buf;
+    long head, tail, count;
+    pthread_mutex_t lock;
+    pthread_cond_t notfull, notempty;
+    // mpmc
+    queue_cell_t *cell;
+    long enq __attribute__((aligned(64)));
+    long deq __attribute__((aligned(64)));
+} queue_t;
+
+static inline void queue_relax(int *spins) {
+    if (++*spins < QUEUE_SPIN) {
+#if defined(__x86_64__) || defined(__i386__)
+        __asm__ __volatile__("pause");
+#elif defined(__aarch64__)
+        __asm__ __volatile__("yield");
+#endif
+    } else {
+        *spins = 0;
+        sched_yield();
+    }
+}
+
+void queue_init(queue_t *q, int kind, long cap) {
+    memset(q, 0, sizeof(*q));
+    q->kind = kind;
+    for (q->cap = 2; q->cap < cap; q->cap <<= 1)
+        ;
+    q->mask = q->cap - 1;
+    if (kind == QUEUE_COND) {
+        q->buf = malloc(sizeof(void *) * q->cap);
+        Mutex_init(&q->lock);
+        Cond_init(&q->notfull);
+        Cond_init(&q->notempty);
+    } else {
+        int rc = posix_memalign((void **) &q->cell, 64, sizeof(queue_cell_t) * q->cap);
+        assert(rc == 0);
+        (void) rc;
+        for (long i = 0; i < q->cap; i++)
+            q->cell[i].seq = i;
+    }
+}
+
+void queue_destroy(queue_t *q) {
+    free(q->buf);
+    free(q->cell);
+    if (q->kind == QUEUE_COND) {
+        pthread_mutex_destroy(&q->lock);
+        pthread_cond_destroy(&q->notfull);
+        pthread_cond_destroy(&q->notempty);
+    }
+}
+
+// ---- mpmc -----------------------------------------------------------------
+// Cell i is free for the producer at position pos when seq == pos, and full
+// for the consumer at pos when seq == pos + 1. The consumer frees it for the
+// next lap by setting seq = pos + cap.
+static inline int mpmc_try_push(queue_t *q, void *p) {
+    long pos = __atomic_load_n(&q->enq, __ATOMIC_RELAXED);
+    for (;;) {
+        queue_cell_t *c = &q->cell[pos & q->mask];
+        long d = __atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) - pos;
+        if (d == 0) {
+            if (__atomic_compare_exchange_n(&q->enq, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                c->data = p;
+                __atomic_store_n(&c->seq, pos + 1, __ATOMIC_RELEASE);
+                return 1;
+            }
+        } else if (d < 0) {
+            return 0;                               // full
+        } else {
+            pos = __atomic_load_n(&q->enq, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// Claims up to n consecutive full cells with one CAS on deq.
+static inline int mpmc_try_pop_n(queue_t *q, void **out, int n) {
+    long pos = __atomic_load_n(&q->deq, __ATOMIC_RELAXED);
+    for (;;) {
+        long d = __atomic_load_n(&q->cell[pos & q->mask].seq, __ATOMIC_ACQUIRE) - (pos + 1);
+        if (d < 0) return 0;                        // empty
+        if (d > 0) { pos = __atomic_load_n(&q->deq, __ATOMIC_RELAXED); continue; }
+        int k = 1;
+        while (k < n && __atomic_load_n(&q->cell[(pos + k) & q->mask].seq, __ATOMIC_ACQUIRE) == pos + k + 1)
+            k++;
+        if (__atomic_compare_exchange_n(&q->deq, &pos, pos + k, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            for (int i = 0; i < k; i++) {
+                queue_cell_t *c = &q->cell[(pos + i) & q->mask];
+                out[i] = c->data;
+                __atomic_store_n(&c->seq, pos + i + q->cap, __ATOMIC_RELEASE);
+            }
+            return k;
+        }
+    }
+}
+
+// ---- API ------------------------------------------------------------------
+void queue_push(queue_t *q, void *p) {
+    if (q->kind == QUEUE_MPMC) {
+        int spins = 0;
+        while (!mpmc_try_push(q, p))
+            queue_relax(&spins);
+        return;
+    }
+    Mutex_lock(&q->lock);
+    while (q->count == q->cap)
+        Cond_wait(&q->notfull, &q->lock);
+    q->buf[q->tail] = p;
+    q->tail = (q->tail + 1) & q->mask;
+    q->count++;
+    Cond_signal(&q->notempty);
+    Mutex_unlock(&q->lock);
+}
+
+int queue_batch_pop(queue_t *q, void **out, int n) {
+    if (q->kind == QUEUE_MPMC) {
+        int spins = 0, k;
+        while (!(k = mpmc_try_pop_n(q, out, n)))
+            queue_relax(&spins);
+        return k;
+    }
+    Mutex_lock(&q->lock);
+    while (q->count == 0)
+        Cond_wait(&q->notempty, &q->lock);
+    int k = q->count < n ? (int) q->count : n;
+    for (int i = 0; i < k; i++) {
+        out[i] = q->buf[q->head];
+        q->head = (q->head + 1) & q->mask;
+    }
+    q->count -= k;
+    // k slots opened up: one signal per slot so k producers can go
+    for (int i = 0; i < k; i++)
+        Cond_signal(&q->notfull);
+    Mutex_unlock(&q->lock);
+    return k;
+}
+
+void *queue_pop(queue_t *q) {
+    void *p;
+    queue_batch_pop(q, &p, 1);
+    return p;
+}
+
+#endif // __queue_h__
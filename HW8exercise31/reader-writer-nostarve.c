@@ -8,9 +8,9 @@
 //
 
 typedef struct __rwlock_t {
-    sem_t readEntry;   // Control reader entry (prevent new readers when writer waits)
-    sem_t writelock;   // Writer's exclusive lock
-    sem_t lock;        // Protect readers counter
+    Sem_t readEntry;   // Control reader entry (prevent new readers when writer waits)
+    Sem_t writelock;   // Writer's exclusive lock
+    Sem_t lock;        // Protect readers counter
     int readers;       // Number of active readers
 } rwlock_t;
 
@@ -5,8 +5,8 @@
 #include "common_threads.h"
 
 typedef struct _rwlock_t {
-    sem_t writelock;   // Writer's exclusive lock
-    sem_t lock;        // Protect readers counter
+    Sem_t writelock;   // Writer's exclusive lock
+    Sem_t lock;        // Protect readers counter
     int readers;       // Number of active readers
 } rwlock_t;
 
@@ -16,6 +16,8 @@ void rwlock_init(rwlock_t *rw) {
     Sem_init(&rw->writelock, 1);  // Binary semaphore for writer
 }
 
+// With -DTRACE each read or write hold of the rwlock is a "hold" slice in
+// trace.json, and a reader or writer stuck on a semaphore shows up as "park".
 void rwlock_acquire_readlock(rwlock_t *rw) {
     Sem_wait(&rw->lock);
     rw->readers++;
@@ -23,9 +25,11 @@ void rwlock_acquire_readlock(rwlock_t *rw) {
         Sem_wait(&rw->writelock);  // Block writers
     }
     Sem_post(&rw->lock);
+    trace_event(TR_LOCK_ACQUIRED, rw);
 }
 
 void rwlock_release_readlock(rwlock_t *rw) {
+    trace_event(TR_LOCK_RELEASED, rw);
     Sem_wait(&rw->lock);
     rw->readers--;
     if (rw->readers == 0) {  // Last reader
@@ -36,9 +40,11 @@ void rwlock_release_readlock(rwlock_t *rw) {
 
 void rwlock_acquire_writelock(rwlock_t *rw) {
     Sem_wait(&rw->writelock);  // Exclusive access
+    trace_event(TR_LOCK_ACQUIRED, rw);
 }
 
 void rwlock_release_writelock(rwlock_t *rw) {
+    trace_event(TR_LOCK_RELEASED, rw);
     Sem_post(&rw->writelock);
 }
 
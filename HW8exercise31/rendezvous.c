@@ -4,8 +4,8 @@
 #include "common_threads.h"
 
 // TODO: Declare two semaphores
-sem_t sem_a;  // Thread A signals "I'm here"
-sem_t sem_b;  // Thread B signals "I'm here"
+Sem_t sem_a;  // Thread A signals "I'm here"
+Sem_t sem_b;  // Thread B signals "I'm here"
 
 void *thread_a(void *arg) {
     printf("Thread A: doing work before rendezvous\n");
@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "common_threads.h"
+#include "rwlock-futex.h"
+#include "../common/hrtime.h"
+
+// Times the big-reader futex rwlock (rwlock-futex.h) against the semaphore
+// rwlock from reader-writer-nostarve.c. Unlike that file's driver, the
+// critical sections do not printf: terminal output would serialize every
+// thread on stdout and swamp the cost of the lock itself.
+//
+// usage: rwlock-bench <readers> <writers> <loops> [cs_work=0] [futex|sem|both]
+//   cs_work  iterations of busy work inside each critical section
+//
+// Build with -DFAST_SEM to run the semaphore rwlock on the futex semaphore
+// in common_threads.h instead of POSIX sem_t; sem= on each line says which.
+
+#ifdef HAVE_SEM
+// The semaphore rwlock from reader-writer-nostarve.c, renamed so both fit in
+// one binary.
+typedef struct {
+    Sem_t readEntry;
+    Sem_t writelock;
+    Sem_t lock;
+    int readers;
+} sem_rwlock_t;
+
+void sem_rwlock_init(sem_rwlock_t *rw) {
+    rw->readers = 0;
+    Sem_init(&rw->readEntry, 1);
+    Sem_init(&rw->lock, 1);
+    Sem_init(&rw->writelock, 1);
+}
+void sem_rwlock_acquire_readlock(sem_rwlock_t *rw) {
+    Sem_wait(&rw->readEntry);
+    Sem_wait(&rw->lock);
+    if (++rw->readers == 1)
+        Sem_wait(&rw->writelock);
+    Sem_post(&rw->lock);
+    Sem_post(&rw->readEntry);
+}
+void sem_rwlock_release_readlock(sem_rwlock_t *rw) {
+    Sem_wait(&rw->lock);
+    if (--rw->readers == 0)
+        Sem_post(&rw->writelock);
+    Sem_post(&rw->lock);
+}
+void sem_rwlock_acquire_writelock(sem_rwlock_t *rw) {
+    Sem_wait(&rw->readEntry);
+    Sem_wait(&rw->writelock);
+    Sem_post(&rw->readEntry);
+}
+void sem_rwlock_release_writelock(sem_rwlock_t *rw) {
+    Sem_post(&rw->writelock);
+}
+#endif // HAVE_SEM
+
+enum { IMPL_FUTEX, IMPL_SEM };
+
+int loops, cs_work, impl;
+volatile int value = 0;
+rwlock_t flock;
+#ifdef HAVE_SEM
+sem_rwlock_t slock;
+#endif
+
+typedef struct {
+    uint64_t done_ns;   // when this thread finished its loops
+    long sink;
+} worker_t;
+
+static inline void work(void) {
+    for (volatile int i = 0; i < cs_work; i++)
+        ;
+}
+
+void *reader(void *arg) {
+    worker_t *w = (worker_t *) arg;
+    long sink = 0;
+    for (int i = 0; i < loops; i++) {
+        if (impl == IMPL_FUTEX) {
+            rwlock_acquire_readlock(&flock);
+            sink += value; work();
+            rwlock_release_readlock(&flock);
+        }
+#ifdef HAVE_SEM
+        else {
+            sem_rwlock_acquire_readlock(&slock);
+            sink += value; work();
+            sem_rwlock_release_readlock(&slock);
+        }
+#endif
+    }
+    w->sink = sink;
+    w->done_ns = hr_now_ns();
+    return NULL;
+}
+
+void *writer(void *arg) {
+    worker_t *w = (worker_t *) arg;
+    for (int i = 0; i < loops; i++) {
+        if (impl == IMPL_FUTEX) {
+            rwlock_acquire_writelock(&flock);
+            value++; work();
+            rwlock_release_writelock(&flock);
+        }
+#ifdef HAVE_SEM
+        else {
+            sem_rwlock_acquire_writelock(&slock);
+            value++; work();
+            sem_rwlock_release_writelock(&slock);
+        }
+#endif
+    }
+    w->done_ns = hr_now_ns();
+    return NULL;
+}
+
+// Prints one line per implementation. r_last/w_last are when the last reader
+// and writer finished; a large gap between them means one side was starved.
+static void run(int num_readers, int num_writers) {
+    pthread_t pr[num_readers], pw[num_writers];
+    worker_t wr[num_readers], ww[num_writers];
+    value = 0;
+    if (impl == IMPL_FUTEX) rwlock_init(&flock);
+#ifdef HAVE_SEM
+    else sem_rwlock_init(&slock);
+#endif
+
+    uint64_t start = hr_now_ns();
+    for (int i = 0; i < num_readers; i++)
+        Pthread_create(&pr[i], NULL, reader, &wr[i]);
+    for (int i = 0; i < num_writers; i++)
+        Pthread_create(&pw[i], NULL, writer, &ww[i]);
+    for (int i = 0; i < num_readers; i++)
+        Pthread_join(pr[i], NULL);
+    for (int i = 0; i < num_writers; i++)
+        Pthread_join(pw[i], NULL);
+    uint64_t end = hr_now_ns();
+
+    uint64_t r_last = start, w_last = start;
+    for (int i = 0; i < num_readers; i++) if (wr[i].done_ns > r_last) r_last = wr[i].done_ns;
+    for (int i = 0; i < num_writers; i++) if (ww[i].done_ns > w_last) w_last = ww[i].done_ns;
+    double sec = (end - start) / 1e9;
+    printf("[rwlock] impl=%s sem=%s readers=%d writers=%d loops=%d cs_work=%d time_ms=%.3f"
+           " reads_per_s=%.0f writes_per_s=%.0f r_last_ms=%.3f w_last_ms=%.3f value=%d %s\n",
+           impl == IMPL_FUTEX ? "futex" : "sem", impl == IMPL_FUTEX ? "-" : SEM_IMPL,
+           num_readers, num_writers, loops, cs_work,
+           hr_elapsed_ms(start, end), (double) num_readers * loops / sec, (double) num_writers * loops / sec,
+           num_readers ? hr_elapsed_ms(start, r_last) : 0.0, num_writers ? hr_elapsed_ms(start, w_last) : 0.0,
+           value, value == num_writers * loops ? "ok" : "WRONG");
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s <readers> <writers> <loops> [cs_work=0] [futex|sem|both]\n", argv[0]);
+        return 1;
+    }
+    int num_readers = atoi(argv[1]);
+    int num_writers = atoi(argv[2]);
+    loops = atoi(argv[3]);
+    cs_work = argc > 4 ? atoi(argv[4]) : 0;
+    const char *which = argc > 5 ? argv[5] : "both";
+
+    if (strcmp(which, "sem")) { impl = IMPL_FUTEX; run(num_readers, num_writers); }
+#ifdef HAVE_SEM
+    if (strcmp(which, "futex")) { impl = IMPL_SEM; run(num_readers, num_writers); }
+#endif
+    return 0;
+}
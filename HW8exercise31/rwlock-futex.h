@@ -0,0 +1,116 @@
+#ifndef __rwlock_futex_h__
+#define __rwlock_futex_h__
+
+// A "big-reader" rwlock with the same API as reader-writer-nostarve.c.
+//
+// Readers never touch a shared counter: each thread registers in its own
+// cache-line slot (threads are spread round-robin over RW_SLOTS), and a
+// read-only workload keeps every slot in its owner's cache. A writer takes a
+// FIFO ticket, raises `writer`, then drains the slots. All waits sleep on a
+// futex (Futex_wait/Futex_wake in common_threads.h); nothing spins.
+//
+// No starvation, either way:
+//  - writers: once `writer` is up, new readers back out and sleep on it;
+//    writers among themselves are served in ticket order
+//  - readers: a reader that found a writer inside counts itself in
+//    `rwaiting`, and the next writer does not raise `writer` until every
+//    such reader has registered in its slot, so each write lets the readers
+//    blocked behind it in before the next write
+//
+// Every sleep/wake pair is a store followed by a load of the other side's
+// word (slot count vs `writer`, `rwaiting` vs `writer`, ticket vs serving),
+// so those use seq_cst atomics; otherwise a wakeup could be lost.
+
+#include <limits.h>
+#include "common_threads.h"
+
+#define RW_SLOTS 64
+
+typedef struct {
+    int active;                  // readers inside via this slot
+} __attribute__((aligned(64))) rw_slot_t;
+
+typedef struct __rwlock_t {
+    rw_slot_t slot[RW_SLOTS];
+    int writer __attribute__((aligned(64)));   // 1 while a writer drains or holds
+    int rwaiting;                // readers waiting for the current writer to leave
+    int ticket_next __attribute__((aligned(64)));
+    int ticket_serving;          // writers sleep here for their turn
+} rwlock_t;
+
+static int rw_next_slot;
+static __thread int rw_my_slot = -1;
+
+static inline rw_slot_t *rw_slot(rwlock_t *rw) {
+    if (rw_my_slot < 0)
+        rw_my_slot = __atomic_fetch_add(&rw_next_slot, 1, __ATOMIC_RELAXED) % RW_SLOTS;
+    return &rw->slot[rw_my_slot];
+}
+
+void rwlock_init(rwlock_t *rw) {
+    for (int i = 0; i < RW_SLOTS; i++)
+        rw->slot[i].active = 0;
+    rw->writer = 0;
+    rw->rwaiting = 0;
+    rw->ticket_next = 0;
+    rw->ticket_serving = 0;
+}
+
+static inline void rw_slot_leave(rwlock_t *rw, rw_slot_t *s) {
+    // The last reader out of a slot wakes a writer that may be draining it.
+    if (__atomic_sub_fetch(&s->active, 1, __ATOMIC_SEQ_CST) == 0 && __atomic_load_n(&rw->writer, __ATOMIC_SEQ_CST))
+        Futex_wake(&s->active, 1);
+}
+
+void rwlock_acquire_readlock(rwlock_t *rw) {
+    rw_slot_t *s = rw_slot(rw);
+    __atomic_add_fetch(&s->active, 1, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&rw->writer, __ATOMIC_SEQ_CST))
+        return;                                  // fast path: no writer around
+    // A writer is in (or draining): back out and wait for it to leave.
+    rw_slot_leave(rw, s);
+    __atomic_add_fetch(&rw->rwaiting, 1, __ATOMIC_SEQ_CST);
+    for (;;) {
+        while (__atomic_load_n(&rw->writer, __ATOMIC_SEQ_CST))
+            Futex_wait(&rw->writer, 1);
+        __atomic_add_fetch(&s->active, 1, __ATOMIC_SEQ_CST);
+        if (!__atomic_load_n(&rw->writer, __ATOMIC_SEQ_CST))
+            break;
+        rw_slot_leave(rw, s);
+    }
+    // Registered; the next writer may now proceed once all waiters are in.
+    if (__atomic_sub_fetch(&rw->rwaiting, 1, __ATOMIC_SEQ_CST) == 0)
+        Futex_wake(&rw->rwaiting, INT_MAX);
+}
+
+void rwlock_release_readlock(rwlock_t *rw) {
+    rw_slot_leave(rw, rw_slot(rw));
+}
+
+void rwlock_acquire_writelock(rwlock_t *rw) {
+    int my = __atomic_fetch_add(&rw->ticket_next, 1, __ATOMIC_SEQ_CST), t;
+    while ((t = __atomic_load_n(&rw->ticket_serving, __ATOMIC_SEQ_CST)) != my)
+        Futex_wait(&rw->ticket_serving, t);
+    // Let in the readers that queued behind the previous writer.
+    int r;
+    while ((r = __atomic_load_n(&rw->rwaiting, __ATOMIC_SEQ_CST)) != 0)
+        Futex_wait(&rw->rwaiting, r);
+    __atomic_store_n(&rw->writer, 1, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < RW_SLOTS; i++) {
+        int v;
+        while ((v = __atomic_load_n(&rw->slot[i].active, __ATOMIC_SEQ_CST)) != 0)
+            Futex_wait(&rw->slot[i].active, v);
+    }
+}
+
+void rwlock_release_writelock(rwlock_t *rw) {
+    __atomic_store_n(&rw->writer, 0, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&rw->rwaiting, __ATOMIC_SEQ_CST))
+        Futex_wake(&rw->writer, INT_MAX);
+    int next = rw->ticket_serving + 1;
+    __atomic_store_n(&rw->ticket_serving, next, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&rw->ticket_next, __ATOMIC_SEQ_CST) != next)
+        Futex_wake(&rw->ticket_serving, INT_MAX);
+}
+
+#endif // __rwlock_futex_h__
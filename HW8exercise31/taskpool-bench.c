@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "taskpool.h"
+#include "../common/hrtime.h"
+
+// Exercises taskpool.h two ways:
+//   flat  - N short tasks, as one pthread_create/join each vs. spawned into
+//           the pool and synced once (what ch29 --tasks does per run)
+//   fib   - naive recursive fib(n) with spawn/sync at every level, which
+//           keeps every deque busy and makes workers steal from each other
+//
+// usage: taskpool-bench [workers=ncpu] [tasks=1000] [work=1000] [fib_n=25]
+
+int work_iters;
+tp_pool_t *tp;
+
+void *short_task(void *arg) {
+    long *sink = (long *) arg;
+    long s = 0;
+    for (volatile int i = 0; i < work_iters; i++)
+        s += i;
+    *sink = s;
+    return NULL;
+}
+
+typedef struct { int n; long result; } fib_t;
+
+void *fib_task(void *arg) {
+    fib_t *f = (fib_t *) arg;
+    if (f->n < 2) { f->result = f->n; return NULL; }
+    fib_t a = { f->n - 1, 0 }, b = { f->n - 2, 0 };
+    tp_group_t g; tp_group_init(&g);
+    tp_spawn(tp, &g, fib_task, &a);
+    fib_task(&b);
+    tp_sync(tp, &g);
+    f->result = a.result + b.result;
+    return NULL;
+}
+
+static long fib_serial(int n) { return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2); }
+
+int main(int argc, char *argv[]) {
+    int workers = argc > 1 ? atoi(argv[1]) : (int) sysconf(_SC_NPROCESSORS_ONLN);
+    int ntasks = argc > 2 ? atoi(argv[2]) : 1000;
+    work_iters = argc > 3 ? atoi(argv[3]) : 1000;
+    int fib_n = argc > 4 ? atoi(argv[4]) : 25;
+    long *sink = calloc(ntasks, sizeof(long));
+    pthread_t *t = malloc(sizeof(pthread_t) * ntasks);
+
+    uint64_t s = hr_now_ns();
+    for (int i = 0; i < ntasks; i++)
+        Pthread_create(&t[i], NULL, short_task, &sink[i]);
+    for (int i = 0; i < ntasks; i++)
+        Pthread_join(t[i], NULL);
+    uint64_t e = hr_now_ns();
+    printf("[tasks] mode=flat runner=pthread tasks=%d work=%d time_ms=%.3f us_per_task=%.2f\n",
+           ntasks, work_iters, hr_elapsed_ms(s, e), (e - s) / 1e3 / ntasks);
+
+    tp = tp_create(workers);
+    s = hr_now_ns();
+    tp_group_t g; tp_group_init(&g);
+    for (int i = 0; i < ntasks; i++)
+        tp_spawn(tp, &g, short_task, &sink[i]);
+    tp_sync(tp, &g);
+    e = hr_now_ns();
+    printf("[tasks] mode=flat runner=pool workers=%d tasks=%d work=%d time_ms=%.3f us_per_task=%.2f\n",
+           workers, ntasks, work_iters, hr_elapsed_ms(s, e), (e - s) / 1e3 / ntasks);
+
+    fib_t f = { fib_n, 0 };
+    s = hr_now_ns();
+    tp_group_t root; tp_group_init(&root);
+    tp_spawn(tp, &root, fib_task, &f);
+    tp_sync(tp, &root);
+    e = hr_now_ns();
+    long want = fib_serial(fib_n);
+    printf("[tasks] mode=fib runner=pool workers=%d n=%d result=%ld time_ms=%.3f %s\n",
+           workers, fib_n, f.result, hr_elapsed_ms(s, e), f.result == want ? "ok" : "WRONG");
+
+    tp_destroy(tp);
+    free(sink);
+    free(t);
+    return 0;
+}
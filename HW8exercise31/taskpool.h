@@ -0,0 +1,255 @@
+#ifndef __taskpool_h__
+#define __taskpool_h__
+
+// Work-stealing fork-join runtime.
+//
+//   tp_pool_t *tp = tp_create(nworkers);
+//   tp_group_t g; tp_group_init(&g);
+//   tp_spawn(tp, &g, fn, arg);     // fn has the pthread signature
+//   tp_sync(tp, &g);               // returns once every task in g is done
+//   tp_destroy(tp);
+//
+// Each worker owns a Chase-Lev deque: it pushes and pops its own tasks at the
+// bottom (LIFO, cache-warm) while idle workers steal from the top (FIFO, the
+// oldest and usually largest pieces). Spawns from a thread outside the pool
+// go to a mutex-protected injection list. tp_sync helps while it waits: it
+// runs its own tasks, steals, and only parks on the group's futex when there
+// is nothing left to run. Idle workers park on a pool-wide futex word and are
+// woken by the next spawn, so an idle pool costs no CPU.
+//
+// A full deque (TP_DEQUE_CAP tasks) makes tp_spawn run the task inline,
+// which is always correct for fork-join code.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include "common_threads.h"     // Futex_wait/Futex_wake
+
+#define TP_DEQUE_CAP 4096           // power of two
+#define TP_STEAL_TRIES 2            // rounds over all victims before parking
+
+typedef void *(*tp_fn_t)(void *);
+
+typedef struct {
+    int pending;                    // tasks spawned and not yet finished
+    int waiters;                    // threads parked in tp_sync
+} tp_group_t;
+
+typedef struct tp_task {
+    tp_fn_t fn;
+    void *arg;
+    tp_group_t *group;
+    struct tp_task *next;           // injection list only
+} tp_task_t;
+
+typedef struct {
+    long top __attribute__((aligned(64)));
+    long bottom __attribute__((aligned(64)));
+    tp_task_t *buf[TP_DEQUE_CAP];
+} tp_deque_t;
+
+struct tp_pool;
+typedef struct {
+    struct tp_pool *pool;
+    int id;
+    unsigned seed;
+    pthread_t thread;
+    tp_deque_t dq;
+} tp_worker_t;
+
+typedef struct tp_pool {
+    int nworkers;
+    tp_worker_t *w;
+    pthread_mutex_t inject_lock;
+    tp_task_t *inject;
+    int ninject;
+    int sleepers __attribute__((aligned(64)));
+    int seq;                        // futex word idle workers park on
+    int stop;
+} tp_pool_t;
+
+static __thread tp_worker_t *tp_self;
+
+// ---- Chase-Lev deque (Le, Pop, Cohen, Zappa Nardelli, PPoPP'13) ----------
+static inline int tp_push(tp_deque_t *d, tp_task_t *t) {
+    long b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+    long top = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    if (b - top >= TP_DEQUE_CAP) return 0;
+    __atomic_store_n(&d->buf[b & (TP_DEQUE_CAP - 1)], t, __ATOMIC_RELAXED);
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELEASE);   // publishes the slot and *t
+    return 1;
+}
+
+static inline tp_task_t *tp_take(tp_deque_t *d) {
+    long b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long t = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+    tp_task_t *x = NULL;
+    if (t <= b) {
+        x = __atomic_load_n(&d->buf[b & (TP_DEQUE_CAP - 1)], __ATOMIC_RELAXED);
+        if (t == b) {               // last one: race the thieves for it
+            if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+                x = NULL;
+            __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+        }
+    } else {
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return x;
+}
+
+static inline tp_task_t *tp_steal(tp_deque_t *d) {
+    long t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+    if (t >= b) return NULL;
+    tp_task_t *x = __atomic_load_n(&d->buf[t & (TP_DEQUE_CAP - 1)], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        return NULL;
+    return x;
+}
+
+// ---- running tasks --------------------------------------------------------
+static inline void tp_run(tp_task_t *t) {
+    tp_group_t *g = t->group;
+    t->fn(t->arg);
+    free(t);
+    if (__atomic_sub_fetch(&g->pending, 1, __ATOMIC_SEQ_CST) == 0 && __atomic_load_n(&g->waiters, __ATOMIC_SEQ_CST))
+        Futex_wake(&g->pending, INT_MAX);
+}
+
+static tp_task_t *tp_pop_inject(tp_pool_t *tp) {
+    if (!__atomic_load_n(&tp->ninject, __ATOMIC_ACQUIRE)) return NULL;
+    pthread_mutex_lock(&tp->inject_lock);
+    tp_task_t *t = tp->inject;
+    if (t) { tp->inject = t->next; __atomic_sub_fetch(&tp->ninject, 1, __ATOMIC_RELAXED); }
+    pthread_mutex_unlock(&tp->inject_lock);
+    return t;
+}
+
+// One task from anywhere: own deque, injection list, then other deques.
+static tp_task_t *tp_find(tp_pool_t *tp) {
+    tp_worker_t *me = tp_self && tp_self->pool == tp ? tp_self : NULL;
+    tp_task_t *t;
+    if (me && (t = tp_take(&me->dq))) return t;
+    if ((t = tp_pop_inject(tp))) return t;
+    unsigned seed = me ? me->seed : (unsigned) (uintptr_t) &t;
+    for (int round = 0; round < TP_STEAL_TRIES; round++) {
+        seed = seed * 1103515245u + 12345u;
+        int start = (seed >> 16) % tp->nworkers;
+        for (int i = 0; i < tp->nworkers; i++) {
+            tp_worker_t *v = &tp->w[(start + i) % tp->nworkers];
+            if (v != me && (t = tp_steal(&v->dq))) break;
+        }
+        if (t) break;
+    }
+    if (me) me->seed = seed;
+    return t;
+}
+
+static inline int tp_has_work(tp_pool_t *tp) {
+    if (__atomic_load_n(&tp->ninject, __ATOMIC_SEQ_CST)) return 1;
+    for (int i = 0; i < tp->nworkers; i++)
+        if (__atomic_load_n(&tp->w[i].dq.top, __ATOMIC_SEQ_CST) < __atomic_load_n(&tp->w[i].dq.bottom, __ATOMIC_SEQ_CST))
+            return 1;
+    return 0;
+}
+
+static void *tp_worker_main(void *arg) {
+    tp_worker_t *me = (tp_worker_t *) arg;
+    tp_pool_t *tp = me->pool;
+    tp_self = me;
+    for (;;) {
+        tp_task_t *t = tp_find(tp);
+        if (t) { tp_run(t); continue; }
+        // Announce we're about to sleep, then look once more: a spawner
+        // either sees sleepers > 0 and bumps seq, or we see its task here.
+        int s = __atomic_load_n(&tp->seq, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&tp->sleepers, 1, __ATOMIC_SEQ_CST);
+        if (!__atomic_load_n(&tp->stop, __ATOMIC_SEQ_CST) && !tp_has_work(tp))
+            Futex_wait(&tp->seq, s);
+        __atomic_sub_fetch(&tp->sleepers, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&tp->stop, __ATOMIC_SEQ_CST)) break;
+    }
+    return NULL;
+}
+
+static inline void tp_wake_one(tp_pool_t *tp) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&tp->sleepers, __ATOMIC_SEQ_CST)) {
+        __atomic_add_fetch(&tp->seq, 1, __ATOMIC_SEQ_CST);
+        Futex_wake(&tp->seq, 1);
+    }
+}
+
+// ---- API ------------------------------------------------------------------
+static inline void tp_group_init(tp_group_t *g) {
+    g->pending = 0;
+    g->waiters = 0;
+}
+
+tp_pool_t *tp_create(int nworkers) {
+    tp_pool_t *tp = calloc(1, sizeof(tp_pool_t));
+    tp->nworkers = nworkers > 0 ? nworkers : 1;
+    int rc = posix_memalign((void **) &tp->w, 64, sizeof(tp_worker_t) * tp->nworkers);
+    assert(rc == 0);
+    pthread_mutex_init(&tp->inject_lock, NULL);
+    for (int i = 0; i < tp->nworkers; i++) {
+        tp_worker_t *w = &tp->w[i];
+        w->pool = tp;
+        w->id = i;
+        w->seed = 2654435761u * (i + 1);
+        w->dq.top = w->dq.bottom = 0;
+    }
+    for (int i = 0; i < tp->nworkers; i++) {
+        rc = pthread_create(&tp->w[i].thread, NULL, tp_worker_main, &tp->w[i]);
+        assert(rc == 0);
+    }
+    (void) rc;
+    return tp;
+}
+
+void tp_spawn(tp_pool_t *tp, tp_group_t *g, tp_fn_t fn, void *arg) {
+    tp_task_t *t = malloc(sizeof(tp_task_t));
+    t->fn = fn;
+    t->arg = arg;
+    t->group = g;
+    __atomic_add_fetch(&g->pending, 1, __ATOMIC_RELAXED);
+    if (tp_self && tp_self->pool == tp) {
+        if (!tp_push(&tp_self->dq, t)) { tp_run(t); return; }
+    } else {
+        pthread_mutex_lock(&tp->inject_lock);
+        t->next = tp->inject;
+        tp->inject = t;
+        __atomic_add_fetch(&tp->ninject, 1, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&tp->inject_lock);
+    }
+    tp_wake_one(tp);
+}
+
+void tp_sync(tp_pool_t *tp, tp_group_t *g) {
+    int p;
+    while ((p = __atomic_load_n(&g->pending, __ATOMIC_ACQUIRE)) != 0) {
+        tp_task_t *t = tp_find(tp);
+        if (t) { tp_run(t); continue; }
+        // Nothing to help with: the rest is running elsewhere.
+        __atomic_add_fetch(&g->waiters, 1, __ATOMIC_SEQ_CST);
+        if ((p = __atomic_load_n(&g->pending, __ATOMIC_SEQ_CST)) != 0)
+            Futex_wait(&g->pending, p);
+        __atomic_sub_fetch(&g->waiters, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+void tp_destroy(tp_pool_t *tp) {
+    __atomic_store_n(&tp->stop, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&tp->seq, 1, __ATOMIC_SEQ_CST);
+    Futex_wake(&tp->seq, INT_MAX);
+    for (int i = 0; i < tp->nworkers; i++)
+        pthread_join(tp->w[i].thread, NULL);
+    pthread_mutex_destroy(&tp->inject_lock);
+    free(tp->w);
+    free(tp);
+}
+
+#endif // __taskpool_h__
@@ -0,0 +1,107 @@
+#ifndef __histogram_h__
+#define __histogram_h__
+
+// Log-linear ("HDR-style") latency histogram.
+//
+// Values below 2^HIST_SUB_BITS get one bucket each; above that every power of
+// two is split into 2^HIST_SUB_BITS linear sub-buckets, so any reported value
+// is within 1/16 (6.25%) of the true one over the full 64-bit range. One
+// histogram is ~8KB; give each thread its own and hist_merge() them after
+// join, so recording never writes shared memory.
+//
+// Units are whatever the caller records (ticks or ns); hist_quantile() returns
+// the same unit.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define HIST_SUB_BITS 4
+#define HIST_SUB      (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS  ((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+typedef struct {
+    uint64_t count[HIST_BUCKETS];
+    uint64_t n, sum, min, max;
+} hist_t;
+
+static inline void hist_init(hist_t *h) {
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+static inline int hist_index(uint64_t v) {
+    if (v < HIST_SUB)
+        return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    int group = msb - HIST_SUB_BITS + 1;
+    return group * HIST_SUB + (int)((v >> (msb - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+// Largest value that maps to bucket i.
+static inline uint64_t hist_bucket_high(int i) {
+    int group = i / HIST_SUB, sub = i % HIST_SUB;
+    if (group == 0)
+        return (uint64_t)sub;
+    uint64_t lo = (uint64_t)(HIST_SUB + sub) << (group - 1);
+    return lo + ((1ULL << (group - 1)) - 1);
+}
+
+static inline void hist_record(hist_t *h, uint64_t v) {
+    h->count[hist_index(v)]++;
+    h->n++;
+    h->sum += v;
+    if (v < h->min) h->min = v;
+    if (v > h->max) h->max = v;
+}
+
+static inline void hist_merge(hist_t *dst, const hist_t *src) {
+    for (int i = 0; i < HIST_BUCKETS; i++)
+        dst->count[i] += src->count[i];
+    dst->n += src->n;
+    dst->sum += src->sum;
+    if (src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max) dst->max = src->max;
+}
+
+// Value at quantile q in [0,1]; q=1 gives the exact max.
+static inline uint64_t hist_quantile(const hist_t *h, double q) {
+    if (h->n == 0)
+        return 0;
+    if (q >= 1.0)
+        return h->max;
+    uint64_t rank = (uint64_t)(q * (double)h->n), seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->count[i];
+        if (seen > rank) {
+            uint64_t v = hist_bucket_high(i);
+            return v < h->max ? v : h->max;
+        }
+    }
+    return h->max;
+}
+
+static inline double hist_mean(const hist_t *h) {
+    return h->n ? (double)h->sum / (double)h->n : 0.0;
+}
+
+// The percentile set every report uses.
+#define HIST_NQ 5
+static const double hist_quantiles[HIST_NQ] = { 0.50, 0.90, 0.99, 0.999, 1.0 };
+static const char *hist_quantile_names[HIST_NQ] = { "p50", "p90", "p99", "p999", "max" };
+
+// Writes "mean,p50,p90,p99,p999,max" (scaled by `scale`, e.g. ns per tick).
+static inline void hist_print_csv(FILE *f, const hist_t *h, double scale) {
+    fprintf(f, "%.1f", hist_mean(h) * scale);
+    for (int i = 0; i < HIST_NQ; i++)
+        fprintf(f, ",%.1f", (double)hist_quantile(h, hist_quantiles[i]) * scale);
+}
+
+// Writes "\"mean_ns\":..,\"p50_ns\":..,..." (no braces) for embedding in JSON.
+static inline void hist_print_json(FILE *f, const hist_t *h, double scale) {
+    fprintf(f, "\"count\":%llu,\"mean_ns\":%.1f", (unsigned long long)h->n, hist_mean(h) * scale);
+    for (int i = 0; i < HIST_NQ; i++)
+        fprintf(f, ",\"%s_ns\":%.1f", hist_quantile_names[i], (double)hist_quantile(h, hist_quantiles[i]) * scale);
+}
+
+#endif // __histogram_h__
@@ -0,0 +1,98 @@
+#ifndef __hrtime_h__
+#define __hrtime_h__
+
+// High-resolution timing shared by the benchmark programs.
+//
+//   hr_now_ns()        clock_gettime(CLOCK_MONOTONIC_RAW), ns since boot
+//   hr_ticks()         raw cycle counter (rdtsc on x86, cntvct_el0 on arm64);
+//   hr_ticks_end()     same, but waits for earlier instructions to finish
+//   hr_ticks_to_ns(t)  converts a tick delta using a one-time calibration
+//
+// Use hr_now_ns() for whole-run timing and the tick pair around regions too
+// short for a clock_gettime call (single ops, single TLB accesses).
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/time.h>
+
+#ifdef CLOCK_MONOTONIC_RAW
+#define HR_CLOCK CLOCK_MONOTONIC_RAW
+#else
+#define HR_CLOCK CLOCK_MONOTONIC
+#endif
+
+static inline uint64_t hr_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(HR_CLOCK, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline double hr_elapsed_ms(uint64_t start_ns, uint64_t end_ns) {
+    return (double)(end_ns - start_ns) / 1e6;
+}
+
+static inline uint64_t hr_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi;
+    __asm__ __volatile__("lfence; rdtsc" : "=a"(lo), "=d"(hi) :: "memory");
+    return ((uint64_t)hi << 32) | lo;
+#elif defined(__aarch64__)
+    uint64_t v;
+    __asm__ __volatile__("isb; mrs %0, cntvct_el0" : "=r"(v) :: "memory");
+    return v;
+#else
+    return hr_now_ns();
+#endif
+}
+
+static inline uint64_t hr_ticks_end(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi, aux;
+    __asm__ __volatile__("rdtscp; lfence" : "=a"(lo), "=d"(hi), "=c"(aux) :: "memory");
+    return ((uint64_t)hi << 32) | lo;
+#else
+    return hr_ticks();
+#endif
+}
+
+static double hr_ns_per_tick_ = 0.0;
+
+// Ticks-to-ns factor. arm64 publishes its counter frequency; on x86 the TSC is
+// measured against the monotonic clock for ~10 ms, once per process.
+static inline double hr_ns_per_tick(void) {
+    if (hr_ns_per_tick_ > 0.0)
+        return hr_ns_per_tick_;
+#if defined(__aarch64__)
+    uint64_t freq;
+    __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(freq));
+    hr_ns_per_tick_ = 1e9 / (double)freq;
+#elif defined(__x86_64__) || defined(__i386__)
+    uint64_t n0 = hr_now_ns(), t0 = hr_ticks();
+    while (hr_now_ns() - n0 < 10000000ULL)
+        ;
+    uint64_t n1 = hr_now_ns(), t1 = hr_ticks();
+    hr_ns_per_tick_ = (double)(n1 - n0) / (double)(t1 - t0);
+#else
+    hr_ns_per_tick_ = 1.0;
+#endif
+    return hr_ns_per_tick_;
+}
+
+static inline double hr_ticks_to_ns(uint64_t ticks) {
+    return (double)ticks * hr_ns_per_tick();
+}
+
+// Smallest non-zero step a clock can show, in ns (minimum over `samples` reads).
+static inline uint64_t hr_clock_granularity_ns(int samples) {
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < samples; i++) {
+        uint64_t a = hr_now_ns(), b;
+        while ((b = hr_now_ns()) == a)
+            ;
+        if (b - a < best)
+            best = b - a;
+    }
+    return best;
+}
+
+#endif // __hrtime_h__
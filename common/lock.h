@@ -0,0 +1,198 @@
+#ifndef __lock_h__
+#define __lock_h__
+
+// One lock type, four implementations, picked once per run with
+// lock_set_kind() before any lock_init():
+//
+//   mutex  - pthread_mutex_t (futex handoff on Linux)
+//   ttas   - test-and-test-and-set spinlock with exponential backoff
+//   ticket - FIFO ticket lock (fetch-and-add, as in exercise28/ticket.s)
+//   mcs    - Mellor-Crummey/Scott queue lock: each waiter spins on its own
+//            cache line, so a release touches only the next waiter
+//
+// MCS needs a queue node per held lock. Callers don't pass one: each thread
+// has a small pool of cache-line-aligned qnodes (LOCK_QNODES, enough for the
+// hand-over-hand and migrate paths, which hold at most two locks at once) and
+// the lock remembers its holder's qnode so lock_release() can find it.
+//
+// Spinners yield the CPU every LOCK_SPIN_YIELD polls, so oversubscribed runs
+// (more threads than CPUs) still make progress when the holder is preempted.
+//
+// Built with -DTRACE, acquires and releases are recorded in common/trace.h:
+// a wait event only when the lock was busy, then acquired and released.
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <assert.h>
+#include "trace.h"
+
+enum { LOCK_MUTEX, LOCK_TTAS, LOCK_TICKET, LOCK_MCS, LOCK_NKINDS };
+static const char *lock_names[LOCK_NKINDS] = { "mutex", "ttas", "ticket", "mcs" };
+
+#define LOCK_QNODES     8
+#define LOCK_SPIN_YIELD 256
+#define LOCK_BACKOFF_MAX 1024
+
+typedef struct mcs_qnode {
+    struct mcs_qnode *next;
+    int locked;
+} __attribute__((aligned(64))) mcs_qnode_t;
+
+typedef struct {
+    union {
+        pthread_mutex_t m;
+        int flag;
+        struct { unsigned next, serving; } t;
+        struct { mcs_qnode_t *tail, *holder; } q;
+    } u;
+} lock_t;
+
+static int lock_kind_;
+
+static inline int lock_parse_kind(const char *s) {
+    for (int i = 0; i < LOCK_NKINDS; i++)
+        if (!strcmp(s, lock_names[i])) return i;
+    return -1;
+}
+static inline void lock_set_kind(int kind) { lock_kind_ = kind; }
+static inline int lock_kind(void) { return lock_kind_; }
+static inline const char *lock_kind_name(void) { return lock_names[lock_kind_]; }
+
+static inline void lock_pause(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __asm__ __volatile__("pause");
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+// One poll of a spin loop; *spins counts polls since the last yield.
+static inline void lock_spin(int *spins) {
+    if (++*spins < LOCK_SPIN_YIELD) lock_pause();
+    else { *spins = 0; sched_yield(); }
+}
+
+static __thread mcs_qnode_t lock_qnodes_[LOCK_QNODES];
+static __thread unsigned lock_qmask_;
+static inline mcs_qnode_t *lock_qnode_get(void) {
+    assert(lock_qmask_ != (1u << LOCK_QNODES) - 1 && "too many MCS locks held at once");
+    int i = __builtin_ctz(~lock_qmask_);
+    lock_qmask_ |= 1u << i;
+    return &lock_qnodes_[i];
+}
+static inline void lock_qnode_put(mcs_qnode_t *q) { lock_qmask_ &= ~(1u << (q - lock_qnodes_)); }
+
+static inline void lock_init(lock_t *l) {
+    memset(l, 0, sizeof(*l));
+    if (lock_kind_ == LOCK_MUTEX) pthread_mutex_init(&l->u.m, NULL);
+}
+static inline void lock_destroy(lock_t *l) {
+    if (lock_kind_ == LOCK_MUTEX) pthread_mutex_destroy(&l->u.m);
+}
+
+static inline void lock_acquire(lock_t *l) {
+    int spins = 0;
+    switch (lock_kind_) {
+    case LOCK_MUTEX:
+        if (TRACE_ON) {
+            if (pthread_mutex_trylock(&l->u.m) == 0) break;
+            trace_event(TR_LOCK_WAIT, l);
+        }
+        pthread_mutex_lock(&l->u.m);
+        break;
+    case LOCK_TTAS: {
+        int backoff = 1;
+        if (TRACE_ON && __atomic_load_n(&l->u.flag, __ATOMIC_RELAXED)) trace_event(TR_LOCK_WAIT, l);
+        for (;;) {
+            while (__atomic_load_n(&l->u.flag, __ATOMIC_RELAXED)) lock_spin(&spins);
+            if (!__atomic_exchange_n(&l->u.flag, 1, __ATOMIC_ACQUIRE)) break;
+            for (int i = 0; i < backoff; i++) lock_pause();
+            if (backoff < LOCK_BACKOFF_MAX) backoff <<= 1;
+        }
+        break;
+    }
+    case LOCK_TICKET: {
+        unsigned my = __atomic_fetch_add(&l->u.t.next, 1, __ATOMIC_RELAXED);
+        if (TRACE_ON && __atomic_load_n(&l->u.t.serving, __ATOMIC_RELAXED) != my) trace_event(TR_LOCK_WAIT, l);
+        while (__atomic_load_n(&l->u.t.serving, __ATOMIC_ACQUIRE) != my) lock_spin(&spins);
+        break;
+    }
+    case LOCK_MCS: {
+        mcs_qnode_t *q = lock_qnode_get();
+        q->next = NULL; q->locked = 1;
+        mcs_qnode_t *pred = __atomic_exchange_n(&l->u.q.tail, q, __ATOMIC_ACQ_REL);
+        if (pred) {
+            trace_event(TR_LOCK_WAIT, l);
+            __atomic_store_n(&pred->next, q, __ATOMIC_RELEASE);
+            while (__atomic_load_n(&q->locked, __ATOMIC_ACQUIRE)) lock_spin(&spins);
+        }
+        l->u.q.holder = q;
+        break;
+    }
+    }
+    trace_event(TR_LOCK_ACQUIRED, l);
+}
+
+// Returns 1 if the lock was taken, 0 if it was busy.
+static inline int lock_try(lock_t *l) {
+    int ok = 0;
+    switch (lock_kind_) {
+    case LOCK_MUTEX:
+        ok = pthread_mutex_trylock(&l->u.m) == 0;
+        break;
+    case LOCK_TTAS:
+        ok = !__atomic_load_n(&l->u.flag, __ATOMIC_RELAXED) && !__atomic_exchange_n(&l->u.flag, 1, __ATOMIC_ACQUIRE);
+        break;
+    case LOCK_TICKET: {
+        unsigned s = __atomic_load_n(&l->u.t.serving, __ATOMIC_ACQUIRE), n = s;
+        ok = __atomic_compare_exchange_n(&l->u.t.next, &n, s + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+        break;
+    }
+    case LOCK_MCS: {
+        mcs_qnode_t *q = lock_qnode_get(), *none = NULL;
+        q->next = NULL; q->locked = 1;
+        if (!__atomic_compare_exchange_n(&l->u.q.tail, &none, q, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            lock_qnode_put(q);
+            break;
+        }
+        l->u.q.holder = q;
+        ok = 1;
+        break;
+    }
+    }
+    if (ok) trace_event(TR_LOCK_ACQUIRED, l);
+    return ok;
+}
+
+static inline void lock_release(lock_t *l) {
+    int spins = 0;
+    trace_event(TR_LOCK_RELEASED, l);
+    switch (lock_kind_) {
+    case LOCK_MUTEX:
+        pthread_mutex_unlock(&l->u.m);
+        break;
+    case LOCK_TTAS:
+        __atomic_store_n(&l->u.flag, 0, __ATOMIC_RELEASE);
+        break;
+    case LOCK_TICKET:
+        __atomic_store_n(&l->u.t.serving, l->u.t.serving + 1, __ATOMIC_RELEASE);
+        break;
+    case LOCK_MCS: {
+        mcs_qnode_t *q = l->u.q.holder, *succ = __atomic_load_n(&q->next, __ATOMIC_ACQUIRE);
+        if (!succ) {
+            mcs_qnode_t *expect = q;
+            if (__atomic_compare_exchange_n(&l->u.q.tail, &expect, NULL, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+                lock_qnode_put(q);
+                break;
+            }
+            // Someone swapped in behind us but hasn't linked yet.
+            while (!(succ = __atomic_load_n(&q->next, __ATOMIC_ACQUIRE))) lock_spin(&spins);
+        }
+        __atomic_store_n(&succ->locked, 0, __ATOMIC_RELEASE);
+        lock_qnode_put(q);
+        break;
+    }
+    }
+}
+
+#endif // __lock_h__
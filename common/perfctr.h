@@ -0,0 +1,149 @@
+#ifndef __perfctr_h__
+#define __perfctr_h__
+
+// Hardware counters around a timed region, via perf_event_open (Linux).
+//
+//   perfctr_t pc;
+//   perf_open(&pc);                 // once; unavailable events are noted on stderr
+//                                   // (perf_open_self: this thread only)
+//   perf_start(&pc);  ...timed region...  perf_stop(&pc);
+//   perf_print(stdout, &pc, ops);   // " cycles=... ipc=... dtlb_miss=..." (+ per op)
+//
+// Events (user space only, so perf_event_paranoid <= 2 is enough):
+//
+//   cycles, instr   generic hardware events
+//   dtlb_miss       dTLB load misses (hw cache event DTLB/READ/MISS)
+//   llc_miss        last-level cache misses (hw cache event LL/READ/MISS)
+//   hitm            loads served by a modified line in another core's cache,
+//                   i.e. cache-line transfers. There is no generic event for
+//                   this, so it is a raw one: PERF_HITM=<hex config> picks it,
+//                   PERF_HITM=off disables it. The default on Intel is 0x04d2
+//                   (MEM_LOAD_L3_HIT_RETIRED.XSNP_HITM, Skylake and later);
+//                   elsewhere it is off unless set.
+//
+// perf_open opens the counters with inherit, so threads created after it are
+// counted too: read() returns the calling thread's count plus that of every
+// inherited child, live ones included, and an exited child's total stays in.
+// A region's delta therefore covers whatever those threads did meanwhile.
+// perf_open_self opens them without inherit, counting the calling thread
+// alone, for when other threads are noise. Each event is its own read-only
+// counter, kept enabled. perf_start/perf_stop read it and take the
+// difference, scaled up if the kernel had to multiplex it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+enum { PERF_CYCLES, PERF_INSTR, PERF_DTLB, PERF_LLC, PERF_HITM, PERF_NEVENTS };
+static const char *perf_names[PERF_NEVENTS] = { "cycles", "instr", "dtlb_miss", "llc_miss", "hitm" };
+
+typedef struct {
+    int fd[PERF_NEVENTS];              // -1 = not available
+    uint64_t start[PERF_NEVENTS][3];   // value, time_enabled, time_running
+    double val[PERF_NEVENTS];          // last start..stop delta, -1 = n/a
+} perfctr_t;
+
+#ifdef __linux__
+// Default raw HITM event for this CPU, 0 if we don't know one.
+static inline uint64_t perf_hitm_default_(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    char line[256];
+    int intel = 0;
+    if (f) {
+        while (fgets(line, sizeof(line), f))
+            if (!strncmp(line, "vendor_id", 9)) { intel = strstr(line, "GenuineIntel") != NULL; break; }
+        fclose(f);
+    }
+    return intel ? 0x04d2 : 0;
+#else
+    return 0;
+#endif
+}
+
+static inline int perf_open_one_(uint32_t type, uint64_t config, int inherit) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.inherit = inherit;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+#define PERF_CACHE_MISS_(c) ((c) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+#endif
+
+// Returns the number of events that could be opened.
+static inline int perf_open_(perfctr_t *p, int inherit) {
+    int n = 0;
+    for (int i = 0; i < PERF_NEVENTS; i++) { p->fd[i] = -1; p->val[i] = -1; }
+#ifdef __linux__
+    const char *env = getenv("PERF_HITM");
+    uint64_t hitm = env ? (strcmp(env, "off") ? strtoull(env, NULL, 16) : 0) : perf_hitm_default_();
+    p->fd[PERF_CYCLES] = perf_open_one_(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, inherit);
+    p->fd[PERF_INSTR] = perf_open_one_(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, inherit);
+    p->fd[PERF_DTLB] = perf_open_one_(PERF_TYPE_HW_CACHE, PERF_CACHE_MISS_(PERF_COUNT_HW_CACHE_DTLB), inherit);
+    p->fd[PERF_LLC] = perf_open_one_(PERF_TYPE_HW_CACHE, PERF_CACHE_MISS_(PERF_COUNT_HW_CACHE_LL), inherit);
+    if (hitm) p->fd[PERF_HITM] = perf_open_one_(PERF_TYPE_RAW, hitm, inherit);
+#else
+    (void) inherit;
+#endif
+    for (int i = 0; i < PERF_NEVENTS; i++) n += p->fd[i] >= 0;
+    if (n < PERF_NEVENTS) {
+        fprintf(stderr, "[perf] unavailable:");
+        for (int i = 0; i < PERF_NEVENTS; i++) if (p->fd[i] < 0) fprintf(stderr, " %s", perf_names[i]);
+        fprintf(stderr, "\n");
+    }
+    return n;
+}
+
+static inline int perf_open(perfctr_t *p) { return perf_open_(p, 1); }
+static inline int perf_open_self(perfctr_t *p) { return perf_open_(p, 0); }
+
+static inline void perf_start(perfctr_t *p) {
+    for (int i = 0; i < PERF_NEVENTS; i++)
+        if (p->fd[i] >= 0 && read(p->fd[i], p->start[i], sizeof(p->start[i])) != sizeof(p->start[i]))
+            memset(p->start[i], 0, sizeof(p->start[i]));
+}
+
+static inline void perf_stop(perfctr_t *p) {
+    for (int i = 0; i < PERF_NEVENTS; i++) {
+        uint64_t v[3];
+        p->val[i] = -1;
+        if (p->fd[i] < 0 || read(p->fd[i], v, sizeof(v)) != sizeof(v)) continue;
+        uint64_t dv = v[0] - p->start[i][0], de = v[1] - p->start[i][1], dr = v[2] - p->start[i][2];
+        p->val[i] = dr && dr < de ? (double) dv * de / dr : (double) dv;
+    }
+}
+
+// Prints " name=value" for every event (n/a if missing), ipc, and per-op
+// figures when ops > 0. No newline.
+static inline void perf_print(FILE *f, const perfctr_t *p, double ops) {
+    for (int i = 0; i < PERF_NEVENTS; i++) {
+        if (p->val[i] < 0) fprintf(f, " %s=n/a", perf_names[i]);
+        else fprintf(f, " %s=%.0f", perf_names[i], p->val[i]);
+    }
+    if (p->val[PERF_CYCLES] > 0 && p->val[PERF_INSTR] >= 0)
+        fprintf(f, " ipc=%.2f", p->val[PERF_INSTR] / p->val[PERF_CYCLES]);
+    if (ops > 0)
+        for (int i = 0; i < PERF_NEVENTS; i++)
+            if (i != PERF_INSTR && p->val[i] >= 0) fprintf(f, " %s_per_op=%.3f", perf_names[i], p->val[i] / ops);
+}
+
+static inline void perf_close(perfctr_t *p) {
+    for (int i = 0; i < PERF_NEVENTS; i++)
+        if (p->fd[i] >= 0) { close(p->fd[i]); p->fd[i] = -1; }
+}
+
+#endif // __perfctr_h__
@@ -0,0 +1,325 @@
+#ifndef __reclaim_h__
+#define __reclaim_h__
+
+// Safe memory reclamation for structures whose readers take no locks: a node
+// that has been unlinked is retired instead of freed, and freed only once no
+// thread can still be looking at it. One API, three modes, picked once per
+// run with reclaim_set_mode() before any thread starts:
+//
+//   none  - retired nodes wait until reclaim_drain() (memory grows with
+//           every delete until the run is over)
+//   ebr   - epoch-based: readers announce the global epoch on entry; a node
+//           retired in epoch e is freed once the epoch has reached e + 2,
+//           which needs every thread inside a section to have seen e + 1
+//   hp    - hazard pointers (Michael): a reader publishes each node before
+//           trusting it, and a node is freed once no slot points at it.
+//           Bounded garbage even if a reader stalls, but every step of a
+//           traversal costs a fenced store and a re-check
+//
+//   reclaim_enter();                      // around every operation
+//   c = reclaim_protect(0, &pred->next);  // hp: publish + validate; else a load
+//   reclaim_hazard(1, n);                 // hp: publish only, caller validates
+//   reclaim_retire(c, sizeof(*c), fn);    // fn(c, size) runs when it is safe
+//   reclaim_exit();                       // ebr: leave the epoch; hp: clear slots
+//
+// Each thread has a record with its epoch word, RECLAIM_HPS hazard slots and
+// its own retire list, so retiring never touches shared state. Every
+// RECLAIM_BATCH retires (plus twice the number of hazard slots in use, under
+// hp) the thread scans: ebr tries to advance the epoch and frees the nodes
+// that are two epochs old, hp sorts the published hazards and frees whatever
+// none of them names. Records are made on a thread's first use and handed to
+// the next new thread when it exits, together with anything still retired.
+//
+// Hazard slots ignore the two low bits of a pointer, so mark bits don't hide
+// a node. reclaim_stats() reports what was retired and freed, the peak of
+// retired-but-unfreed nodes and bytes (sampled at each scan) and the time
+// spent scanning and freeing.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "hrtime.h"
+
+enum { RECLAIM_NONE, RECLAIM_EBR, RECLAIM_HP, RECLAIM_NMODES };
+static const char *reclaim_names[RECLAIM_NMODES] = { "none", "ebr", "hp" };
+
+#define RECLAIM_HPS   4
+#define RECLAIM_BATCH 64
+
+typedef struct {
+    void *p;
+    size_t sz;
+    void (*fn)(void *, size_t);
+    uint64_t epoch;
+} reclaim_ent_t;
+
+typedef struct reclaim_rec {
+    uint64_t word;                  // ebr: epoch << 1 | 1 inside a section, 0 outside
+    void *hp[RECLAIM_HPS];
+    int in_use, nest;
+    reclaim_ent_t *ents;
+    long n, cap, next_scan;
+    long unflushed;                 // retires not yet added to the global count
+    size_t unflushed_bytes;
+    uint64_t retired, freed, drained, scans, ticks;
+    void **seen;                    // hp scan scratch
+    long seen_cap;
+    struct reclaim_rec *next;
+} __attribute__((aligned(64))) reclaim_rec_t;
+
+typedef struct {
+    uint64_t retired, freed, drained, scans;
+    long peak_nodes;
+    size_t peak_bytes;
+    double scan_ns;
+} reclaim_stats_t;
+
+static int reclaim_mode_ = RECLAIM_EBR;
+static uint64_t reclaim_epoch_ __attribute__((aligned(64)));
+static reclaim_rec_t *reclaim_recs_;
+static int reclaim_nrecs_;
+static long reclaim_pending_, reclaim_peak_;
+static size_t reclaim_pending_bytes_, reclaim_peak_bytes_;
+static pthread_key_t reclaim_key_;
+static pthread_once_t reclaim_once_ = PTHREAD_ONCE_INIT;
+static __thread reclaim_rec_t *reclaim_rec_;
+
+static inline int reclaim_parse_mode(const char *s) {
+    for (int i = 0; i < RECLAIM_NMODES; i++)
+        if (!strcmp(s, reclaim_names[i])) return i;
+    return -1;
+}
+static inline void reclaim_set_mode(int mode) { reclaim_mode_ = mode; }
+static inline int reclaim_mode(void) { return reclaim_mode_; }
+static inline const char *reclaim_mode_name(void) { return reclaim_names[reclaim_mode_]; }
+static inline int reclaim_hp(void) { return reclaim_mode_ == RECLAIM_HP; }
+
+static void reclaim_thread_exit_(void *arg);
+static void reclaim_key_init_(void) { pthread_key_create(&reclaim_key_, reclaim_thread_exit_); }
+
+static __attribute__((noinline)) reclaim_rec_t *reclaim_rec_new_(void) {
+    pthread_once(&reclaim_once_, reclaim_key_init_);
+    reclaim_rec_t *r;
+    for (r = __atomic_load_n(&reclaim_recs_, __ATOMIC_ACQUIRE); r; r = r->next) {
+        int free_ = 0;
+        if (!__atomic_load_n(&r->in_use, __ATOMIC_RELAXED)
+            && __atomic_compare_exchange_n(&r->in_use, &free_, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            break;
+    }
+    if (!r) {
+        if (posix_memalign((void **) &r, 64, sizeof(reclaim_rec_t)) != 0) abort();
+        memset(r, 0, sizeof(*r));
+        r->in_use = 1;
+        r->next_scan = RECLAIM_BATCH;
+        __atomic_fetch_add(&reclaim_nrecs_, 1, __ATOMIC_RELAXED);
+        r->next = __atomic_load_n(&reclaim_recs_, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&reclaim_recs_, &r->next, r, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            ;
+    }
+    pthread_setspecific(reclaim_key_, r);
+    return reclaim_rec_ = r;
+}
+
+static inline reclaim_rec_t *reclaim_self_(void) {
+    reclaim_rec_t *r = reclaim_rec_;
+    return __builtin_expect(r != NULL, 1) ? r : reclaim_rec_new_();
+}
+
+static inline void reclaim_enter(void) {
+    if (reclaim_mode_ != RECLAIM_EBR) return;
+    reclaim_rec_t *r = reclaim_self_();
+    if (r->nest++) return;
+    __atomic_store_n(&r->word, __atomic_load_n(&reclaim_epoch_, __ATOMIC_RELAXED) << 1 | 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);   // announce before reading any node
+}
+
+static inline void reclaim_clear_(reclaim_rec_t *r) {
+    for (int i = 0; i < RECLAIM_HPS; i++) __atomic_store_n(&r->hp[i], NULL, __ATOMIC_RELEASE);
+}
+
+static inline void reclaim_exit(void) {
+    if (reclaim_mode_ == RECLAIM_HP) { reclaim_clear_(reclaim_self_()); return; }
+    if (reclaim_mode_ != RECLAIM_EBR) return;
+    reclaim_rec_t *r = reclaim_self_();
+    if (--r->nest == 0) __atomic_store_n(&r->word, 0, __ATOMIC_RELEASE);
+}
+
+static inline void reclaim_hazard(int i, const void *p) {
+    if (reclaim_mode_ != RECLAIM_HP) return;
+    __atomic_store_n(&reclaim_self_()->hp[i], (void *) ((uintptr_t) p & ~(uintptr_t) 3), __ATOMIC_SEQ_CST);
+}
+
+// Loads *src; under hp, publishes it in slot i and retries until *src still
+// holds it, so the node was reachable after the slot became visible.
+static inline void *reclaim_protect_(int i, void *const *src) {
+    void *p = __atomic_load_n(src, __ATOMIC_ACQUIRE);
+    if (reclaim_mode_ != RECLAIM_HP) return p;
+    reclaim_rec_t *r = reclaim_self_();
+    for (;;) {
+        __atomic_store_n(&r->hp[i], (void *) ((uintptr_t) p & ~(uintptr_t) 3), __ATOMIC_SEQ_CST);
+        void *q = __atomic_load_n(src, __ATOMIC_SEQ_CST);
+        if (q == p) return p;
+        p = q;
+    }
+}
+#define reclaim_protect(i, src) ((__typeof__(*(src))) reclaim_protect_((i), (void *const *) (src)))
+
+static inline void reclaim_flush_(long nodes, long bytes) {
+    long n = __atomic_add_fetch(&reclaim_pending_, nodes, __ATOMIC_RELAXED);
+    size_t b = __atomic_add_fetch(&reclaim_pending_bytes_, (size_t) bytes, __ATOMIC_RELAXED);
+    long pk = __atomic_load_n(&reclaim_peak_, __ATOMIC_RELAXED);
+    while (n > pk && !__atomic_compare_exchange_n(&reclaim_peak_, &pk, n, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+    size_t pb = __atomic_load_n(&reclaim_peak_bytes_, __ATOMIC_RELAXED);
+    while (b > pb && !__atomic_compare_exchange_n(&reclaim_peak_bytes_, &pb, b, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+// The epoch moves on only when every thread inside a section has seen it.
+static inline void reclaim_try_advance_(void) {
+    uint64_t e = __atomic_load_n(&reclaim_epoch_, __ATOMIC_SEQ_CST);
+    for (reclaim_rec_t *r = __atomic_load_n(&reclaim_recs_, __ATOMIC_ACQUIRE); r; r = r->next) {
+        uint64_t w = __atomic_load_n(&r->word, __ATOMIC_SEQ_CST);
+        if ((w & 1) && (w >> 1) != e) return;
+    }
+    __atomic_compare_exchange_n(&reclaim_epoch_, &e, e + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+static int reclaim_ptr_cmp_(const void *a, const void *b) {
+    uintptr_t x = (uintptr_t) *(void *const *) a, y = (uintptr_t) *(void *const *) b;
+    return x < y ? -1 : x > y;
+}
+
+static void reclaim_scan_(reclaim_rec_t *r) {
+    uint64_t t0 = hr_ticks();
+    long kept = 0, freed = 0;
+    size_t freed_bytes = 0;
+    reclaim_flush_(r->unflushed, (long) r->unflushed_bytes);
+    r->unflushed = 0;
+    r->unflushed_bytes = 0;
+    if (reclaim_mode_ == RECLAIM_EBR) {
+        reclaim_try_advance_();
+        uint64_t e = __atomic_load_n(&reclaim_epoch_, __ATOMIC_SEQ_CST);
+        for (long i = 0; i < r->n; i++) {       // oldest first: ages only grow along the list
+            reclaim_ent_t *x = &r->ents[i];
+            if (x->epoch + 2 > e) { memmove(r->ents, x, sizeof(*x) * (r->n - i)); kept = r->n - i; break; }
+            x->fn(x->p, x->sz);
+            freed++; freed_bytes += x->sz;
+        }
+    } else if (reclaim_mode_ == RECLAIM_HP) {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);  // unlinks before reading the slots
+        long nseen = 0;
+        for (reclaim_rec_t *o = __atomic_load_n(&reclaim_recs_, __ATOMIC_ACQUIRE); o; o = o->next)
+            for (int i = 0; i < RECLAIM_HPS; i++) {
+                void *p = __atomic_load_n(&o->hp[i], __ATOMIC_SEQ_CST);
+                if (!p) continue;
+                if (nseen == r->seen_cap) {
+                    long cap = r->seen_cap ? r->seen_cap * 2 : 4 * RECLAIM_HPS;
+                    void **sn = (void **) realloc(r->seen, sizeof(void *) * cap);
+                    if (!sn) abort();
+                    r->seen = sn;
+                    r->seen_cap = cap;
+                }
+                r->seen[nseen++] = p;
+            }
+        if (nseen) qsort(r->seen, nseen, sizeof(void *), reclaim_ptr_cmp_);
+        for (long i = 0; i < r->n; i++) {
+            reclaim_ent_t *x = &r->ents[i];
+            if (nseen && bsearch(&x->p, r->seen, nseen, sizeof(void *), reclaim_ptr_cmp_)) { r->ents[kept++] = *x; continue; }
+            x->fn(x->p, x->sz);
+            freed++; freed_bytes += x->sz;
+        }
+    } else {
+        kept = r->n;
+    }
+    r->n = kept;
+    r->freed += freed;
+    r->scans++;
+    reclaim_flush_(-freed, -(long) freed_bytes);
+    long thresh = reclaim_mode_ == RECLAIM_HP ? RECLAIM_BATCH + 2L * RECLAIM_HPS * __atomic_load_n(&reclaim_nrecs_, __ATOMIC_RELAXED)
+                                              : RECLAIM_BATCH;
+    r->next_scan = r->n + thresh;
+    r->ticks += hr_ticks() - t0;
+}
+
+// fn(p, sz) runs once no thread can reach p; p must already be unlinked.
+static inline void reclaim_retire(void *p, size_t sz, void (*fn)(void *, size_t)) {
+    reclaim_rec_t *r = reclaim_self_();
+    if (r->n == r->cap) {
+        long cap = r->cap ? r->cap * 2 : 2 * RECLAIM_BATCH;
+        reclaim_ent_t *e = (reclaim_ent_t *) realloc(r->ents, sizeof(reclaim_ent_t) * cap);
+        if (!e) abort();
+        r->ents = e;
+        r->cap = cap;
+    }
+    reclaim_ent_t *x = &r->ents[r->n++];
+    x->p = p;
+    x->sz = sz;
+    x->fn = fn;
+    x->epoch = reclaim_mode_ == RECLAIM_EBR ? __atomic_load_n(&reclaim_epoch_, __ATOMIC_SEQ_CST) : 0;
+    r->retired++;
+    r->unflushed++;
+    r->unflushed_bytes += sz;
+    if (r->n >= r->next_scan) reclaim_scan_(r);
+}
+
+// Runs at thread exit: leaves every section, frees what it can and leaves
+// the rest on the record for the next thread that takes it over.
+static void reclaim_thread_exit_(void *arg) {
+    reclaim_rec_t *r = (reclaim_rec_t *) arg;
+    r->nest = 0;
+    __atomic_store_n(&r->word, 0, __ATOMIC_RELEASE);
+    reclaim_clear_(r);
+    if (r->n && reclaim_mode_ != RECLAIM_NONE) reclaim_scan_(r);
+    reclaim_rec_ = NULL;
+    __atomic_store_n(&r->in_use, 0, __ATOMIC_RELEASE);
+}
+
+// Frees everything still retired. Only call once no thread is inside a
+// section (after the workers have been joined).
+static void reclaim_drain(void) {
+    for (reclaim_rec_t *r = __atomic_load_n(&reclaim_recs_, __ATOMIC_ACQUIRE); r; r = r->next) {
+        uint64_t t0 = hr_ticks();
+        for (long i = 0; i < r->n; i++) r->ents[i].fn(r->ents[i].p, r->ents[i].sz);
+        r->drained += r->n;
+        r->n = 0;
+        r->unflushed = 0;
+        r->unflushed_bytes = 0;
+        r->next_scan = RECLAIM_BATCH;
+        r->ticks += hr_ticks() - t0;
+    }
+    __atomic_store_n(&reclaim_pending_, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&reclaim_pending_bytes_, 0, __ATOMIC_RELAXED);
+}
+
+// Totals since the last reclaim_stats_reset(); call while the workers are quiet.
+static inline void reclaim_stats(reclaim_stats_t *s) {
+    uint64_t ticks = 0;
+    long pending = 0;
+    size_t pending_bytes = 0;
+    memset(s, 0, sizeof(*s));
+    for (reclaim_rec_t *r = __atomic_load_n(&reclaim_recs_, __ATOMIC_ACQUIRE); r; r = r->next) {
+        s->retired += r->retired;
+        s->freed += r->freed;
+        s->drained += r->drained;
+        s->scans += r->scans;
+        ticks += r->ticks;
+        pending += r->n;
+        for (long i = 0; i < r->n; i++) pending_bytes += r->ents[i].sz;
+    }
+    s->peak_nodes = __atomic_load_n(&reclaim_peak_, __ATOMIC_RELAXED);
+    s->peak_bytes = __atomic_load_n(&reclaim_peak_bytes_, __ATOMIC_RELAXED);
+    if (pending > s->peak_nodes) s->peak_nodes = pending;
+    if (pending_bytes > s->peak_bytes) s->peak_bytes = pending_bytes;
+    s->scan_ns = ticks * hr_ns_per_tick();
+}
+
+static inline void reclaim_stats_reset(void) {
+    for (reclaim_rec_t *r = __atomic_load_n(&reclaim_recs_, __ATOMIC_ACQUIRE); r; r = r->next)
+        r->retired = r->freed = r->drained = r->scans = r->ticks = 0;
+    __atomic_store_n(&reclaim_peak_, __atomic_load_n(&reclaim_pending_, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    __atomic_store_n(&reclaim_peak_bytes_, __atomic_load_n(&reclaim_pending_bytes_, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+}
+
+#endif // __reclaim_h__
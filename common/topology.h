@@ -0,0 +1,212 @@
+#ifndef __topology_h__
+#define __topology_h__
+
+// CPU topology discovery and thread placement for the benchmark programs.
+//
+// topo_load() reads /sys for every CPU this process may run on (so cgroup and
+// taskset limits are respected) and records its core, socket and NUMA node.
+// topo_order() then lists CPUs in the order threads should be placed:
+//
+//   PLACE_COMPACT  fill a core's hyperthreads, then the next core, socket by socket
+//   PLACE_SCATTER  one thread per socket in turn, distinct cores before siblings
+//   PLACE_NUMA     thread t gets a whole NUMA node (threads split into equal
+//                  blocks per node) and may float between that node's CPUs
+//
+// On non-Linux systems everything degrades to "one socket, no pinning".
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sched.h>
+
+#define TOPO_MAX_CPUS 1024
+
+enum { PLACE_NONE = 0, PLACE_COMPACT, PLACE_SCATTER, PLACE_NUMA };
+
+typedef struct {
+    int cpu, core, package, node;
+    int smt_rank;    // 0 for the first hyperthread of a core, 1 for the next, ...
+    int core_rank;   // index of this core within its package
+} topo_cpu_t;
+
+typedef struct {
+    int n, nnodes, npackages;
+    topo_cpu_t cpu[TOPO_MAX_CPUS];
+} topo_t;
+
+static inline int topo_parse_policy(const char *s) {
+    if (!strcmp(s, "none"))    return PLACE_NONE;
+    if (!strcmp(s, "compact")) return PLACE_COMPACT;
+    if (!strcmp(s, "scatter")) return PLACE_SCATTER;
+    if (!strcmp(s, "numa"))    return PLACE_NUMA;
+    return -1;
+}
+
+static inline const char *topo_policy_name(int p) {
+    static const char *names[] = { "none", "compact", "scatter", "numa" };
+    return (p >= 0 && p <= PLACE_NUMA) ? names[p] : "?";
+}
+
+static inline int topo_read_int_(const char *path, int dflt) {
+    FILE *f = fopen(path, "r");
+    int v = dflt;
+    if (f) {
+        if (fscanf(f, "%d", &v) != 1)
+            v = dflt;
+        fclose(f);
+    }
+    return v;
+}
+
+// Node of `cpu`, found by looking for /sys/devices/system/cpu/cpuN/nodeM.
+static inline int topo_node_of_(int cpu) {
+    char path[128];
+    for (int node = 0; node < 64; node++) {
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/node%d", cpu, node);
+        if (access(path, F_OK) == 0)
+            return node;
+    }
+    return 0;
+}
+
+static inline int topo_load(topo_t *t) {
+    memset(t, 0, sizeof(*t));
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return -1;
+    char path[128];
+    for (int c = 0; c < CPU_SETSIZE && t->n < TOPO_MAX_CPUS; c++) {
+        if (!CPU_ISSET(c, &allowed))
+            continue;
+        topo_cpu_t *e = &t->cpu[t->n++];
+        e->cpu = c;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_id", c);
+        e->core = topo_read_int_(path, c);
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", c);
+        e->package = topo_read_int_(path, 0);
+        e->node = topo_node_of_(c);
+    }
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int c = 0; c < n && c < TOPO_MAX_CPUS; c++) {
+        t->cpu[t->n++] = (topo_cpu_t){ .cpu = c, .core = c };
+    }
+#endif
+    // Ranks need the whole table: siblings share (package, core).
+    for (int i = 0; i < t->n; i++) {
+        topo_cpu_t *e = &t->cpu[i];
+        for (int j = 0; j < i; j++) {
+            topo_cpu_t *o = &t->cpu[j];
+            if (o->package == e->package && o->core == e->core)
+                e->smt_rank++;
+        }
+        if (e->smt_rank == 0) {
+            for (int j = 0; j < i; j++)
+                if (t->cpu[j].package == e->package && t->cpu[j].smt_rank == 0)
+                    e->core_rank++;
+        } else {
+            for (int j = 0; j < i; j++)
+                if (t->cpu[j].package == e->package && t->cpu[j].core == e->core)
+                    e->core_rank = t->cpu[j].core_rank;
+        }
+        if (e->node + 1 > t->nnodes) t->nnodes = e->node + 1;
+        if (e->package + 1 > t->npackages) t->npackages = e->package + 1;
+    }
+    return t->n;
+}
+
+static int topo_cmp_compact_(const void *a, const void *b) {
+    const topo_cpu_t *x = a, *y = b;
+    if (x->node != y->node) return x->node - y->node;
+    if (x->package != y->package) return x->package - y->package;
+    if (x->core_rank != y->core_rank) return x->core_rank - y->core_rank;
+    return x->smt_rank - y->smt_rank;
+}
+
+static int topo_cmp_scatter_(const void *a, const void *b) {
+    const topo_cpu_t *x = a, *y = b;
+    if (x->smt_rank != y->smt_rank) return x->smt_rank - y->smt_rank;
+    if (x->core_rank != y->core_rank) return x->core_rank - y->core_rank;
+    if (x->package != y->package) return x->package - y->package;
+    return x->node - y->node;
+}
+
+// Fills order[0..t->n) with CPU entries in placement order for `policy`
+// (PLACE_NUMA uses the compact order, i.e. grouped by node).
+static inline void topo_order(const topo_t *t, int policy, topo_cpu_t *order) {
+    memcpy(order, t->cpu, sizeof(topo_cpu_t) * t->n);
+    qsort(order, t->n, sizeof(topo_cpu_t),
+          policy == PLACE_SCATTER ? topo_cmp_scatter_ : topo_cmp_compact_);
+}
+
+// First CPU (in table order) matching a predicate relative to `cpu`; -1 if none.
+// Used to pick a hyperthread sibling or a CPU on another socket.
+static inline int topo_find_sibling(const topo_t *t, int cpu) {
+    const topo_cpu_t *me = NULL;
+    for (int i = 0; i < t->n; i++) if (t->cpu[i].cpu == cpu) me = &t->cpu[i];
+    if (!me) return -1;
+    for (int i = 0; i < t->n; i++) {
+        const topo_cpu_t *o = &t->cpu[i];
+        if (o->cpu != cpu && o->package == me->package && o->core == me->core) return o->cpu;
+    }
+    return -1;
+}
+
+// A CPU on a different physical core of the same package.
+static inline int topo_find_other_core(const topo_t *t, int cpu) {
+    const topo_cpu_t *me = NULL;
+    for (int i = 0; i < t->n; i++) if (t->cpu[i].cpu == cpu) me = &t->cpu[i];
+    if (!me) return -1;
+    for (int i = 0; i < t->n; i++) {
+        const topo_cpu_t *o = &t->cpu[i];
+        if (o->package == me->package && o->core != me->core) return o->cpu;
+    }
+    return -1;
+}
+
+static inline int topo_find_other_package(const topo_t *t, int cpu) {
+    const topo_cpu_t *me = NULL;
+    for (int i = 0; i < t->n; i++) if (t->cpu[i].cpu == cpu) me = &t->cpu[i];
+    if (!me) return -1;
+    for (int i = 0; i < t->n; i++)
+        if (t->cpu[i].package != me->package) return t->cpu[i].cpu;
+    return -1;
+}
+
+#ifdef __linux__
+// Sets `set` to the CPUs thread `tid` of `nthreads` should run on.
+static inline void topo_cpuset_for(const topo_t *t, const topo_cpu_t *order, int policy,
+                                   int tid, int nthreads, cpu_set_t *set) {
+    CPU_ZERO(set);
+    if (policy == PLACE_NUMA) {
+        int node = (int)((long)tid * t->nnodes / (nthreads > 0 ? nthreads : 1));
+        for (int i = 0; i < t->n; i++)
+            if (t->cpu[i].node == node) CPU_SET(t->cpu[i].cpu, set);
+        if (CPU_COUNT(set) == 0)            // node without CPUs in our cpuset
+            for (int i = 0; i < t->n; i++) CPU_SET(t->cpu[i].cpu, set);
+    } else {
+        CPU_SET(order[tid % t->n].cpu, set);
+    }
+}
+#endif
+
+static inline int topo_pin_self(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set);
+#else
+    (void)cpu;
+    return -1;
+#endif
+}
+
+#endif // __topology_h__
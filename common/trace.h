@@ -0,0 +1,180 @@
+#ifndef __trace_h__
+#define __trace_h__
+
+// Lock/barrier/semaphore event tracing, compiled in with -DTRACE.
+//
+//   trace_event(TR_LOCK_WAIT, l);      // timestamp + event + object address
+//
+// Without -DTRACE trace_event() is an empty macro and TRACE_ON is 0, so
+// instrumented code is the same as uninstrumented code.
+//
+// With it, each thread appends to its own ring of TRACE_RING_EVENTS 16-byte
+// events (default 64K, a power of two). A record is an unfenced cycle
+// counter read and two stores, with no atomics shared between threads: the
+// ring is created on a thread's first event and pushed onto a global list
+// with one CAS. When a ring wraps, the oldest events are overwritten and
+// counted as dropped.
+//
+// At exit the rings are written to $TRACE_FILE (default trace.json) in the
+// Chrome trace event format, which chrome://tracing and ui.perfetto.dev
+// open directly. Each thread is a track; paired events become slices:
+//
+//   wait     TR_LOCK_WAIT -> TR_LOCK_ACQUIRED    contended acquire
+//   hold     TR_LOCK_ACQUIRED -> TR_LOCK_RELEASED
+//   barrier  TR_BARRIER_ARRIVE -> TR_BARRIER_DEPART
+//   park     TR_PARK -> TR_WAKE                  asleep in the kernel
+//
+// with the object's address in args.obj. A one-line summary goes to stderr:
+//
+//   [trace] threads=8 events=... dropped=0 hold_us_avg=... wait_us_max=...
+//
+// TRACE_FILE= (empty) skips the file and prints only the summary.
+
+#include <stdint.h>
+
+enum { TR_LOCK_WAIT, TR_LOCK_ACQUIRED, TR_LOCK_RELEASED, TR_BARRIER_ARRIVE, TR_BARRIER_DEPART,
+       TR_PARK, TR_WAKE, TR_NTYPES };
+
+#ifndef TRACE
+
+#define TRACE_ON 0
+#define trace_event(type, obj) ((void) 0)
+
+#else
+
+#define TRACE_ON 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "hrtime.h"
+
+#ifndef TRACE_RING_EVENTS
+#define TRACE_RING_EVENTS (1 << 16)
+#endif
+#define TRACE_OPEN 16                 // slices one thread can have open at once
+
+typedef struct {
+    uint64_t ts : 56, type : 8;       // raw ticks; 2^56 is months of uptime
+    const void *obj;
+} trace_ev_t;
+
+typedef struct trace_ring {
+    struct trace_ring *next;
+    int tid;
+    uint64_t head;                    // events ever written; owner stores, dump loads
+    trace_ev_t ev[TRACE_RING_EVENTS];
+} trace_ring_t;
+
+static trace_ring_t *trace_rings_;
+static int trace_nthreads_;
+static __thread trace_ring_t *trace_ring_;
+
+static inline uint64_t trace_now_(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();    // no lfence: events only need order within a thread
+#else
+    return hr_ticks();
+#endif
+}
+
+static void trace_dump(void);
+
+static __attribute__((noinline)) trace_ring_t *trace_ring_new_(void) {
+    trace_ring_t *r = (trace_ring_t *) calloc(1, sizeof(trace_ring_t));
+    if (!r) { fprintf(stderr, "trace: out of memory\n"); abort(); }
+    r->tid = __atomic_fetch_add(&trace_nthreads_, 1, __ATOMIC_RELAXED);
+    if (r->tid == 0) atexit(trace_dump);
+    r->next = __atomic_load_n(&trace_rings_, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&trace_rings_, &r->next, r, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+    return trace_ring_ = r;
+}
+
+static inline void trace_event(int type, const void *obj) {
+    trace_ring_t *r = trace_ring_;
+    if (__builtin_expect(!r, 0)) r = trace_ring_new_();
+    uint64_t h = r->head;
+    trace_ev_t *e = &r->ev[h & (TRACE_RING_EVENTS - 1)];
+    e->ts = trace_now_();
+    e->type = type;
+    e->obj = obj;
+    __atomic_store_n(&r->head, h + 1, __ATOMIC_RELEASE);
+}
+
+// Walks rings still being written by live threads without stopping them, so
+// call it once they are done (atexit does, after main returns).
+static void trace_dump(void) {
+    static const char *slice[TR_NTYPES] = { "wait", "hold", "hold", "barrier", "barrier", "park", "park" };
+    static const int opener[TR_NTYPES] = { -1, TR_LOCK_WAIT, TR_LOCK_ACQUIRED, -1, TR_BARRIER_ARRIVE, -1, TR_PARK };
+    static int done;
+    if (__atomic_exchange_n(&done, 1, __ATOMIC_ACQ_REL)) return;
+
+    const char *path = getenv("TRACE_FILE");
+    if (!path) path = "trace.json";
+    FILE *f = *path ? fopen(path, "w") : NULL;
+    if (*path && !f) perror(path);
+
+    trace_ring_t *rings = __atomic_load_n(&trace_rings_, __ATOMIC_ACQUIRE);
+    uint64_t t0 = UINT64_MAX, events = 0, dropped = 0;
+    for (trace_ring_t *r = rings; r; r = r->next) {
+        uint64_t h = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        uint64_t first = h > TRACE_RING_EVENTS ? h - TRACE_RING_EVENTS : 0;
+        if (h > first && r->ev[first & (TRACE_RING_EVENTS - 1)].ts < t0) t0 = r->ev[first & (TRACE_RING_EVENTS - 1)].ts;
+        events += h - first;
+        dropped += first;
+    }
+    double us = hr_ns_per_tick() / 1000.0;
+    int pid = (int) getpid(), sep = 0;
+    double sum[TR_NTYPES] = { 0 }, max[TR_NTYPES] = { 0 };
+    long n[TR_NTYPES] = { 0 };
+    if (f) fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    for (trace_ring_t *r = rings; r; r = r->next) {
+        struct { const void *obj; int type; uint64_t ts; } open[TRACE_OPEN];
+        int nopen = 0;
+        uint64_t h = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        if (f) fprintf(f, "%s{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"thread %d\"}}",
+                       sep++ ? ",\n" : "", pid, r->tid, r->tid);
+        for (uint64_t i = h > TRACE_RING_EVENTS ? h - TRACE_RING_EVENTS : 0; i < h; i++) {
+            trace_ev_t *e = &r->ev[i & (TRACE_RING_EVENTS - 1)];
+            int type = e->type, k;
+            if (type >= TR_NTYPES) continue;
+            if (opener[type] >= 0) {
+                // Close the matching open slice, if it's still in the ring.
+                for (k = nopen - 1; k >= 0 && (open[k].obj != e->obj || open[k].type != opener[type]); k--)
+                    ;
+                if (k >= 0) {
+                    double ts = (open[k].ts - t0) * us, dur = (e->ts - open[k].ts) * us;
+                    sum[type] += dur; n[type]++;
+                    if (dur > max[type]) max[type] = dur;
+                    if (f) fprintf(f, ",\n{\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"name\":\"%s\",\"ts\":%.3f,\"dur\":%.3f,"
+                                   "\"args\":{\"obj\":\"%p\"}}", pid, r->tid, slice[type], ts, dur, e->obj);
+                    open[k] = open[--nopen];
+                }
+            }
+            if (type == TR_LOCK_WAIT || type == TR_LOCK_ACQUIRED || type == TR_BARRIER_ARRIVE || type == TR_PARK) {
+                if (nopen == TRACE_OPEN) memmove(open, open + 1, sizeof(open[0]) * --nopen);
+                open[nopen].obj = e->obj; open[nopen].type = type; open[nopen].ts = e->ts;
+                nopen++;
+            }
+        }
+    }
+    if (f) {
+        fprintf(f, "\n]}\n");
+        fclose(f);
+    }
+#define TR_AVG(t) (n[t] ? sum[t] / n[t] : 0)
+    fprintf(stderr, "[trace] threads=%d events=%llu dropped=%llu holds=%ld hold_us_avg=%.3f hold_us_max=%.3f"
+            " waits=%ld wait_us_avg=%.3f wait_us_max=%.3f parks=%ld park_us_avg=%.3f barrier_us_avg=%.3f file=%s\n",
+            trace_nthreads_, (unsigned long long) events, (unsigned long long) dropped,
+            n[TR_LOCK_RELEASED], TR_AVG(TR_LOCK_RELEASED), max[TR_LOCK_RELEASED],
+            n[TR_LOCK_ACQUIRED], TR_AVG(TR_LOCK_ACQUIRED), max[TR_LOCK_ACQUIRED],
+            n[TR_WAKE], TR_AVG(TR_WAKE), TR_AVG(TR_BARRIER_DEPART), f ? path : "-");
+#undef TR_AVG
+}
+
+#endif // TRACE
+
+#endif // __trace_h__
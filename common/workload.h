@@ -0,0 +1,155 @@
+#ifndef __workload_h__
+#define __workload_h__
+
+// Key/op workload generator: which keys the workers hit, and with which ops.
+//
+//   wl_t w;
+//   wl_init(&w);                       // uniform keys, mix 10:80:10
+//   wl_parse_dist(&w, "zipf:0.99");    // uniform | zipf[:theta] | hotspot[:frac:pct]
+//   wl_parse_mix(&w, "20:70:10");      // insert:lookup:delete percentages
+//   wl_prepare(&w, keys);              // key space [0, keys); O(keys) for zipf
+//   wl_op_t *ops = wl_stream(&w, tid, n);   // n ops for thread tid, malloc'd
+//
+// Distributions:
+//
+//   uniform   every key equally likely
+//   zipf      key of rank r has weight 1/r^theta (0 < theta < 1, default
+//             0.99 as in YCSB), sampled in O(1) with Gray et al.'s method.
+//             Ranks are scattered over the key space by a fixed bijection,
+//             so the hot keys are neither adjacent nor at the front of a
+//             sorted structure
+//   hotspot   pct of the ops (default 0.8) go to a hot set of frac of the
+//             keys (default 0.2); the rest are uniform over the others
+//
+// Streams are generated up front so no RNG runs inside a timed region. Each
+// thread's stream has its own fixed seed, so runs repeat exactly.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+enum { WL_UNIFORM, WL_ZIPF, WL_HOTSPOT, WL_NDISTS };
+static const char *wl_dist_names[WL_NDISTS] = { "uniform", "zipf", "hotspot" };
+enum { WL_INSERT, WL_LOOKUP, WL_DELETE, WL_NOPS };
+
+typedef struct { int key; int op; } wl_op_t;
+
+typedef struct {
+    int dist;
+    double theta;                   // zipf
+    double hot_frac, hot_pct;       // hotspot
+    int mix[WL_NOPS];               // percent per op, sums to 100
+    long keys;
+    double zetan, alpha, eta;       // zipf constants, from wl_prepare
+    uint64_t mult;                  // rank -> key bijection
+} wl_t;
+
+static inline void wl_init(wl_t *w) {
+    memset(w, 0, sizeof(*w));
+    w->dist = WL_UNIFORM;
+    w->theta = 0.99;
+    w->hot_frac = 0.2;
+    w->hot_pct = 0.8;
+    w->mix[WL_INSERT] = 10; w->mix[WL_LOOKUP] = 80; w->mix[WL_DELETE] = 10;
+}
+
+// Returns 0, or -1 if the spec is not understood.
+static inline int wl_parse_dist(wl_t *w, const char *s) {
+    const char *arg = strchr(s, ':');
+    size_t len = arg ? (size_t) (arg - s) : strlen(s);
+    int d;
+    for (d = 0; d < WL_NDISTS; d++)
+        if (strlen(wl_dist_names[d]) == len && !strncmp(s, wl_dist_names[d], len)) break;
+    if (d == WL_NDISTS) return -1;
+    w->dist = d;
+    if (!arg) return 0;
+    if (d == WL_ZIPF) {
+        w->theta = atof(arg + 1);
+        return w->theta > 0 && w->theta < 1 ? 0 : -1;
+    }
+    if (d == WL_HOTSPOT) {
+        if (sscanf(arg + 1, "%lf:%lf", &w->hot_frac, &w->hot_pct) != 2) return -1;
+        return w->hot_frac > 0 && w->hot_frac < 1 && w->hot_pct >= 0 && w->hot_pct <= 1 ? 0 : -1;
+    }
+    return -1;
+}
+
+static inline int wl_parse_mix(wl_t *w, const char *s) {
+    int m[WL_NOPS];
+    if (sscanf(s, "%d:%d:%d", &m[0], &m[1], &m[2]) != 3) return -1;
+    if (m[0] < 0 || m[1] < 0 || m[2] < 0 || m[0] + m[1] + m[2] != 100) return -1;
+    memcpy(w->mix, m, sizeof(m));
+    return 0;
+}
+
+static inline uint64_t wl_gcd_(uint64_t a, uint64_t b) { while (b) { uint64_t t = a % b; a = b; b = t; } return a; }
+
+static inline void wl_prepare(wl_t *w, long keys) {
+    w->keys = keys > 0 ? keys : 1;
+    uint64_t n = (uint64_t) w->keys;
+    w->mult = 2654435761ULL % n;
+    if (w->mult == 0) w->mult = 1;
+    while (wl_gcd_(w->mult, n) != 1) w->mult++;
+    if (w->dist == WL_ZIPF) {
+        double zetan = 0;
+        for (uint64_t i = 1; i <= n; i++) zetan += 1.0 / pow((double) i, w->theta);
+        double zeta2 = 1.0 + pow(0.5, w->theta);
+        w->zetan = zetan;
+        w->alpha = 1.0 / (1.0 - w->theta);
+        w->eta = (1.0 - pow(2.0 / n, 1.0 - w->theta)) / (1.0 - zeta2 / zetan);
+    }
+}
+
+static inline uint64_t wl_rand_(uint64_t *s) {   // splitmix64
+    uint64_t z = (*s += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+static inline double wl_unit_(uint64_t *s) { return (wl_rand_(s) >> 11) * (1.0 / 9007199254740992.0); }
+
+static inline long wl_key_(const wl_t *w, uint64_t *s) {
+    uint64_t n = (uint64_t) w->keys, r;
+    if (w->dist == WL_ZIPF) {
+        double u = wl_unit_(s), uz = u * w->zetan;
+        if (uz < 1.0) r = 0;
+        else if (uz < 1.0 + pow(0.5, w->theta)) r = 1;
+        else r = (uint64_t) (n * pow(w->eta * u - w->eta + 1.0, w->alpha));
+        if (r >= n) r = n - 1;
+        return (long) ((unsigned __int128) r * w->mult % n);
+    }
+    if (w->dist == WL_HOTSPOT) {
+        uint64_t hot = (uint64_t) (n * w->hot_frac);
+        if (hot == 0) hot = 1;
+        if (wl_unit_(s) < w->hot_pct || hot >= n) r = wl_rand_(s) % hot;
+        else r = hot + wl_rand_(s) % (n - hot);
+        return (long) ((unsigned __int128) r * w->mult % n);
+    }
+    return (long) (wl_rand_(s) % n);
+}
+
+static inline wl_op_t *wl_stream(const wl_t *w, int tid, long n) {
+    wl_op_t *ops = (wl_op_t *) malloc(sizeof(wl_op_t) * (n > 0 ? n : 1));
+    if (!ops) return NULL;
+    uint64_t s = 5600 + 0x100000001b3ULL * (uint64_t) (tid + 1);
+    for (long i = 0; i < n; i++) {
+        int p = (int) (wl_rand_(&s) % 100);
+        ops[i].op = p < w->mix[WL_INSERT] ? WL_INSERT : p < w->mix[WL_INSERT] + w->mix[WL_LOOKUP] ? WL_LOOKUP : WL_DELETE;
+        ops[i].key = (int) wl_key_(w, &s);
+    }
+    return ops;
+}
+
+// "dist=zipf:0.99 mix=10:80:10 keys=100000" for report lines.
+static inline const char *wl_describe(const wl_t *w, char *buf, size_t len) {
+    if (w->dist == WL_ZIPF) snprintf(buf, len, "dist=zipf:%.2f", w->theta);
+    else if (w->dist == WL_HOTSPOT) snprintf(buf, len, "dist=hotspot:%.2f:%.2f", w->hot_frac, w->hot_pct);
+    else snprintf(buf, len, "dist=uniform");
+    size_t k = strlen(buf);
+    snprintf(buf + k, len - k, " mix=%d:%d:%d keys=%ld", w->mix[0], w->mix[1], w->mix[2], w->keys);
+    return buf;
+}
+
+#endif // __workload_h__
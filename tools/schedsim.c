@@ -0,0 +1,1052 @@
+// schedsim.c
+// Native engine for the scheduling simulators: HW3exercise8/mlfq.py,
+// HW3exercise9/lottery.py and process-run.py, with the same flags and,
+// byte for byte, the same output.
+//
+// usage: schedsim mlfq|lottery|process-run [that script's flags]
+//                 [--seeds=A-B,C,...] [--par=N] [--out=pattern] [--summary]
+//
+//   (or symlink schedsim to mlfq, lottery or process-run and run that)
+//
+//   --seeds    run every listed seed instead of -s; ranges are inclusive
+//   --par      seeds run this many at a time, one thread each (default:
+//              online CPUs); outputs still come out in seed order
+//   --out      write each seed's output to its own file, {seed} in the
+//              pattern replaced by the seed, e.g. --out=out_R100_s{seed}.txt
+//   --summary  implies -c; print one "[<sim>] seed=... key=value ..." line
+//              per seed instead of the trace, tagged [mlfq], [lottery] or
+//              [process-run] (what tools/sweep reads)
+//
+// Python's random module is reproduced exactly (MT19937, seeded with
+// init_by_array from the 32-bit words of |seed|, random() built from two
+// draws the way genrand_res53 does), so a given seed generates the same
+// jobs and the same lottery draws as the scripts.
+//
+// A trace has one line per tick, so writing it costs what it costs. With
+// --summary nothing is printed per tick and time advances by events: mlfq
+// runs the chosen job straight to the next quantum end, I/O, completion,
+// arrival or boost, and process-run skips idle stretches and runs of CPU
+// instructions up to the next I/O completion. lottery makes one draw per
+// quantum either way, since every draw consumes random numbers.
+//
+// Build: gcc -O2 -pthread -o schedsim schedsim.c
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// ---------------------------------------------------------------------------
+// Python's random: MT19937 + random.seed(int) + random.random()
+
+typedef struct { uint32_t mt[624]; int mti; } pyrand_t;
+
+static void mt_init(pyrand_t *r, uint32_t s) {
+    r->mt[0] = s;
+    for (int i = 1; i < 624; i++)
+        r->mt[i] = 1812433253U * (r->mt[i - 1] ^ (r->mt[i - 1] >> 30)) + i;
+    r->mti = 624;
+}
+
+static void py_seed(pyrand_t *r, long long seed) {
+    unsigned long long n = seed < 0 ? -(unsigned long long) seed : (unsigned long long) seed;
+    uint32_t key[2] = { (uint32_t) n, (uint32_t) (n >> 32) };
+    int len = key[1] ? 2 : 1;
+    mt_init(r, 19650218U);
+    int i = 1, j = 0;
+    for (int k = 624 > len ? 624 : len; k; k--) {
+        r->mt[i] = (r->mt[i] ^ ((r->mt[i - 1] ^ (r->mt[i - 1] >> 30)) * 1664525U)) + key[j] + j;
+        i++; j++;
+        if (i >= 624) { r->mt[0] = r->mt[623]; i = 1; }
+        if (j >= len) j = 0;
+    }
+    for (int k = 623; k; k--) {
+        r->mt[i] = (r->mt[i] ^ ((r->mt[i - 1] ^ (r->mt[i - 1] >> 30)) * 1566083941U)) - i;
+        i++;
+        if (i >= 624) { r->mt[0] = r->mt[623]; i = 1; }
+    }
+    r->mt[0] = 0x80000000U;
+}
+
+static uint32_t mt_next(pyrand_t *r) {
+    uint32_t y;
+    if (r->mti >= 624) {
+        int k;
+        for (k = 0; k < 624; k++) {
+            y = (r->mt[k] & 0x80000000U) | (r->mt[(k + 1) % 624] & 0x7fffffffU);
+            r->mt[k] = r->mt[(k + 397) % 624] ^ (y >> 1) ^ (y & 1 ? 0x9908b0dfU : 0);
+        }
+        r->mti = 0;
+    }
+    y = r->mt[r->mti++];
+    y ^= y >> 11;
+    y ^= (y << 7) & 0x9d2c5680U;
+    y ^= (y << 15) & 0xefc60000U;
+    return y ^ (y >> 18);
+}
+
+static double py_random(pyrand_t *r) {
+    uint32_t a = mt_next(r) >> 5, b = mt_next(r) >> 6;
+    return (a * 67108864.0 + b) * (1.0 / 9007199254740992.0);
+}
+
+// ---------------------------------------------------------------------------
+// optparse-style flags: -xV, -x V, --long=V, --long V, unique prefixes of
+// long names, and clustered booleans (-cp).
+
+enum { OPT_INT, OPT_STR, OPT_BOOL };
+typedef struct { char s; const char *l; int type; void *dst; } opt_t;
+
+#define MAX_OPTS 24
+
+static const char *prog;
+
+static void opt_usage(const opt_t *t, int n) {
+    fprintf(stderr, "usage: %s [options]\n\noptions:\n", prog);
+    for (int i = 0; i < n; i++) {
+        char s[4] = "";
+        if (t[i].s) snprintf(s, sizeof(s), "-%c,", t[i].s);
+        fprintf(stderr, "  %-4s --%s%s\n", s, t[i].l, t[i].type == OPT_BOOL ? "" : "=VALUE");
+    }
+}
+
+static void opt_fail(const opt_t *t, int n, const char *msg, const char *what) {
+    opt_usage(t, n);
+    fprintf(stderr, "\n%s: error: %s%s\n", prog, msg, what);
+    exit(2);
+}
+
+static void opt_set(const opt_t *t, int n, const opt_t *o, const char *v) {
+    if (o->type == OPT_BOOL) { *(int *) o->dst = 1; return; }
+    if (o->type == OPT_STR) { *(const char **) o->dst = v; return; }
+    char *end;
+    long long x = strtoll(v, &end, 0);
+    if (!*v || *end) opt_fail(t, n, "invalid integer value: ", v);
+    *(long long *) o->dst = x;
+}
+
+static void opt_parse(const opt_t *t, int n, int argc, char **argv) {
+    for (int i = 0; i < argc; i++) {
+        const char *a = argv[i];
+        if (!strcmp(a, "-h") || !strcmp(a, "--help")) { opt_usage(t, n); exit(0); }
+        if (!strcmp(a, "--")) break;
+        if (a[0] == '-' && a[1] == '-') {
+            const char *eq = strchr(a + 2, '=');
+            size_t len = eq ? (size_t) (eq - a - 2) : strlen(a + 2);
+            const opt_t *o = NULL;
+            int hits = 0;
+            for (int k = 0; k < n; k++) {
+                if (strncmp(t[k].l, a + 2, len)) continue;
+                if (strlen(t[k].l) == len) { o = &t[k]; hits = 1; break; }
+                o = &t[k]; hits++;
+            }
+            if (hits != 1) opt_fail(t, n, hits ? "ambiguous option: " : "no such option: ", a);
+            if (o->type == OPT_BOOL) {
+                if (eq) opt_fail(t, n, "option takes no value: ", a);
+                opt_set(t, n, o, NULL);
+            } else if (eq) {
+                opt_set(t, n, o, eq + 1);
+            } else {
+                if (i + 1 >= argc) opt_fail(t, n, "option requires an argument: ", a);
+                opt_set(t, n, o, argv[++i]);
+            }
+        } else if (a[0] == '-' && a[1]) {
+            for (const char *p = a + 1; *p; p++) {
+                const opt_t *o = NULL;
+                for (int k = 0; k < n && !o; k++)
+                    if (t[k].s == *p) o = &t[k];
+                if (!o) { char bad[3] = { '-', *p, 0 }; opt_fail(t, n, "no such option: ", bad); }
+                if (o->type == OPT_BOOL) { opt_set(t, n, o, NULL); continue; }
+                if (p[1]) opt_set(t, n, o, p + 1);
+                else if (i + 1 < argc) opt_set(t, n, o, argv[++i]);
+                else { char bad[3] = { '-', *p, 0 }; opt_fail(t, n, "option requires an argument: ", bad); }
+                break;
+            }
+        }
+        // positional arguments are ignored, as the scripts ignore them
+    }
+}
+
+// Flags every simulator shares.
+typedef struct {
+    long long seed;
+    int solve, summary;
+    const char *seeds, *out;
+    long long par;
+} common_t;
+
+static int add_common(opt_t *t, int n, common_t *c) {
+    t[n++] = (opt_t) { 0, "seeds", OPT_STR, &c->seeds };
+    t[n++] = (opt_t) { 0, "par", OPT_INT, &c->par };
+    t[n++] = (opt_t) { 0, "out", OPT_STR, &c->out };
+    t[n++] = (opt_t) { 0, "summary", OPT_BOOL, &c->summary };
+    return n;
+}
+
+static const char *py_bool(int b) { return b ? "True" : "False"; }
+
+// ---------------------------------------------------------------------------
+// mlfq.py
+
+typedef struct {
+    common_t c;
+    long long num_queues, quantum, allotment, num_jobs, maxlen, maxio, boost, io_time;
+    int stay, iobump;
+    const char *quantum_list, *allotment_list, *jlist;
+} mlfq_opt_t;
+
+typedef struct {
+    long pri, ticks, allot, start, run, left, io_freq, first, end;
+    int doing_io;
+} mjob_t;
+
+typedef struct { long time, seq; int job; const char *what; } mev_t;
+
+// Pending JOB BEGINS / IO_DONE events, ordered by time and then by the
+// order they were added (mlfq.py keeps a list per time and appends).
+typedef struct { mev_t *h; int n, cap; long seq; } mheap_t;
+
+static int mev_before(const mev_t *a, const mev_t *b) {
+    return a->time < b->time || (a->time == b->time && a->seq < b->seq);
+}
+static void mheap_push(mheap_t *q, long time, int job, const char *what) {
+    if (q->n == q->cap) {
+        q->cap = q->cap ? 2 * q->cap : 16;
+        q->h = realloc(q->h, sizeof(mev_t) * q->cap);
+        if (!q->h) { perror("realloc"); exit(1); }
+    }
+    int i = q->n++;
+    mev_t e = { time, q->seq++, job, what };
+    for (; i > 0 && mev_before(&e, &q->h[(i - 1) / 2]); i = (i - 1) / 2) q->h[i] = q->h[(i - 1) / 2];
+    q->h[i] = e;
+}
+static mev_t mheap_pop(mheap_t *q) {
+    mev_t top = q->h[0], last = q->h[--q->n];
+    int i = 0;
+    for (;;) {
+        int c = 2 * i + 1;
+        if (c >= q->n) break;
+        if (c + 1 < q->n && mev_before(&q->h[c + 1], &q->h[c])) c++;
+        if (!mev_before(&q->h[c], &last)) break;
+        q->h[i] = q->h[c];
+        i = c;
+    }
+    if (q->n) q->h[i] = last;
+    return top;
+}
+
+// One run queue: a ring of job ids, since jobs are taken from the front and
+// I/O-bumped jobs go back in at the front.
+typedef struct { int *a; int head, n, cap; } ring_t;
+static void ring_push(ring_t *r, int j) { r->a[(r->head + r->n++) % r->cap] = j; }
+static void ring_push_front(ring_t *r, int j) { r->head = (r->head + r->cap - 1) % r->cap; r->a[r->head] = j; r->n++; }
+static int ring_at(const ring_t *r, int i) { return r->a[(r->head + i) % r->cap]; }
+static int ring_pop(ring_t *r) { int j = r->a[r->head]; r->head = (r->head + 1) % r->cap; r->n--; return j; }
+
+static int parse_list(const char *s, long *out, int max) {
+    int n = 0;
+    for (const char *p = s; n < max; p++) {
+        out[n++] = strtol(p, (char **) &p, 10);
+        if (*p != ',') break;
+    }
+    return n;
+}
+
+#define MLFQ_MAX_QUEUES 64
+
+static int run_mlfq(const void *opt, long long seed, FILE *out) {
+    const mlfq_opt_t *o = (const mlfq_opt_t *) opt;
+    pyrand_t rng;
+    long quantum[MLFQ_MAX_QUEUES], allotment[MLFQ_MAX_QUEUES], tmp[MLFQ_MAX_QUEUES];
+    int nq = (int) o->num_queues;
+    py_seed(&rng, seed);
+
+    if (*o->quantum_list) {
+        nq = parse_list(o->quantum_list, tmp, MLFQ_MAX_QUEUES);
+        for (int i = 0; i < nq; i++) quantum[nq - 1 - i] = tmp[i];
+    } else {
+        if (nq < 1 || nq > MLFQ_MAX_QUEUES) { fprintf(stderr, "mlfq: need 1..%d queues\n", MLFQ_MAX_QUEUES); return 1; }
+        for (int i = 0; i < nq; i++) quantum[i] = o->quantum;
+    }
+    if (*o->allotment_list) {
+        if (parse_list(o->allotment_list, tmp, MLFQ_MAX_QUEUES) != nq) {
+            fprintf(out, "number of allotments specified must match number of quantums\n");
+            return 1;
+        }
+        for (int i = 0; i < nq; i++) {
+            allotment[nq - 1 - i] = tmp[i];
+            if (nq - 1 - i != 0 && tmp[i] <= 0) { fprintf(out, "allotment must be positive integer\n"); return 1; }
+        }
+    } else {
+        for (int i = 0; i < nq; i++) allotment[i] = o->allotment;
+    }
+    int hi = nq - 1;
+
+    // Jobs: from the list, or random ones (the same two draws per job as
+    // mlfq.py, in the same order).
+    int nj = 0, cap = 0;
+    mjob_t *job = NULL;
+    mheap_t ev = { 0 };
+    if (*o->jlist) {
+        for (const char *p = o->jlist; ; p++) {
+            long v[3];
+            int used = -1;
+            size_t len = strcspn(p, ":");
+            if (sscanf(p, "%ld ,%ld ,%ld %n", &v[0], &v[1], &v[2], &used) != 3 || (size_t) used != len) {
+                fprintf(out, "Badly formatted job string. Should be x1,y1,z1:x2,y2,z2:...\n"
+                        "where x is the startTime, y is the runTime, and z is the I/O frequency.\n");
+                free(job);
+                free(ev.h);
+                return 1;
+            }
+            if (nj == cap) job = realloc(job, sizeof(mjob_t) * (cap = cap ? 2 * cap : 8));
+            job[nj] = (mjob_t) { hi, quantum[hi], allotment[hi], v[0], v[1], v[1], v[2], -1, 0, 0 };
+            mheap_push(&ev, v[0], nj, "JOB BEGINS");
+            nj++;
+            p += len;
+            if (!*p) break;
+        }
+    } else {
+        nj = (int) o->num_jobs;
+        job = malloc(sizeof(mjob_t) * (nj > 0 ? nj : 1));
+        for (int j = 0; j < nj; j++) {
+            long run = (long) (py_random(&rng) * (o->maxlen - 1) + 1);
+            long io = (long) (py_random(&rng) * (o->maxio - 1) + 1);
+            job[j] = (mjob_t) { hi, quantum[hi], allotment[hi], 0, run, run, io, -1, 0, 0 };
+            mheap_push(&ev, 0, j, "JOB BEGINS");
+        }
+    }
+    if (nj <= 0) { fprintf(stderr, "mlfq: no jobs\n"); free(job); free(ev.h); return 1; }
+
+    int quiet = o->c.summary, rc = 0;
+    if (!quiet) {
+        fprintf(out, "Here is the list of inputs:\n");
+        fprintf(out, "OPTIONS jobs %d\nOPTIONS queues %d\n", nj, nq);
+        for (int i = nq - 1; i >= 0; i--) {
+            fprintf(out, "OPTIONS allotments for queue %2d is %3ld\n", i, allotment[i]);
+            fprintf(out, "OPTIONS quantum length for queue %2d is %3ld\n", i, quantum[i]);
+        }
+        fprintf(out, "OPTIONS boost %lld\nOPTIONS ioTime %lld\nOPTIONS stayAfterIO %s\nOPTIONS iobump %s\n",
+                o->boost, o->io_time, py_bool(o->stay), py_bool(o->iobump));
+        fprintf(out, "\n\n");
+        fprintf(out, "For each job, three defining characteristics are given:\n"
+                "  startTime : at what time does the job enter the system\n"
+                "  runTime   : the total CPU time needed by the job to finish\n"
+                "  ioFreq    : every ioFreq time units, the job issues an I/O\n"
+                "              (the I/O takes ioTime units to complete)\n\n");
+        fprintf(out, "Job List:\n");
+        for (int j = 0; j < nj; j++)
+            fprintf(out, "  Job %2d: startTime %3ld - runTime %3ld - ioFreq %3ld\n", j, job[j].start, job[j].run, job[j].io_freq);
+        fprintf(out, "\n");
+        if (!o->c.solve) {
+            fprintf(out, "Compute the execution trace for the given workloads.\n"
+                    "If you would like, also compute the response and turnaround\n"
+                    "times for each of the jobs.\n\n"
+                    "Use the -c flag to get the exact results when you are finished.\n\n");
+            goto done;
+        }
+        fprintf(out, "\nExecution Trace:\n\n");
+    }
+
+    ring_t queue[MLFQ_MAX_QUEUES];
+    for (int q = 0; q < nq; q++) queue[q] = (ring_t) { malloc(sizeof(int) * nj), 0, 0, nj };
+    long now = 0, boost = o->boost, io_time = o->io_time;
+    int finished = 0;
+    while (finished < nj) {
+        if (boost > 0 && now != 0 && now % boost == 0) {
+            if (!quiet) fprintf(out, "[ time %ld ] BOOST ( every %ld )\n", now, boost);
+            for (int q = 0; q < hi; q++) {
+                while (queue[q].n) {
+                    int j = ring_pop(&queue[q]);
+                    if (!job[j].doing_io) ring_push(&queue[hi], j);
+                }
+            }
+            for (int j = 0; j < nj; j++)
+                if (job[j].left > 0) { job[j].pri = hi; job[j].ticks = quantum[hi]; job[j].allot = allotment[hi]; }
+        }
+        // Events for earlier times can only come from -i 0 or less; mlfq.py
+        // never looks at them again, so neither do we.
+        while (ev.n && ev.h[0].time <= now) {
+            mev_t e = mheap_pop(&ev);
+            if (e.time < now) continue;
+            int j = e.job;
+            job[j].doing_io = 0;
+            if (!quiet) fprintf(out, "[ time %ld ] %s by JOB %d\n", now, e.what, j);
+            if (!o->iobump || e.what[0] == 'J') ring_push(&queue[job[j].pri], j);
+            else ring_push_front(&queue[job[j].pri], j);
+        }
+
+        int cq = hi;
+        while (cq >= 0 && !queue[cq].n) cq--;
+        long next = ev.n ? ev.h[0].time : -1;
+        if (boost > 0) {
+            long nb = (now / boost + 1) * boost;
+            if (next < 0 || nb < next) next = nb;
+        }
+        if (cq < 0) {
+            if (next < 0) { fprintf(stderr, "mlfq: no runnable job and nothing pending at time %ld\n", now); rc = 1; break; }
+            if (!quiet) fprintf(out, "[ time %ld ] IDLE\n", now);
+            now = quiet ? next : now + 1;
+            continue;
+        }
+
+        int cj = ring_at(&queue[cq], 0);
+        mjob_t *J = &job[cj];
+        if (J->pri != cq) { fprintf(stderr, "currPri[%ld] does not match currQueue[%d]\n", J->pri, cq); rc = 1; break; }
+        if (J->first == -1) J->first = now;
+        if (quiet) {
+            // Nothing can interrupt the job before the first of these, so
+            // run all but the last tick at once; the last goes through the
+            // normal path below.
+            long k = J->left < J->ticks ? J->left : J->ticks;
+            if (J->io_freq > 0) {
+                long to_io = J->io_freq - (J->run - J->left) % J->io_freq;
+                if (to_io < k) k = to_io;
+            }
+            if (next >= 0 && next - now < k) k = next - now;
+            if (k > 1) { J->left -= k - 1; J->ticks -= k - 1; now += k - 1; }
+        }
+        J->left--;
+        J->ticks--;
+        if (!quiet)
+            fprintf(out, "[ time %ld ] Run JOB %d at PRIORITY %d [ TICKS %ld ALLOT %ld TIME %ld (of %ld) ]\n",
+                    now, cj, cq, J->ticks, J->allot, J->left, J->run);
+        if (J->left < 0) { fprintf(stderr, "Error: should never have less than 0 time left to run\n"); rc = 1; break; }
+        now++;
+
+        if (J->left == 0) {
+            if (!quiet) fprintf(out, "[ time %ld ] FINISHED JOB %d\n", now, cj);
+            finished++;
+            J->end = now;
+            ring_pop(&queue[cq]);
+            continue;
+        }
+        // mlfq.py tests the quantum with the ticks left before -S resets them
+        long ticks_left = J->ticks;
+        int issued_io = 0;
+        if (J->io_freq > 0 && (J->run - J->left) % J->io_freq == 0) {
+            if (!quiet) fprintf(out, "[ time %ld ] IO_START by JOB %d\n", now, cj);
+            issued_io = 1;
+            ring_pop(&queue[cq]);
+            J->doing_io = 1;
+            if (o->stay) { J->ticks = quantum[cq]; J->allot = allotment[cq]; }
+            if (!quiet) fprintf(out, "IO DONE\n");
+            mheap_push(&ev, now + io_time, cj, "IO_DONE");
+        }
+        if (ticks_left == 0) {
+            if (!issued_io) ring_pop(&queue[cq]);
+            if (--J->allot == 0) {
+                int nqx = cq > 0 ? cq - 1 : cq;
+                J->pri = nqx; J->ticks = quantum[nqx]; J->allot = allotment[nqx];
+                if (!issued_io) ring_push(&queue[nqx], cj);
+            } else {
+                J->ticks = quantum[cq];
+                if (!issued_io) ring_push(&queue[cq], cj);
+            }
+        }
+    }
+
+    if (rc == 0) {
+        double rs = 0, ts = 0, cs = 0;
+        if (!quiet) fprintf(out, "\nFinal statistics:\n");
+        for (int j = 0; j < nj; j++) {
+            long resp = job[j].first - job[j].start, turn = job[j].end - job[j].start;
+            double cpu = turn > 0 ? (double) job[j].run / turn * 100 : 0;
+            if (!quiet)
+                fprintf(out, "  Job %2d: startTime %3ld - response %3ld - turnaround %3ld - CPU %.2f%%\n",
+                        j, job[j].start, resp, turn, cpu);
+            rs += resp; ts += turn; cs += cpu;
+        }
+        if (!quiet)
+            fprintf(out, "\n  Avg %2d: startTime n/a - response %.2f - turnaround %.2f - CPU %.2f%%\n\n\n",
+                    nj - 1, rs / nj, ts / nj, cs / nj);
+        else
+            fprintf(out, "[mlfq] seed=%lld jobs=%d queues=%d end_time=%ld avg_response=%.2f avg_turnaround=%.2f avg_cpu_pct=%.2f\n",
+                    seed, nj, nq, now, rs / nj, ts / nj, cs / nj);
+    }
+    for (int q = 0; q < nq; q++) free(queue[q].a);
+done:
+    free(job);
+    free(ev.h);
+    return rc;
+}
+
+// ---------------------------------------------------------------------------
+// lottery.py
+
+typedef struct {
+    common_t c;
+    long long jobs, maxlen, maxticket, quantum;
+    const char *jlist;
+} lottery_opt_t;
+
+static int run_lottery(const void *opt, long long seed, FILE *out) {
+    const lottery_opt_t *o = (const lottery_opt_t *) opt;
+    pyrand_t rng;
+    py_seed(&rng, seed);
+    int quiet = o->c.summary;
+    if (!quiet)
+        fprintf(out, "ARG jlist %s\nARG jobs %lld\nARG maxlen %lld\nARG maxticket %lld\nARG quantum %lld\nARG seed %lld\n\n"
+                "Here is the job list, with the run time of each job: \n",
+                o->jlist, o->jobs, o->maxlen, o->maxticket, o->quantum, seed);
+
+    int nj = 0, cap = 0;
+    long (*jl)[2] = NULL;                   // [runtime, tickets]
+    long run_total = 0, tick_total = 0;
+    if (!*o->jlist) {
+        if (o->maxlen < 2 || o->maxticket < 2) { fprintf(stderr, "lottery: maxlen and maxticket must be >= 2\n"); return 1; }
+        nj = (int) o->jobs;
+        jl = malloc(sizeof(*jl) * (nj > 0 ? nj : 1));
+        for (int j = 0; j < nj; j++) {
+            long rt = 0, tix = 0;
+            while (rt == 0) rt = (long) (o->maxlen * py_random(&rng));
+            while (tix == 0) tix = (long) (o->maxticket * py_random(&rng));
+            jl[j][0] = rt; jl[j][1] = tix;
+            run_total += rt; tick_total += tix;
+            if (!quiet) fprintf(out, "  Job %d ( length = %ld, tickets = %ld )\n", j, rt, tix);
+        }
+    } else {
+        for (const char *p = o->jlist; ; p++) {
+            char *e;
+            long rt = strtol(p, &e, 10);
+            if (e == p || *e != ':') { fprintf(stderr, "lottery: bad job list entry at '%s'\n", p); free(jl); return 1; }
+            p = e + 1;
+            long tix = strtol(p, &e, 10);
+            if (e == p || (*e && *e != ',')) { fprintf(stderr, "lottery: bad job list entry at '%s'\n", p); free(jl); return 1; }
+            if (nj == cap) jl = realloc(jl, sizeof(*jl) * (cap = cap ? 2 * cap : 8));
+            jl[nj][0] = rt; jl[nj][1] = tix;
+            nj++;
+            run_total += rt; tick_total += tix;
+            p = e;
+            if (!*p) break;
+        }
+        if (!quiet)
+            for (int j = 0; j < nj; j++) fprintf(out, "  Job %d ( length = %ld, tickets = %ld )\n", j, jl[j][0], jl[j][1]);
+    }
+    if (!quiet) fprintf(out, "\n\n");
+
+    if (!o->c.solve && !quiet) {
+        fprintf(out, "Here is the set of random numbers you will need (at most):\n");
+        for (long i = 0; i < run_total; i++) fprintf(out, "Random %ld\n", (long) (py_random(&rng) * 1000001));
+        free(jl);
+        return 0;
+    }
+
+    if (!quiet) fprintf(out, "** Solutions **\n\n");
+    int jobs = nj, w = -1;
+    long clock = 0, first_done = -1, last_done = -1;
+    for (long i = 0; i < run_total; i++) {
+        long r = (long) (py_random(&rng) * 1000001);
+        if (tick_total <= 0) { fprintf(stderr, "lottery: no tickets left (ZeroDivisionError in lottery.py)\n"); free(jl); return 1; }
+        long winner = r % tick_total, cur = 0;
+        for (int j = 0; j < nj; j++) {
+            cur += jl[j][1];
+            if (cur > winner) { w = j; break; }
+        }
+        if (w < 0) { fprintf(stderr, "lottery: no winner for ticket %ld\n", winner); free(jl); return 1; }
+        if (!quiet) {
+            fprintf(out, "Random %ld -> Winning ticket %ld (of %ld) -> Run %d\n  Jobs:\n", r, winner, tick_total, w);
+            for (int j = 0; j < nj; j++) {
+                if (jl[j][0] > 0)
+                    fprintf(out, " (%s job:%d timeleft:%ld tix:%ld ) ", j == w ? "*" : " ", j, jl[j][0], jl[j][1]);
+                else
+                    fprintf(out, " (%s job:%d timeleft:%ld tix:--- ) ", j == w ? "*" : " ", j, jl[j][0]);
+            }
+            fprintf(out, "\n");
+        }
+        jl[w][0] = jl[w][0] >= o->quantum ? jl[w][0] - o->quantum : 0;
+        clock += o->quantum;
+        if (jl[w][0] == 0) {
+            if (!quiet) fprintf(out, "--> JOB %d DONE at time %ld\n", w, clock);
+            if (first_done < 0) first_done = clock;
+            last_done = clock;
+            tick_total -= jl[w][1];
+            jl[w][1] = 0;
+            jobs--;
+        }
+        if (jobs == 0) {
+            if (!quiet) fprintf(out, "\n");
+            break;
+        }
+    }
+    // fairness as in plot_fairness.py: first completion over last
+    if (quiet)
+        fprintf(out, "[lottery] seed=%lld jobs=%d quantum=%lld end_time=%ld first_done=%ld last_done=%ld fairness=%.4f\n",
+                seed, nj, o->quantum, clock, first_done, last_done,
+                last_done > 0 ? (double) first_done / last_done : 0.0);
+    free(jl);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// process-run.py
+
+typedef struct {
+    common_t c;
+    const char *program, *process_list, *switch_on, *io_done;
+    long long io_length, interrupt_overhead;
+    int print_stats;
+} prun_opt_t;
+
+enum { ST_RUNNING, ST_READY, ST_DONE, ST_WAIT };
+static const char *st_names[] = { "RUNNING", "READY", "DONE", "WAITING" };
+enum { DO_COMPUTE, DO_IO, DO_PROGRAMMED_IO };
+static const char *do_names[] = { "cpu", "io", "p_io" };
+
+typedef struct {
+    char *code;                 // DO_* per instruction
+    int *cpu_run;               // cpu_run[i]: instructions from i up to the next io
+    long n, pc, cap;
+    int state;
+    long io_done;               // tick the outstanding I/O completes, 0 if none
+} proc_t;
+
+typedef struct {
+    proc_t *p;
+    int np, cap, curr, active;
+    int switch_on_end, run_immediate;
+    long io_length;
+} prun_t;
+
+static void pr_emit(proc_t *p, int op) {
+    if (p->n == p->cap) {
+        p->cap = p->cap ? 2 * p->cap : 16;
+        p->code = realloc(p->code, p->cap);
+        if (!p->code) { perror("realloc"); exit(1); }
+    }
+    p->code[p->n++] = (char) op;
+}
+
+static proc_t *pr_new(prun_t *s) {
+    if (s->np == s->cap) s->p = realloc(s->p, sizeof(proc_t) * (s->cap = s->cap ? 2 * s->cap : 8));
+    proc_t *p = &s->p[s->np++];
+    memset(p, 0, sizeof(*p));
+    p->state = ST_READY;
+    s->active++;
+    return p;
+}
+
+// The scripts assert on every state change; a failed one is a bug in the
+// simulated policy, so stop there, as the traceback would.
+#define PR_MOVE(s, pid, from, to) do {                                          \
+        if ((s)->p[pid].state != (from)) {                                      \
+            fprintf(stderr, "process-run: pid %d is %s, expected %s\n",         \
+                    pid, st_names[(s)->p[pid].state], st_names[from]);          \
+            return -1;                                                          \
+        }                                                                       \
+        (s)->p[pid].state = (to);                                               \
+        if ((to) == ST_DONE) (s)->active--;                                     \
+    } while (0)
+
+static int pr_next(prun_t *s, int pid) {
+    if (pid != -1) {
+        s->curr = pid;
+        PR_MOVE(s, pid, ST_READY, ST_RUNNING);
+        return 0;
+    }
+    for (int k = 1; k <= s->np; k++) {
+        int q = (s->curr + k) % s->np;
+        if (s->p[q].state == ST_READY) {
+            s->curr = q;
+            PR_MOVE(s, q, ST_READY, ST_RUNNING);
+            return 0;
+        }
+    }
+    return 0;
+}
+
+static int pr_runnable(const prun_t *s) {
+    int n = 0;
+    for (int q = 0; q < s->np; q++) n += s->p[q].state == ST_READY || s->p[q].state == ST_RUNNING;
+    return n;
+}
+
+static int pr_check_done(prun_t *s) {
+    proc_t *c = &s->p[s->curr];
+    if (c->pc == c->n && c->state == ST_RUNNING) {
+        PR_MOVE(s, s->curr, ST_RUNNING, ST_DONE);
+        return pr_next(s, -1);
+    }
+    return 0;
+}
+
+// Returns 0, or -1 after a failed state check.
+static int pr_run(prun_t *s, FILE *out, int quiet, long *cpu_busy_out, long *io_busy_out, long *clock_out) {
+    long clock = 0, cpu_busy = 0, io_busy = 0;
+    for (int q = 0; q < s->np; q++) {
+        proc_t *p = &s->p[q];
+        p->cpu_run = malloc(sizeof(int) * (p->n + 1));
+        p->cpu_run[p->n] = 0;
+        for (long i = p->n - 1; i >= 0; i--) p->cpu_run[i] = p->code[i] == DO_IO ? 0 : p->cpu_run[i + 1] + 1;
+    }
+    s->curr = 0;
+    PR_MOVE(s, 0, ST_READY, ST_RUNNING);
+    if (!quiet) {
+        fprintf(out, "Time");
+        for (int q = 0; q < s->np; q++) {
+            char h[16];
+            snprintf(h, sizeof(h), "PID:%2d", q);
+            fprintf(out, "%10s", h);
+        }
+        fprintf(out, "%10s%10s\n", "CPU", "IOs");
+    }
+
+    while (s->active > 0) {
+        long next_io = 0;
+        for (int q = 0; q < s->np; q++)
+            if (s->p[q].io_done > clock && (!next_io || s->p[q].io_done < next_io)) next_io = s->p[q].io_done;
+        proc_t *c = &s->p[s->curr];
+        if (c->state != ST_RUNNING && !next_io) {
+            fprintf(stderr, "process-run: no process can run and no I/O is pending at tick %ld\n", clock);
+            return -1;
+        }
+        if (quiet) {
+            // Ticks before the next I/O completion change nothing but the
+            // current process's pc: skip all of them but the last, which
+            // may end the process or issue an I/O.
+            long k = 0;
+            if (c->state == ST_RUNNING && c->pc < c->n) k = c->cpu_run[c->pc] - 1;
+            else if (c->state != ST_RUNNING) k = next_io - clock - 1;
+            if (next_io && k > next_io - clock - 1) k = next_io - clock - 1;
+            if (k > 0) {
+                if (c->state == ST_RUNNING) { c->pc += k; cpu_busy += k; }
+                if (next_io) io_busy += k;
+                clock += k;
+            }
+        }
+        clock++;
+
+        int io_done = 0;
+        for (int q = 0; q < s->np; q++) {
+            if (s->p[q].io_done != clock) continue;
+            io_done = 1;
+            PR_MOVE(s, q, ST_WAIT, ST_READY);
+            if (s->run_immediate) {
+                if (s->curr != q && s->p[s->curr].state == ST_RUNNING) PR_MOVE(s, s->curr, ST_RUNNING, ST_READY);
+                if (pr_next(s, q)) return -1;
+            } else {
+                if (s->switch_on_end && pr_runnable(s) > 1 && pr_next(s, q)) return -1;
+                if (pr_runnable(s) == 1 && pr_next(s, q)) return -1;
+            }
+            if (pr_check_done(s)) return -1;
+        }
+
+        c = &s->p[s->curr];
+        int ins = -1;
+        if (c->state == ST_RUNNING && c->pc < c->n) {
+            ins = c->code[c->pc++];
+            cpu_busy++;
+        }
+        int in_flight = 0;
+        for (int q = 0; q < s->np; q++) in_flight += s->p[q].io_done > clock;
+        if (in_flight) io_busy++;
+        if (!quiet) {
+            fprintf(out, io_done ? "%3ld*" : "%3ld ", clock);
+            for (int q = 0; q < s->np; q++) {
+                if (q == s->curr && ins >= 0) {
+                    char r[16];
+                    snprintf(r, sizeof(r), "RUN:%s", do_names[ins]);
+                    fprintf(out, "%10s", r);
+                } else {
+                    fprintf(out, "%10s", st_names[s->p[q].state]);
+                }
+            }
+            if (ins < 0) fprintf(out, "%10s", " ");
+            else fprintf(out, "%10d", 1);
+            if (in_flight) fprintf(out, "%10d\n", in_flight);
+            else fprintf(out, "%10s\n", " ");
+        }
+
+        if (ins == DO_IO) {
+            PR_MOVE(s, s->curr, ST_RUNNING, ST_WAIT);
+            c->io_done = clock + s->io_length;
+            if (!s->switch_on_end && pr_next(s, -1)) return -1;
+        }
+        if (pr_check_done(s)) return -1;
+    }
+    *cpu_busy_out = cpu_busy;
+    *io_busy_out = io_busy;
+    *clock_out = clock;
+    return 0;
+}
+
+static int run_prun(const void *opt, long long seed, FILE *out) {
+    const prun_opt_t *o = (const prun_opt_t *) opt;
+    pyrand_t rng;
+    py_seed(&rng, seed);
+    prun_t s = { 0 };
+    s.switch_on_end = !strcmp(o->switch_on, "SWITCH_ON_END");
+    s.run_immediate = !strcmp(o->io_done, "IO_RUN_IMMEDIATE");
+    s.io_length = o->io_length;
+    int rc = 0, quiet = o->c.summary;
+
+    if (*o->program) {
+        // c7,i,c1,i:...  one process per ':'
+        const char *p = o->program;
+        for (;;) {
+            proc_t *pp = pr_new(&s);
+            for (;;) {
+                if (*p == 'c') {
+                    char *e;
+                    long n = strtol(p + 1, &e, 10);
+                    if (e == p + 1) { fprintf(stderr, "process-run: bad count after 'c' in %s\n", o->program); rc = 1; goto out; }
+                    for (long i = 0; i < n; i++) pr_emit(pp, DO_COMPUTE);
+                    p = e;
+                } else if (*p == 'i') {
+                    pr_emit(pp, DO_IO);
+                    p++;
+                } else if (*p == 'p') {
+                    for (long i = 0; i < o->io_length; i++) pr_emit(pp, DO_PROGRAMMED_IO);
+                    p++;
+                } else if (*p && *p != ',' && *p != ':') {
+                    fprintf(out, "bad opcode %c (should be c or i)\n", *p);
+                    rc = 1;
+                    goto out;
+                } else {
+                    fprintf(stderr, "process-run: empty instruction in %s\n", o->program);
+                    rc = 1;
+                    goto out;
+                }
+                while (*p && *p != ',' && *p != ':') p++;   // the scripts ignore the rest of an entry
+                if (*p != ',') break;
+                p++;
+            }
+            if (*p != ':') break;
+            p++;
+        }
+    } else {
+        // X:Y,...  X instructions, each CPU with probability Y%
+        const char *p = o->process_list;
+        for (;;) {
+            char *e;
+            long n = strtol(p, &e, 10);
+            double chance = 0;
+            if (e == p || *e != ':') {
+                int len = (int) strcspn(p, ",");
+                fprintf(out, "Bad description (%.*s): Must be number <x:y>\n"
+                        "  where X is the number of instructions\n"
+                        "  and Y is the percent change that an instruction is CPU not IO\n", len, p);
+                rc = 1;
+                goto out;
+            }
+            chance = strtod(e + 1, &e) / 100.0;
+            proc_t *pp = pr_new(&s);
+            for (long i = 0; i < n; i++) pr_emit(pp, py_random(&rng) < chance ? DO_COMPUTE : DO_IO);
+            p = e;
+            if (*p != ',') break;
+            p++;
+        }
+    }
+
+    if (!o->c.solve && !quiet) {
+        fprintf(out, "Produce a trace of what would happen when you run these processes:\n");
+        for (int q = 0; q < s.np; q++) {
+            fprintf(out, "Process %d\n", q);
+            for (long i = 0; i < s.p[q].n; i++) fprintf(out, "  %s\n", do_names[(int) s.p[q].code[i]]);
+            fprintf(out, "\n");
+        }
+        fprintf(out, "Important behaviors:\n  System will switch when%s\n  After IOs, the process issuing the IO will%s\n\n",
+                s.switch_on_end ? "the current process is FINISHED" : "the current process is FINISHED or ISSUES AN IO",
+                s.run_immediate ? "run IMMEDIATELY" : "run LATER (when it is its turn)");
+        goto out;
+    }
+
+    long cpu_busy, io_busy, clock;
+    if (pr_run(&s, out, quiet, &cpu_busy, &io_busy, &clock) != 0) { rc = 1; goto out; }
+    if (quiet)
+        fprintf(out, "[process-run] seed=%lld procs=%d time=%ld cpu_busy=%ld cpu_pct=%.2f io_busy=%ld io_pct=%.2f\n",
+                seed, s.np, clock, cpu_busy, 100.0 * cpu_busy / clock, io_busy, 100.0 * io_busy / clock);
+    else if (o->print_stats)
+        fprintf(out, "\nStats: Total Time %ld\nStats: CPU Busy %ld (%.2f%%)\nStats: IO Busy  %ld (%.2f%%)\n\n",
+                clock, cpu_busy, 100.0 * cpu_busy / clock, io_busy, 100.0 * io_busy / clock);
+out:
+    for (int q = 0; q < s.np; q++) { free(s.p[q].code); free(s.p[q].cpu_run); }
+    free(s.p);
+    return rc;
+}
+
+// ---------------------------------------------------------------------------
+// Seeds, in parallel
+
+typedef int (*sim_fn)(const void *opt, long long seed, FILE *out);
+
+typedef struct {
+    sim_fn fn;
+    const void *opt;
+    const char *pattern;
+    long long *seeds;
+    int n;
+    int next;                   // next seed index to claim
+    char **buf;                 // per seed output, when not writing files
+    size_t *len;
+    int *rc;
+} job_t;
+
+static FILE *open_out(const char *pattern, long long seed) {
+    char path[4096];
+    const char *at = strstr(pattern, "{seed}");
+    if (at) snprintf(path, sizeof(path), "%.*s%lld%s", (int) (at - pattern), pattern, seed, at + 6);
+    else snprintf(path, sizeof(path), "%s", pattern);
+    FILE *f = fopen(path, "w");
+    if (!f) perror(path);
+    return f;
+}
+
+static void *seed_worker(void *arg) {
+    job_t *j = (job_t *) arg;
+    for (;;) {
+        int i = __atomic_fetch_add(&j->next, 1, __ATOMIC_RELAXED);
+        if (i >= j->n) return NULL;
+        FILE *f = j->pattern ? open_out(j->pattern, j->seeds[i]) : open_memstream(&j->buf[i], &j->len[i]);
+        if (!f) { j->rc[i] = 1; continue; }
+        j->rc[i] = j->fn(j->opt, j->seeds[i], f);
+        fclose(f);
+    }
+}
+
+static int parse_seeds(const char *s, long long **out) {
+    int n = 0, cap = 0;
+    long long *v = NULL;
+    for (const char *p = s; *p; ) {
+        char *e;
+        long long a = strtoll(p, &e, 10), b = a;
+        if (e == p) return -1;
+        if (*e == '-') { p = e + 1; b = strtoll(p, &e, 10); if (e == p || b < a) return -1; }
+        for (long long x = a; x <= b; x++) {
+            if (n == cap) v = realloc(v, sizeof(long long) * (cap = cap ? 2 * cap : 64));
+            v[n++] = x;
+        }
+        p = e;
+        if (*p == ',') p++;
+        else if (*p) return -1;
+    }
+    *out = v;
+    return n;
+}
+
+static int run_seeds(sim_fn fn, const void *opt, const common_t *c) {
+    if (!c->seeds && !c->out)
+        return fn(opt, c->seed, stdout);
+
+    job_t j = { fn, opt, c->out, NULL, 1, 0, NULL, NULL, NULL };
+    long long one = c->seed;
+    if (c->seeds) {
+        j.n = parse_seeds(c->seeds, &j.seeds);
+        if (j.n <= 0) { fprintf(stderr, "%s: bad --seeds=%s (want e.g. 1-100,200)\n", prog, c->seeds); return 2; }
+    } else {
+        j.seeds = &one;
+    }
+    j.buf = calloc(j.n, sizeof(char *));
+    j.len = calloc(j.n, sizeof(size_t));
+    j.rc = calloc(j.n, sizeof(int));
+    int par = c->par > 0 ? (int) c->par : (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (par > j.n) par = j.n;
+    if (par < 1) par = 1;
+    pthread_t *t = malloc(sizeof(pthread_t) * par);
+    for (int i = 1; i < par; i++) pthread_create(&t[i], NULL, seed_worker, &j);
+    seed_worker(&j);
+    for (int i = 1; i < par; i++) pthread_join(t[i], NULL);
+
+    int rc = 0;
+    for (int i = 0; i < j.n; i++) {
+        if (j.buf[i]) fwrite(j.buf[i], 1, j.len[i], stdout);
+        free(j.buf[i]);
+        if (j.rc[i] > rc) rc = j.rc[i];
+    }
+    free(t); free(j.buf); free(j.len); free(j.rc);
+    if (j.seeds != &one) free(j.seeds);
+    return rc;
+}
+
+// ---------------------------------------------------------------------------
+
+static int main_mlfq(int argc, char **argv) {
+    mlfq_opt_t o = { .num_queues = 3, .quantum = 10, .allotment = 1, .num_jobs = 3, .maxlen = 100,
+                     .maxio = 10, .io_time = 5, .quantum_list = "", .allotment_list = "", .jlist = "" };
+    opt_t t[MAX_OPTS];
+    int n = 0;
+    t[n++] = (opt_t) { 's', "seed", OPT_INT, &o.c.seed };
+    t[n++] = (opt_t) { 'n', "numQueues", OPT_INT, &o.num_queues };
+    t[n++] = (opt_t) { 'q', "quantum", OPT_INT, &o.quantum };
+    t[n++] = (opt_t) { 'a', "allotment", OPT_INT, &o.allotment };
+    t[n++] = (opt_t) { 'Q', "quantumList", OPT_STR, &o.quantum_list };
+    t[n++] = (opt_t) { 'A', "allotmentList", OPT_STR, &o.allotment_list };
+    t[n++] = (opt_t) { 'j', "numJobs", OPT_INT, &o.num_jobs };
+    t[n++] = (opt_t) { 'm', "maxlen", OPT_INT, &o.maxlen };
+    t[n++] = (opt_t) { 'M', "maxio", OPT_INT, &o.maxio };
+    t[n++] = (opt_t) { 'B', "boost", OPT_INT, &o.boost };
+    t[n++] = (opt_t) { 'i', "iotime", OPT_INT, &o.io_time };
+    t[n++] = (opt_t) { 'S', "stay", OPT_BOOL, &o.stay };
+    t[n++] = (opt_t) { 'I', "iobump", OPT_BOOL, &o.iobump };
+    t[n++] = (opt_t) { 'l', "jlist", OPT_STR, &o.jlist };
+    t[n++] = (opt_t) { 'c', "solve", OPT_BOOL, &o.c.solve };   // mlfq.py has only -c
+    n = add_common(t, n, &o.c);
+    opt_parse(t, n, argc, argv);
+    return run_seeds(run_mlfq, &o, &o.c);
+}
+
+static int main_lottery(int argc, char **argv) {
+    lottery_opt_t o = { .jobs = 3, .maxlen = 10, .maxticket = 100, .quantum = 1, .jlist = "" };
+    opt_t t[MAX_OPTS];
+    int n = 0;
+    t[n++] = (opt_t) { 's', "seed", OPT_INT, &o.c.seed };
+    t[n++] = (opt_t) { 'j', "jobs", OPT_INT, &o.jobs };
+    t[n++] = (opt_t) { 'l', "jlist", OPT_STR, &o.jlist };
+    t[n++] = (opt_t) { 'm', "maxlen", OPT_INT, &o.maxlen };
+    t[n++] = (opt_t) { 'T', "maxticket", OPT_INT, &o.maxticket };
+    t[n++] = (opt_t) { 'q', "quantum", OPT_INT, &o.quantum };
+    t[n++] = (opt_t) { 'c', "compute", OPT_BOOL, &o.c.solve };
+    n = add_common(t, n, &o.c);
+    opt_parse(t, n, argc, argv);
+    return run_seeds(run_lottery, &o, &o.c);
+}
+
+static int main_prun(int argc, char **argv) {
+    prun_opt_t o = { .program = "", .process_list = "", .switch_on = "SWITCH_ON_IO", .io_done = "IO_RUN_LATER",
+                     .io_length = 5, .interrupt_overhead = 5 };
+    opt_t t[MAX_OPTS];
+    int n = 0;
+    t[n++] = (opt_t) { 's', "seed", OPT_INT, &o.c.seed };
+    t[n++] = (opt_t) { 'P', "program", OPT_STR, &o.program };
+    t[n++] = (opt_t) { 'l', "processlist", OPT_STR, &o.process_list };
+    t[n++] = (opt_t) { 'L', "iolength", OPT_INT, &o.io_length };
+    t[n++] = (opt_t) { 'o', "interrupt_overhead", OPT_INT, &o.interrupt_overhead };
+    t[n++] = (opt_t) { 'S', "switch", OPT_STR, &o.switch_on };
+    t[n++] = (opt_t) { 'I', "iodone", OPT_STR, &o.io_done };
+    t[n++] = (opt_t) { 'c', "solve", OPT_BOOL, &o.c.solve };   // process-run.py has only -c
+    t[n++] = (opt_t) { 'p', "printstats", OPT_BOOL, &o.print_stats };
+    n = add_common(t, n, &o.c);
+    opt_parse(t, n, argc, argv);
+    if ((strcmp(o.switch_on, "SWITCH_ON_IO") && strcmp(o.switch_on, "SWITCH_ON_END")) ||
+        (strcmp(o.io_done, "IO_RUN_LATER") && strcmp(o.io_done, "IO_RUN_IMMEDIATE"))) {
+        fprintf(stderr, "%s: -S takes SWITCH_ON_IO|SWITCH_ON_END, -I takes IO_RUN_LATER|IO_RUN_IMMEDIATE\n", prog);
+        return 1;
+    }
+    return run_seeds(run_prun, &o, &o.c);
+}
+
+int main(int argc, char *argv[]) {
+    static const struct { const char *name; int (*main)(int, char **); } sims[] = {
+        { "mlfq", main_mlfq }, { "lottery", main_lottery }, { "process-run", main_prun },
+    };
+    const char *base = strrchr(argv[0], '/');
+    base = base ? base + 1 : argv[0];
+    for (int i = 0; i < 3; i++) {
+        size_t len = strlen(sims[i].name);
+        if (!strncmp(base, sims[i].name, len) && (!base[len] || !strcmp(base + len, ".py"))) {
+            prog = base;
+            return sims[i].main(argc - 1, argv + 1);
+        }
+    }
+    for (int i = 0; argc > 1 && i < 3; i++)
+        if (!strcmp(argv[1], sims[i].name)) {
+            prog = sims[i].name;
+            return sims[i].main(argc - 2, argv + 2);
+        }
+    fprintf(stderr, "usage: %s mlfq|lottery|process-run [flags of that script] [--seeds=A-B,...] [--par=N]\n"
+            "       [--out=pattern_{seed}.txt] [--summary]\n", argv[0]);
+    return 1;
+}
@@ -0,0 +1,454 @@
+// sweep.c
+// Runs a benchmark over every combination of parameter values, several times
+// per point, and reports median and 95% confidence interval for every number
+// the benchmark prints.
+//
+// usage: sweep [-p name=v1,v2,...]... [-d name=a<op>b]... [-r repeats] [-w warmups]
+//              [-e] [-c col1,col2,...] [-o out.csv|out.json] -- command args...
+//
+//   -p  a swept parameter; {name} in the command is replaced by its value.
+//       Points are the cartesian product of all -p lists, first -p outermost
+//   -d  a derived parameter: a and b are numbers or parameter names, op one
+//       of + - * /, e.g. -d trials=100000000/pages (integer result, >= 1)
+//   -r  measured runs per point (default 5)
+//   -w  runs per point done first and thrown away (default 1)
+//   -e  parse the command's stderr too (tlb prints its counters there)
+//   -c  names for the columns of lines that are only numbers (tlb's
+//       "<pages> <ns>"); default col1, col2, ...
+//   -o  write results to a file, JSON if it ends in .json, CSV otherwise
+//       (default: CSV on stdout)
+//
+// Every output line of the form "[tag] key=value key=value ..." (or
+// "tag: key=value ...") is understood. Numeric values, optionally followed
+// by a unit such as "ms", become metrics. Other values (layout=locked,
+// lock=mcs, dist=zipf:0.99) name the series, along with the tag, so one run
+// can report several series. A series printed more than once per run gets
+// #2, #3, ... appended. A run that exits non-zero is reported on stderr and
+// not counted.
+//
+// One row per point, series and metric:
+//
+//   <param>..., series, metric, n, median, ci95_lo, ci95_hi, mean, stdev, min, max
+//
+// The interval is the distribution-free one for the median (order
+// statistics around n/2 +- 0.98 sqrt(n)). With fewer than 6 runs it is just
+// [min, max].
+//
+// e.g. (one command line each)
+//   sweep -p threads=1,2,4,8 -p lock=mutex,mcs -r 7 -o q2.csv
+//         -- ../HW7exercise262829/exercise29/ch29 --lock={lock} q2 {threads} 1000000
+//   sweep -p pages=1,2,4,8,16,32,64,128,256,512,1024,2048 -d trials=100000000/pages
+//         -c pages,ns -o tlb.json -- ../HW6exercise19/tlb {pages} {trials}
+//
+// Build: gcc -O2 -o sweep sweep.c -lm
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define MAX_PARAMS 16
+#define MAX_VALUES 64
+#define MAX_COLS   16
+
+typedef struct {
+    char *name;
+    char *values[MAX_VALUES];
+    int n;
+    char *a, *b;                // derived: a <op> b
+    char op;                    // 0 = swept
+} param_t;
+
+typedef struct {
+    char series[256];
+    char metric[64];
+    double *v;
+    int n, cap;
+    int kept;                   // samples from runs that count (n includes the current run)
+    int seen;                   // occurrences in the current run
+} stat_t;
+
+static param_t params[MAX_PARAMS];
+static int nparams;
+static char *cur[MAX_PARAMS];   // value of each parameter at this point
+static char derived_buf[MAX_PARAMS][32];
+static char *cols[MAX_COLS];
+static int ncols;
+
+static stat_t *stats;
+static int nstats, stats_cap;
+
+static stat_t *stat_get(const char *series, const char *metric) {
+    for (int i = 0; i < nstats; i++)
+        if (!strcmp(stats[i].series, series) && !strcmp(stats[i].metric, metric)) return &stats[i];
+    if (nstats == stats_cap) {
+        stats_cap = stats_cap ? stats_cap * 2 : 64;
+        stats = realloc(stats, sizeof(stat_t) * stats_cap);
+        if (!stats) { perror("realloc"); exit(1); }
+    }
+    stat_t *s = &stats[nstats++];
+    memset(s, 0, sizeof(*s));
+    snprintf(s->series, sizeof(s->series), "%s", series);
+    snprintf(s->metric, sizeof(s->metric), "%s", metric);
+    return s;
+}
+
+static void stat_add(stat_t *s, double v) {
+    if (s->n == s->cap) {
+        s->cap = s->cap ? s->cap * 2 : 8;
+        s->v = realloc(s->v, sizeof(double) * s->cap);
+        if (!s->v) { perror("realloc"); exit(1); }
+    }
+    s->v[s->n++] = v;
+}
+
+// Numeric value with an optional trailing unit ("12.5", "3.2ms", "40%").
+static int parse_number(const char *s, double *out) {
+    char *end;
+    if (!*s) return 0;
+    *out = strtod(s, &end);
+    if (end == s) return 0;
+    for (; *end; end++)
+        if (!isalpha((unsigned char) *end) && *end != '%') return 0;
+    return 1;
+}
+
+static const char *param_value(const char *name) {
+    for (int i = 0; i < nparams; i++)
+        if (!strcmp(params[i].name, name)) return cur[i];
+    return NULL;
+}
+
+static long operand(const char *s) {
+    const char *v = param_value(s);
+    return atol(v ? v : s);
+}
+
+// Replaces every {name} in arg with the parameter's value.
+static char *substitute(const char *arg) {
+    size_t cap = strlen(arg) + 256, len = 0;
+    char *out = malloc(cap);
+    for (const char *p = arg; *p; ) {
+        const char *close = *p == '{' ? strchr(p, '}') : NULL;
+        const char *val = NULL;
+        if (close) {
+            char name[64];
+            snprintf(name, sizeof(name), "%.*s", (int) (close - p - 1), p + 1);
+            val = param_value(name);
+        }
+        const char *piece = val ? val : p;
+        size_t n = val ? strlen(val) : 1;
+        if (len + n + 1 > cap) { cap = (len + n + 1) * 2; out = realloc(out, cap); }
+        memcpy(out + len, piece, n);
+        len += n;
+        p = val ? close + 1 : p + 1;
+    }
+    out[len] = '\0';
+    return out;
+}
+
+// One output line of one run.
+static void parse_line(char *line) {
+    char *tok[128];
+    int ntok = 0;
+    for (char *t = strtok(line, " \t\r\n"); t && ntok < 128; t = strtok(NULL, " \t\r\n")) tok[ntok++] = t;
+    if (ntok == 0) return;
+
+    char series[256] = "";
+    int first = 0, has_kv = 0;
+    size_t tl = strlen(tok[0]);
+    if (tok[0][0] == '[' && tok[0][tl - 1] == ']') {
+        snprintf(series, sizeof(series), "%.*s", (int) tl - 2, tok[0] + 1);
+        first = 1;
+    } else if (tl > 1 && tok[0][tl - 1] == ':' && !strchr(tok[0], '=')) {
+        snprintf(series, sizeof(series), "%.*s", (int) tl - 1, tok[0]);
+        first = 1;
+    }
+    for (int i = first; i < ntok; i++) {
+        char *eq = strchr(tok[i], '=');
+        double v;
+        if (!eq) continue;
+        has_kv = 1;
+        if (!parse_number(eq + 1, &v) && strcmp(eq + 1, "n/a")) {
+            size_t l = strlen(series);
+            snprintf(series + l, sizeof(series) - l, "%s%s", l ? " " : "", tok[i]);
+        }
+    }
+
+    if (!has_kv) {
+        // Only numbers ("<pages> <ns>"): named columns.
+        double v[MAX_COLS];
+        int n = 0;
+        for (int i = first; i < ntok && n < MAX_COLS; i++)
+            if (!parse_number(tok[i], &v[n++])) return;
+        for (int i = 0; i < n; i++) {
+            char name[32];
+            if (i < ncols) snprintf(name, sizeof(name), "%s", cols[i]);
+            else snprintf(name, sizeof(name), "col%d", i + 1);
+            stat_t *s = stat_get(series, name);
+            if (s->seen++ == 0) stat_add(s, v[i]);
+        }
+        return;
+    }
+
+    // Repeated series in one run: keep them apart as series#2, #3, ...
+    stat_t *probe = NULL;
+    for (int i = first; i < ntok && !probe; i++) {
+        char *eq = strchr(tok[i], '=');
+        double v;
+        if (eq && parse_number(eq + 1, &v)) {
+            *eq = '\0';
+            probe = stat_get(series, tok[i]);
+            *eq = '=';
+        }
+    }
+    if (!probe) return;
+    if (probe->seen) {
+        size_t l = strlen(series);
+        snprintf(series + l, sizeof(series) - l, "#%d", probe->seen + 1);
+    }
+    probe->seen++;
+    for (int i = first; i < ntok; i++) {
+        char *eq = strchr(tok[i], '=');
+        double v;
+        if (!eq || !parse_number(eq + 1, &v)) continue;
+        *eq = '\0';
+        stat_add(stat_get(series, tok[i]), v);
+        *eq = '=';
+    }
+}
+
+// Runs the command once; returns 0 if it exited cleanly.
+static int run_once(char **argv, int keep, int with_stderr) {
+    int fd[2];
+    if (pipe(fd) < 0) { perror("pipe"); exit(1); }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) { perror("fork"); exit(1); }
+    if (pid == 0) {
+        dup2(fd[1], 1);
+        if (with_stderr) dup2(fd[1], 2);
+        close(fd[0]);
+        close(fd[1]);
+        execvp(argv[0], argv);
+        perror(argv[0]);
+        _exit(127);
+    }
+    close(fd[1]);
+    for (int i = 0; i < nstats; i++) stats[i].seen = 0;
+    FILE *f = fdopen(fd[0], "r");
+    char *line = NULL;
+    size_t cap = 0;
+    while (getline(&line, &cap, f) > 0) parse_line(line);
+    free(line);
+    fclose(f);
+    int status;
+    waitpid(pid, &status, 0);
+    int ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    // Warmups and failed runs are parsed like the others, then dropped.
+    for (int i = 0; i < nstats; i++) {
+        if (keep && ok) stats[i].kept = stats[i].n;
+        else stats[i].n = stats[i].kept;
+    }
+    return ok ? 0 : -1;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return x < y ? -1 : x > y;
+}
+
+typedef struct { double median, lo, hi, mean, stdev, min, max; } summary_t;
+
+static summary_t summarize(double *v, int n) {
+    summary_t s;
+    qsort(v, n, sizeof(double), cmp_double);
+    s.min = v[0];
+    s.max = v[n - 1];
+    s.median = n & 1 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+    double sum = 0, sq = 0;
+    for (int i = 0; i < n; i++) sum += v[i];
+    s.mean = sum / n;
+    for (int i = 0; i < n; i++) sq += (v[i] - s.mean) * (v[i] - s.mean);
+    s.stdev = n > 1 ? sqrt(sq / (n - 1)) : 0;
+    if (n < 6) {
+        s.lo = s.min;
+        s.hi = s.max;
+    } else {
+        // 1-based ranks of the 95% interval for the median.
+        int lo = (int) floor((n - 1.96 * sqrt(n)) / 2);
+        int hi = (int) ceil(1 + (n + 1.96 * sqrt(n)) / 2);
+        if (lo < 1) lo = 1;
+        if (hi > n) hi = n;
+        s.lo = v[lo - 1];
+        s.hi = v[hi - 1];
+    }
+    return s;
+}
+
+static void csv_string(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"') fputc('"', f);
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static void json_string(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', f);
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static void emit(FILE *out, int json, int *first_row) {
+    for (int i = 0; i < nstats; i++) {
+        stat_t *st = &stats[i];
+        if (st->n == 0) continue;
+        summary_t s = summarize(st->v, st->n);
+        if (json) {
+            fprintf(out, "%s\n  {\"params\":{", *first_row ? "" : ",");
+            for (int p = 0; p < nparams; p++) {
+                fprintf(out, "%s", p ? "," : "");
+                json_string(out, params[p].name);
+                fputc(':', out);
+                json_string(out, cur[p]);
+            }
+            fprintf(out, "},\"series\":");
+            json_string(out, st->series);
+            fprintf(out, ",\"metric\":");
+            json_string(out, st->metric);
+            fprintf(out, ",\"n\":%d,\"median\":%.6g,\"ci95_lo\":%.6g,\"ci95_hi\":%.6g,"
+                    "\"mean\":%.6g,\"stdev\":%.6g,\"min\":%.6g,\"max\":%.6g}",
+                    st->n, s.median, s.lo, s.hi, s.mean, s.stdev, s.min, s.max);
+        } else {
+            for (int p = 0; p < nparams; p++) { csv_string(out, cur[p]); fputc(',', out); }
+            csv_string(out, st->series);
+            fputc(',', out);
+            csv_string(out, st->metric);
+            fprintf(out, ",%d,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g\n",
+                    st->n, s.median, s.lo, s.hi, s.mean, s.stdev, s.min, s.max);
+        }
+        *first_row = 0;
+    }
+}
+
+static void usage(const char *p) {
+    fprintf(stderr, "usage: %s [-p name=v1,v2,...]... [-d name=a<op>b]... [-r repeats] [-w warmups]\n"
+            "       [-e] [-c col1,col2,...] [-o out.csv|out.json] -- command args...\n", p);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    int repeats = 5, warmups = 1, with_stderr = 0, opt;
+    const char *outpath = NULL;
+
+    while ((opt = getopt(argc, argv, "+p:d:r:w:ec:o:")) != -1) {
+        char *eq;
+        switch (opt) {
+        case 'p':
+        case 'd':
+            if (nparams == MAX_PARAMS || !(eq = strchr(optarg, '=')) || eq == optarg) usage(argv[0]);
+            *eq = '\0';
+            params[nparams].name = optarg;
+            if (opt == 'p') {
+                for (char *v = strtok(eq + 1, ","); v && params[nparams].n < MAX_VALUES; v = strtok(NULL, ","))
+                    params[nparams].values[params[nparams].n++] = v;
+                if (params[nparams].n == 0) usage(argv[0]);
+            } else {
+                char *o = strpbrk(eq + 1, "+-*/");
+                if (!o || o == eq + 1 || !o[1]) usage(argv[0]);
+                params[nparams].op = *o;
+                *o = '\0';
+                params[nparams].a = eq + 1;
+                params[nparams].b = o + 1;
+            }
+            nparams++;
+            break;
+        case 'r': repeats = atoi(optarg); break;
+        case 'w': warmups = atoi(optarg); break;
+        case 'e': with_stderr = 1; break;
+        case 'c':
+            for (char *c = strtok(optarg, ","); c && ncols < MAX_COLS; c = strtok(NULL, ",")) cols[ncols++] = c;
+            break;
+        case 'o': outpath = optarg; break;
+        default: usage(argv[0]);
+        }
+    }
+    if (optind >= argc || repeats < 1 || warmups < 0) usage(argv[0]);
+    char **tmpl = argv + optind;
+    int targc = argc - optind;
+
+    FILE *out = stdout;
+    int json = 0, first_row = 1;
+    if (outpath) {
+        size_t l = strlen(outpath);
+        json = l > 5 && !strcmp(outpath + l - 5, ".json");
+        if (!(out = fopen(outpath, "w"))) { perror(outpath); return 1; }
+    }
+    if (json) fprintf(out, "[");
+    else {
+        for (int p = 0; p < nparams; p++) fprintf(out, "%s,", params[p].name);
+        fprintf(out, "series,metric,n,median,ci95_lo,ci95_hi,mean,stdev,min,max\n");
+    }
+    fflush(out);
+
+    int idx[MAX_PARAMS] = { 0 }, failed = 0, points = 0;
+    char **cmd = malloc(sizeof(char *) * (targc + 1));
+    for (;;) {
+        // Values at this point: swept ones first, then derived (which may use them).
+        for (int p = 0; p < nparams; p++)
+            cur[p] = params[p].op ? derived_buf[p] : params[p].values[idx[p]];
+        for (int p = 0; p < nparams; p++) {
+            if (!params[p].op) continue;
+            long a = operand(params[p].a), b = operand(params[p].b), r;
+            switch (params[p].op) {
+            case '+': r = a + b; break;
+            case '-': r = a - b; break;
+            case '*': r = a * b; break;
+            default:  r = b ? a / b : 0; break;
+            }
+            snprintf(derived_buf[p], sizeof(derived_buf[p]), "%ld", r < 1 ? 1 : r);
+        }
+        for (int i = 0; i < targc; i++) cmd[i] = substitute(tmpl[i]);
+        cmd[targc] = NULL;
+
+        fprintf(stderr, "[sweep]");
+        for (int p = 0; p < nparams; p++) fprintf(stderr, " %s=%s", params[p].name, cur[p]);
+        for (int r = 0; r < warmups + repeats; r++) {
+            if (run_once(cmd, r >= warmups, with_stderr) != 0) {
+                fprintf(stderr, " [run %d failed]", r + 1);
+                failed++;
+            }
+        }
+        fprintf(stderr, "\n");
+        emit(out, json, &first_row);
+        fflush(out);
+        for (int i = 0; i < nstats; i++) free(stats[i].v);
+        nstats = 0;
+        for (int i = 0; i < targc; i++) free(cmd[i]);
+        points++;
+
+        // Next point: rightmost swept parameter moves fastest.
+        int p = nparams - 1;
+        for (; p >= 0; p--) {
+            if (params[p].op) continue;
+            if (++idx[p] < params[p].n) break;
+            idx[p] = 0;
+        }
+        if (p < 0) break;
+    }
+    if (json) fprintf(out, "\n]\n");
+    if (out != stdout) fclose(out);
+    fprintf(stderr, "[sweep] points=%d runs_per_point=%d warmups=%d failed_runs=%d%s%s\n",
+            points, repeats, warmups, failed, outpath ? " output=" : "", outpath ? outpath : "");
+    free(cmd);
+    return failed ? 2 : 0;
+}